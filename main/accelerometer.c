@@ -1,16 +1,25 @@
 #include "accelerometer.h"
 
 #include <driver/gpio.h>
+#include <esp_attr.h>
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <i2cdev.h>
 #include <math.h>
 #include <mpu6050.h>
 
-#include "app_config.h"
+#include "accelerometer_dsp.h"
+#include "accelerometer_monitor.h"
+#include "app_resources.h"
+#include "event_bus.h"
+#include "gpio_interrupt.h"
+#include "metrics_publisher.h"
 #include "queue.h"
+#include "sampling_scheduler.h"
+#include "spsc_ring.h"
 
 static const char *TAG = "accelerometer";
 
@@ -18,54 +27,614 @@ static const char *TAG = "accelerometer";
 #define ACCELEROMETER_I2C_GPIO_SDA GPIO_NUM_32
 #define ACCELEROMETER_I2C_GPIO_SCL GPIO_NUM_33
 #define ACCELEROMETER_I2C_ADDR 0x68
-#define ACCELERATION_THREASHOLD_ACCELERATION 80
 #define ACCELERATION_THREASHOLD_ROTATION 80
+#define ACCELEROMETER_TRIGGER_RELEASE_RATIO 0.8f
+#define ACCELEROMETER_TRIGGER_DEBOUNCE_MS 30
+#define ACCELEROMETER_TRIGGER_HOLD_OFF_MS 2000
+#define ACCELEROMETER_METRICS_RING_SIZE 128
+#define ACCELEROMETER_POLL_PERIOD_MS 10
+#define ACCELEROMETER_BLOCK_SIZE 32
+#define ACCELEROMETER_GRAVITY_FILTER_ALPHA 0.02f
+#define ACCELEROMETER_VIBRATION_WINDOW_SAMPLES 256
+#define ACCELEROMETER_VIBRATION_DEADBAND_G 0.02f
+#define ACCELEROMETER_KNOCK_PEAK_TO_PEAK_G 0.5f
+#define ACCELEROMETER_KNOCK_JERK_G_PER_S 50.0f
+#define ACCELEROMETER_KNOCK_CREST_FACTOR 6.0f
+#define ACCELEROMETER_SUSTAINED_RMS_G 0.05f
+#define ACCELEROMETER_SUSTAINED_CROSSING_RATE_HZ 5.0f
+
+#define ACCELEROMETER_GPIO_INT GPIO_NUM_34
+
+#define ACCELEROMETER_FIFO_ENABLED true
+#define ACCELEROMETER_FIFO_SAMPLE_RATE_HZ 1000
+#define ACCELEROMETER_FIFO_WATERMARK_SAMPLES 10
+#define ACCELEROMETER_FIFO_MAX_BURST_SAMPLES 32
+#define ACCELEROMETER_FIFO_TIMEOUT_MS 100
+#define ACCELEROMETER_SAMPLE_RATE_HZ (ACCELEROMETER_FIFO_ENABLED ? ACCELEROMETER_FIFO_SAMPLE_RATE_HZ : 1000 / ACCELEROMETER_POLL_PERIOD_MS)
+/* Period the task is released at, once per FIFO watermark or once per poll. */
+#define ACCELEROMETER_RELEASE_PERIOD_MS (ACCELEROMETER_FIFO_ENABLED ? ACCELEROMETER_FIFO_WATERMARK_SAMPLES * 1000 / ACCELEROMETER_FIFO_SAMPLE_RATE_HZ : ACCELEROMETER_POLL_PERIOD_MS)
+
+#define ACCELEROMETER_GYRO_STANDBY_ENABLED true
+#define ACCELEROMETER_MOTION_QUIET_LEVEL 0.25f /* Trigger level below which the sensor counts as quiet. */
+#define ACCELEROMETER_MOTION_QUIET_MS 5000
+#define ACCELEROMETER_GYRO_SETTLE_MS 35 /* Gyro start up time. */
+
+/* MPU6050 registers and bits used by the FIFO and the gyro standby. */
+#define MPU6050_REG_SMPLRT_DIV 0x19
+#define MPU6050_REG_CONFIG 0x1A
+#define MPU6050_REG_GYRO_CONFIG 0x1B
+#define MPU6050_REG_FIFO_EN 0x23
+#define MPU6050_REG_INT_PIN_CFG 0x37
+#define MPU6050_REG_INT_ENABLE 0x38
+#define MPU6050_REG_USER_CTRL 0x6A
+#define MPU6050_REG_PWR_MGMT_1 0x6B
+#define MPU6050_REG_PWR_MGMT_2 0x6C
+#define MPU6050_REG_FIFO_COUNT_H 0x72
+#define MPU6050_REG_FIFO_R_W 0x74
+#define MPU6050_CONFIG_DLPF_188_HZ 0x01 /* Also drops the gyro output rate to 1 kHz. */
+#define MPU6050_FIFO_EN_ACCEL_GYRO 0x78
+#define MPU6050_INT_ENABLE_DATA_RDY 0x01
+#define MPU6050_PWR_MGMT_1_SLEEP 0x40
+#define MPU6050_PWR_MGMT_1_CLKSEL_INTERNAL 0x00 /* The gyro PLL is gone while the gyro is on standby. */
+#define MPU6050_PWR_MGMT_1_CLKSEL_PLL_X_GYRO 0x01
+#define MPU6050_PWR_MGMT_2_STBY_GYRO 0x07
+#define MPU6050_USER_CTRL_FIFO_EN 0x40
+#define MPU6050_USER_CTRL_FIFO_RESET 0x04
+#define MPU6050_FIFO_SIZE 1024
+#define MPU6050_FIFO_SAMPLE_SIZE 12 /* Accelerometer x, y, z then gyro x, y, z, big endian int16 each. */
+#define MPU6050_GYRO_OUTPUT_RATE_HZ 1000
+
+/**
+ * @brief What the sensor and the task are doing.
+ */
+typedef enum
+{
+    ACCELEROMETER_MODE_DISABLED, /* Sensor asleep, task blocked on the control queue. */
+    ACCELEROMETER_MODE_SAMPLING, /* Sensor and task running at the full sample rate, the gyro on standby while quiet. */
+} accelerometer_mode_t;
 
 static TaskHandle_t task_handle;
 
+static event_bus_subscription_t *control_subscription;
+
+static metric_t metrics_ring_buffer[ACCELEROMETER_METRICS_RING_SIZE];
+static spsc_ring_t metrics_ring;
+
 static mpu6050_dev_t device_descriptor;
 
+static sampling_scheduler_t sampling_scheduler;
+
+/* Conversion of raw FIFO readings, read from the ranges configured by mpu6050_init(). */
+static float acceleration_lsb_per_g;
+static float rotation_lsb_per_dps;
+
+/* Written by the data ready interrupt, anchors the FIFO samples in time. */
+static portMUX_TYPE data_ready_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t last_data_ready_us;
+static uint32_t data_ready_count;
+
+/* Trigger detection and the gyro standby decision, only used by the accelerometer task. */
+static accelerometer_monitor_t monitor;
+
 /**
- * @brief Calculates the Euclidean norm of a 3D vector.
+ * @brief Block of readings, one array per axis so the DSP kernels can stream through them.
  *
- * @param x X component.
- * @param y Y component.
- * @param z Z component.
+ * The squared magnitudes are filled in by whoever fills the block, as raw
+ * FIFO readings get them in exact integer arithmetic.
+ */
+typedef struct
+{
+    float acceleration_x[ACCELEROMETER_BLOCK_SIZE];
+    float acceleration_y[ACCELEROMETER_BLOCK_SIZE];
+    float acceleration_z[ACCELEROMETER_BLOCK_SIZE];
+    float rotation_x[ACCELEROMETER_BLOCK_SIZE];
+    float rotation_y[ACCELEROMETER_BLOCK_SIZE];
+    float rotation_z[ACCELEROMETER_BLOCK_SIZE];
+    float acceleration_squared[ACCELEROMETER_BLOCK_SIZE];
+    float rotation_squared[ACCELEROMETER_BLOCK_SIZE];
+    int64_t timestamp_us[ACCELEROMETER_BLOCK_SIZE];
+    size_t count;
+} sample_block_t;
+
+/* Only used by the accelerometer task, kept off its stack. */
+static sample_block_t sample_block;
+
+_Static_assert(ACCELEROMETER_FIFO_MAX_BURST_SAMPLES <= ACCELEROMETER_BLOCK_SIZE, "A FIFO burst must fit into one sample block");
+_Static_assert(ACCELEROMETER_BLOCK_SIZE <= ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES, "A sample block must fit into the monitor");
+
+static esp_err_t write_register(uint8_t reg, uint8_t value)
+{
+    I2C_DEV_TAKE_MUTEX(&device_descriptor.i2c_dev);
+    I2C_DEV_CHECK(&device_descriptor.i2c_dev, i2c_dev_write_reg(&device_descriptor.i2c_dev, reg, &value, 1));
+    I2C_DEV_GIVE_MUTEX(&device_descriptor.i2c_dev);
+    return ESP_OK;
+}
+
+static esp_err_t read_registers(uint8_t reg, void *data, size_t size)
+{
+    I2C_DEV_TAKE_MUTEX(&device_descriptor.i2c_dev);
+    I2C_DEV_CHECK(&device_descriptor.i2c_dev, i2c_dev_read_reg(&device_descriptor.i2c_dev, reg, data, size));
+    I2C_DEV_GIVE_MUTEX(&device_descriptor.i2c_dev);
+    return ESP_OK;
+}
+
+static esp_err_t write_registers(const uint8_t (*register_values)[2], size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const esp_err_t ret = write_register(register_values[i][0], register_values[i][1]);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to write register 0x%02x: %s", register_values[i][0], esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+static int16_t read_int16_be(const uint8_t *data) { return (int16_t)((data[0] << 8) | data[1]); }
+
+/**
+ * @brief Runs trigger detection on a block of readings and hands them to the metrics publisher.
+ *
+ * Rotation the gyro did not measure, while on standby or settling, is
+ * published as zero.
+ *
+ * @param block Readings with their squared magnitudes filled in.
+ */
+static void process_block(sample_block_t *block)
+{
+    int64_t trigger_timestamps_us[ACCELEROMETER_BLOCK_SIZE];
+    const size_t count = block->count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!accelerometer_monitor_rotation_valid(&monitor, block->timestamp_us[i]))
+        {
+            block->rotation_x[i] = 0;
+            block->rotation_y[i] = 0;
+            block->rotation_z[i] = 0;
+            block->rotation_squared[i] = 0;
+        }
+    }
+
+    const size_t trigger_count = accelerometer_monitor_process(&monitor, block->acceleration_x, block->acceleration_y, block->acceleration_z, block->rotation_squared, block->timestamp_us, count,
+                                                               trigger_timestamps_us);
+    for (size_t i = 0; i < trigger_count; i++)
+    {
+        const vibration_detector_t *vibration_detector = &monitor.vibration_detector;
+        ESP_LOGI(TAG, "Triggered with vibration \"%s\", rms %.3f g, peak-to-peak %.3f g.", vibration_detector_class_to_name(vibration_detector->classification), vibration_detector->features.rms_g,
+                 vibration_detector->features.peak_to_peak_g);
+        const message_t alarm_message = {
+            .component = COMPONENT_ACCELEROMETER,
+            .type = MESSAGE_TYPE_SENSOR_TRIGGERED,
+            .timestamp_us = trigger_timestamps_us[i],
+        };
+        event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &alarm_message);
+    }
+
+    size_t published = 0;
+    while (published < count)
+    {
+        metric_t *metrics;
+        const size_t reserved = spsc_ring_reserve(&metrics_ring, &metrics, count - published);
+        if (reserved == 0)
+        {
+            ESP_LOGD(TAG, "Metrics ring is full, dropping %zu samples.", count - published);
+            return;
+        }
+
+        for (size_t i = 0; i < reserved; i++, published++)
+        {
+            metrics[i] = (metric_t){
+                .metric_type = METRIC_TYPE_ACCELEROMETER_SAMPLE,
+                .timestamp_us = block->timestamp_us[published],
+                .accelerometer_sample = {
+                    .acceleration_x = block->acceleration_x[published],
+                    .acceleration_y = block->acceleration_y[published],
+                    .acceleration_z = block->acceleration_z[published],
+                    .acceleration_total = sqrtf(block->acceleration_squared[published]),
+                    .rotation_x = block->rotation_x[published],
+                    .rotation_y = block->rotation_y[published],
+                    .rotation_z = block->rotation_z[published],
+                    .rotation_total = sqrtf(block->rotation_squared[published]),
+                },
+            };
+        }
+        spsc_ring_commit(&metrics_ring, reserved);
+    }
+}
+
+/**
+ * @brief Waits for the next poll deadline and reads one sample with a register read.
+ */
+static void poll_sample(void)
+{
+    mpu6050_acceleration_t acceleration;
+    mpu6050_rotation_t rotation;
+
+    sampling_scheduler_wait(&sampling_scheduler);
+
+    const esp_err_t ret = mpu6050_get_motion(&device_descriptor, &acceleration, &rotation);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to get motion: %s", esp_err_to_name(ret));
+    }
+    else
+    {
+        sample_block_t *block = &sample_block;
+        block->acceleration_x[0] = acceleration.x;
+        block->acceleration_y[0] = acceleration.y;
+        block->acceleration_z[0] = acceleration.z;
+        block->rotation_x[0] = rotation.x;
+        block->rotation_y[0] = rotation.y;
+        block->rotation_z[0] = rotation.z;
+        block->timestamp_us[0] = esp_timer_get_time();
+        block->count = 1;
+        accelerometer_dsp_squared_magnitude_f32(block->acceleration_x, block->acceleration_y, block->acceleration_z, block->acceleration_squared, 1);
+        accelerometer_dsp_squared_magnitude_f32(block->rotation_x, block->rotation_y, block->rotation_z, block->rotation_squared, 1);
+        process_block(block);
+    }
+}
+
+/**
+ * @brief Counts data ready pulses and wakes the task once a watermark of samples is waiting.
  *
- * @return The norm.
+ * The MPU6050 has no FIFO watermark interrupt, so the watermark is counted here.
  */
-static float vec3_sum(float x, float y, float z) { return sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2)); }
+static void IRAM_ATTR interrupt_isr_handler(void *)
+{
+    const int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL_ISR(&data_ready_lock);
+    last_data_ready_us = now_us;
+    const uint32_t count = ++data_ready_count;
+    taskEXIT_CRITICAL_ISR(&data_ready_lock);
+
+    if (count % ACCELEROMETER_FIFO_WATERMARK_SAMPLES == 0 && task_handle != NULL)
+    {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task_handle, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+}
+
+/**
+ * @brief Reads the full scale ranges set by mpu6050_init() to convert raw FIFO readings.
+ */
+static esp_err_t fifo_read_scales(void)
+{
+    uint8_t config[2];
+    const esp_err_t ret = read_registers(MPU6050_REG_GYRO_CONFIG, config, sizeof(config));
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    // Each range step doubles the range and halves the resolution.
+    rotation_lsb_per_dps = 131.0f / (1 << ((config[0] >> 3) & 0x03));
+    acceleration_lsb_per_g = 16384.0f / (1 << ((config[1] >> 3) & 0x03));
+    return ESP_OK;
+}
+
+/**
+ * @brief Empties the FIFO and starts filling it at the configured sample rate.
+ */
+static esp_err_t fifo_start(void)
+{
+    const uint8_t register_values[][2] = {
+        {MPU6050_REG_INT_ENABLE, 0},
+        {MPU6050_REG_CONFIG, MPU6050_CONFIG_DLPF_188_HZ},
+        {MPU6050_REG_SMPLRT_DIV, MPU6050_GYRO_OUTPUT_RATE_HZ / ACCELEROMETER_FIFO_SAMPLE_RATE_HZ - 1},
+        {MPU6050_REG_INT_PIN_CFG, 0}, // Active high push-pull pulse on every new sample.
+        {MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RESET},
+        {MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_ACCEL_GYRO},
+        {MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN},
+    };
+
+    const esp_err_t ret = write_registers(register_values, sizeof(register_values) / sizeof(register_values[0]));
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    taskENTER_CRITICAL(&data_ready_lock);
+    data_ready_count = 0;
+    taskEXIT_CRITICAL(&data_ready_lock);
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    return write_register(MPU6050_REG_INT_ENABLE, MPU6050_INT_ENABLE_DATA_RDY);
+}
+
+/**
+ * @brief Stops the FIFO and the data ready interrupt.
+ */
+static esp_err_t fifo_stop(void)
+{
+    esp_err_t ret = write_register(MPU6050_REG_INT_ENABLE, 0);
+    if (ret == ESP_OK)
+    {
+        ret = write_register(MPU6050_REG_USER_CTRL, 0);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = write_register(MPU6050_REG_FIFO_EN, 0);
+    }
+    return ret;
+}
+
+/**
+ * @brief Waits for the watermark and burst reads every complete sample from the FIFO.
+ *
+ * Samples are timestamped from the sample clock: the newest sample is taken
+ * at the last data ready pulse and the others are one sample period apart.
+ */
+static void read_fifo_burst(void)
+{
+    static uint8_t fifo_data[ACCELEROMETER_FIFO_MAX_BURST_SAMPLES * MPU6050_FIFO_SAMPLE_SIZE];
+    static int16_t raw[6][ACCELEROMETER_FIFO_MAX_BURST_SAMPLES];
+    static uint32_t raw_squared[ACCELEROMETER_FIFO_MAX_BURST_SAMPLES];
+    const int64_t sample_period_us = 1000000 / ACCELEROMETER_FIFO_SAMPLE_RATE_HZ;
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACCELEROMETER_FIFO_TIMEOUT_MS));
+    sampling_scheduler_record_release(&sampling_scheduler, esp_timer_get_time());
+
+    uint8_t fifo_count_data[2];
+    esp_err_t ret = read_registers(MPU6050_REG_FIFO_COUNT_H, fifo_count_data, sizeof(fifo_count_data));
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read FIFO count: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    const uint16_t fifo_count = (fifo_count_data[0] << 8) | fifo_count_data[1];
+    if (fifo_count >= MPU6050_FIFO_SIZE)
+    {
+        ESP_LOGW(TAG, "FIFO overflowed, restarting it.");
+        ret = fifo_start();
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to restart FIFO: %s", esp_err_to_name(ret));
+        }
+        return;
+    }
+
+    size_t sample_count = fifo_count / MPU6050_FIFO_SAMPLE_SIZE;
+    if (sample_count > ACCELEROMETER_FIFO_MAX_BURST_SAMPLES)
+    {
+        sample_count = ACCELEROMETER_FIFO_MAX_BURST_SAMPLES;
+    }
+    if (sample_count == 0)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL(&data_ready_lock);
+    const int64_t newest_sample_us = last_data_ready_us;
+    taskEXIT_CRITICAL(&data_ready_lock);
+
+    ret = read_registers(MPU6050_REG_FIFO_R_W, fifo_data, sample_count * MPU6050_FIFO_SAMPLE_SIZE);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read FIFO: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    // Samples left in the FIFO are newer than the ones read here.
+    const size_t newer_sample_count = fifo_count / MPU6050_FIFO_SAMPLE_SIZE - sample_count;
+    sample_block_t *block = &sample_block;
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        const uint8_t *sample = &fifo_data[i * MPU6050_FIFO_SAMPLE_SIZE];
+        for (size_t axis = 0; axis < 6; axis++)
+        {
+            raw[axis][i] = read_int16_be(&sample[axis * 2]);
+        }
+        block->timestamp_us[i] = newest_sample_us - (int64_t)(sample_count - 1 - i + newer_sample_count) * sample_period_us;
+    }
+    block->count = sample_count;
+
+    const float acceleration_g_per_lsb = 1.0f / acceleration_lsb_per_g;
+    const float rotation_dps_per_lsb = 1.0f / rotation_lsb_per_dps;
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        block->acceleration_x[i] = raw[0][i] * acceleration_g_per_lsb;
+        block->acceleration_y[i] = raw[1][i] * acceleration_g_per_lsb;
+        block->acceleration_z[i] = raw[2][i] * acceleration_g_per_lsb;
+        block->rotation_x[i] = raw[3][i] * rotation_dps_per_lsb;
+        block->rotation_y[i] = raw[4][i] * rotation_dps_per_lsb;
+        block->rotation_z[i] = raw[5][i] * rotation_dps_per_lsb;
+    }
+
+    // Squared in exact integer arithmetic, then scaled once.
+    accelerometer_dsp_squared_magnitude_s16(raw[0], raw[1], raw[2], raw_squared, sample_count);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        block->acceleration_squared[i] = raw_squared[i] * (acceleration_g_per_lsb * acceleration_g_per_lsb);
+    }
+    accelerometer_dsp_squared_magnitude_s16(raw[3], raw[4], raw[5], raw_squared, sample_count);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        block->rotation_squared[i] = raw_squared[i] * (rotation_dps_per_lsb * rotation_dps_per_lsb);
+    }
+
+    process_block(block);
+}
+
+/**
+ * @brief Stops sampling and any interrupt, and puts the sensor to sleep.
+ */
+static esp_err_t sensor_sleep(void)
+{
+    esp_err_t ret = ACCELEROMETER_FIFO_ENABLED ? fifo_stop() : ESP_OK;
+    if (ret == ESP_OK)
+    {
+        ret = write_register(MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_MGMT_1_SLEEP);
+    }
+    return ret;
+}
+
+/**
+ * @brief Wakes the sensor up fully and starts sampling at the full rate.
+ *
+ * Samples from before are not continuous with the new ones, so the
+ * monitor starts over.
+ */
+static esp_err_t sampling_start(void)
+{
+    const uint8_t register_values[][2] = {
+        {MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_MGMT_1_CLKSEL_PLL_X_GYRO},
+        {MPU6050_REG_PWR_MGMT_2, 0},
+    };
+    const esp_err_t ret = write_registers(register_values, sizeof(register_values) / sizeof(register_values[0]));
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(ACCELEROMETER_GYRO_SETTLE_MS));
+
+    accelerometer_monitor_restart(&monitor, esp_timer_get_time());
+    sampling_scheduler_start(&sampling_scheduler);
+
+    return ACCELEROMETER_FIFO_ENABLED ? fifo_start() : ESP_OK;
+}
+
+/**
+ * @brief Puts the gyro on standby or wakes it up, while the accelerometer keeps sampling.
+ *
+ * The FIFO keeps its layout, so its stream of acceleration samples goes on
+ * without a gap. The gyro bytes in it are meaningless until the gyro has
+ * settled, the monitor knows from when on.
+ *
+ * @param standby Whether to put the gyro on standby.
+ */
+static esp_err_t gyro_set_standby(bool standby)
+{
+    // The sample clock moves to the internal oscillator before the gyro it is derived from stops, and back after it runs.
+    const uint8_t standby_values[][2] = {
+        {MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_MGMT_1_CLKSEL_INTERNAL},
+        {MPU6050_REG_PWR_MGMT_2, MPU6050_PWR_MGMT_2_STBY_GYRO},
+    };
+    const uint8_t wake_values[][2] = {
+        {MPU6050_REG_PWR_MGMT_2, 0},
+        {MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_MGMT_1_CLKSEL_PLL_X_GYRO},
+    };
+    return write_registers(standby ? standby_values : wake_values, 2);
+}
+
+/**
+ * @brief Puts the gyro on standby after a quiet while, and wakes it again on activity.
+ */
+static void update_gyro_standby(void)
+{
+    const int64_t now_us = esp_timer_get_time();
+    const bool standby = !accelerometer_monitor_gyro_needed(&monitor, now_us);
+    if (standby == monitor.gyro_standby)
+    {
+        return;
+    }
+
+    const esp_err_t ret = gyro_set_standby(standby);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to %s the gyro: %s", standby ? "put on standby" : "wake up", esp_err_to_name(ret));
+        return;
+    }
+    if (standby)
+    {
+        ESP_LOGD(TAG, "Quiet for %d ms, gyro on standby.", ACCELEROMETER_MOTION_QUIET_MS);
+    }
+    else
+    {
+        ESP_LOGD(TAG, "Activity, gyro woken up.");
+    }
+    accelerometer_monitor_set_gyro_standby(&monitor, standby, now_us);
+}
+
+static const char *mode_to_name(accelerometer_mode_t mode)
+{
+    switch (mode)
+    {
+    case ACCELEROMETER_MODE_DISABLED:
+        return "ACCELEROMETER_MODE_DISABLED";
+    case ACCELEROMETER_MODE_SAMPLING:
+        return "ACCELEROMETER_MODE_SAMPLING";
+    default:
+        return "INVALID_ACCELEROMETER_MODE";
+    }
+}
+
+/**
+ * @brief Switches the sensor into a mode.
+ *
+ * @param mode Mode to switch to.
+ *
+ * @return The mode the sensor is in now.
+ */
+static accelerometer_mode_t enter_mode(accelerometer_mode_t mode)
+{
+    esp_err_t ret;
+    switch (mode)
+    {
+    case ACCELEROMETER_MODE_DISABLED:
+        ret = sensor_sleep();
+        break;
+    case ACCELEROMETER_MODE_SAMPLING:
+    default:
+        ret = sampling_start();
+        break;
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to enter mode \"%s\": %s", mode_to_name(mode), esp_err_to_name(ret));
+        return mode;
+    }
+
+    ESP_LOGD(TAG, "Entered mode \"%s\".", mode_to_name(mode));
+    return mode;
+}
 
 /**
  * @brief Task handler for accelerometer monitoring.
- * Continuously reads sensor data and sends alerts if thresholds are exceeded.
+ * Continuously reads sensor data and sends one alert per episode of knocks,
+ * sustained vibration or rotation above the thresholds.
+ *
+ * With ACCELEROMETER_FIFO_ENABLED the sensor samples into its hardware FIFO
+ * at ACCELEROMETER_FIFO_SAMPLE_RATE_HZ and the task sleeps until
+ * ACCELEROMETER_FIFO_WATERMARK_SAMPLES are waiting, then reads them in a
+ * single I2C transaction. Otherwise the task polls one sample every
+ * ACCELEROMETER_POLL_PERIOD_MS.
+ *
+ * With ACCELEROMETER_GYRO_STANDBY_ENABLED the gyro, which draws most of the
+ * sensor's current, goes on standby after ACCELEROMETER_MOTION_QUIET_MS
+ * without activity. The accelerometer keeps sampling at the full rate, so a
+ * knock is seen from its first sample and wakes the gyro again. While
+ * disabled the sensor sleeps and the task blocks on its control queue.
  *
  * @param pvParameters Unused.
  */
 static void accelerometer_task_handler(void *)
 {
-    esp_err_t esp_ret;
-    BaseType_t rtos_ret;
+    accelerometer_mode_t mode = enter_mode(ACCELEROMETER_MODE_SAMPLING);
 
-    bool enabled = true;
     for (;;)
     {
         message_t message;
-        rtos_ret = xQueueReceive(queue_handle_accelerometer, &message, 0);
-
-        if (rtos_ret == pdTRUE)
+        const TickType_t control_timeout = mode == ACCELEROMETER_MODE_DISABLED ? portMAX_DELAY : 0;
+        if (event_bus_receive(control_subscription, &message, control_timeout))
         {
             ESP_LOGD(TAG, "Received message type \"%s\" from component \"%s\"", queue_message_type_to_name(message.type), queue_component_to_name(message.component));
             switch (message.type)
             {
             case MESSAGE_TYPE_ENABLE:
-                ESP_LOGD(TAG, "Set enabled flag to true.");
-                enabled = true;
+                // Also drops what piled up in the FIFO while disabled.
+                mode = enter_mode(ACCELEROMETER_MODE_SAMPLING);
                 break;
 
             case MESSAGE_TYPE_DISABLE:
-                ESP_LOGD(TAG, "Set enabled flag to false.");
-                enabled = false;
+                mode = enter_mode(ACCELEROMETER_MODE_DISABLED);
                 break;
 
             default:
@@ -74,87 +643,34 @@ static void accelerometer_task_handler(void *)
             }
         }
 
-        if (enabled)
+        switch (mode)
         {
-            mpu6050_acceleration_t acceleration;
-            mpu6050_rotation_t rotation;
+        case ACCELEROMETER_MODE_DISABLED:
+            break;
 
-            esp_ret = mpu6050_get_motion(&device_descriptor, &acceleration, &rotation);
-            if (esp_ret != ESP_OK)
+        case ACCELEROMETER_MODE_SAMPLING:
+        default:
+            if (ACCELEROMETER_FIFO_ENABLED)
             {
-                ESP_LOGE(TAG, "Failed to get motion: %s", esp_err_to_name(esp_ret));
-                // do anything else?
+                read_fifo_burst();
             }
-
-            const float acceleration_sum = vec3_sum(acceleration.x, acceleration.y, acceleration.z);
-            const float rotation_sum = vec3_sum(rotation.x, rotation.y, rotation.z);
-
-            if (acceleration_sum > ACCELERATION_THREASHOLD_ACCELERATION || rotation_sum > ACCELERATION_THREASHOLD_ROTATION)
+            else
             {
-                const message_t alarm_message = {
-                    .component = COMPONENT_ACCELEROMETER,
-                    .type = MESSAGE_TYPE_SENSOR_TRIGGERED,
-                };
-                xQueueSendToBack(queue_handle_task_orchastrator, &alarm_message, portMAX_DELAY);
+                poll_sample();
             }
 
-            const metric_t metric_acceleration_x = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_X,
-                .timestamp = time(NULL),
-                .float_value = acceleration.x,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_acceleration_x, 0);
-            const metric_t metric_acceleration_y = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y,
-                .timestamp = time(NULL),
-                .float_value = acceleration.y,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_acceleration_y, 0);
-            const metric_t metric_acceleration_z = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z,
-                .timestamp = time(NULL),
-                .float_value = acceleration.z,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_acceleration_z, 0);
-            const metric_t metric_acceleration_total = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL,
-                .timestamp = time(NULL),
-                .float_value = acceleration_sum,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_acceleration_total, 0);
-            const metric_t metric_rotation_x = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ROTATION_X,
-                .timestamp = time(NULL),
-                .float_value = rotation.x,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_rotation_x, 0);
-            const metric_t metric_rotation_y = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ROTATION_Y,
-                .timestamp = time(NULL),
-                .float_value = rotation.y,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_rotation_y, 0);
-            const metric_t metric_rotation_z = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ROTATION_Z,
-                .timestamp = time(NULL),
-                .float_value = rotation.z,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_rotation_z, 0);
-            const metric_t metric_rotation_total = {
-                .metric_type = METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL,
-                .timestamp = time(NULL),
-                .float_value = rotation_sum,
-            };
-            xQueueSendToBack(queue_handle_metrics, &metric_rotation_total, 0);
+            if (ACCELEROMETER_GYRO_STANDBY_ENABLED)
+            {
+                update_gyro_standby();
+            }
+            break;
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
 esp_err_t accelerometer_init(void)
 {
     esp_err_t esp_ret;
-    BaseType_t rtos_ret;
     esp_err_t cleanup_ret;
 
     ESP_LOGI(TAG, "Intializing i2cdev...");
@@ -204,17 +720,104 @@ esp_err_t accelerometer_init(void)
         goto cleanup_device_descriptor;
     }
 
+    ESP_LOGI(TAG, "Subscribing to sensor control...");
+    esp_ret = event_bus_subscribe(EVENT_BUS_TOPIC_SENSOR_CONTROL, APP_RESOURCES_QUEUE_ACCELEROMETER_CONTROL, EVENT_BUS_POLICY_BLOCK, &control_subscription);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to subscribe to sensor control: %s", esp_err_to_name(esp_ret));
+        goto cleanup_device_descriptor;
+    }
+
+    const accelerometer_monitor_config_t monitor_config = {
+        .gravity_filter_alpha = ACCELEROMETER_GRAVITY_FILTER_ALPHA,
+        .rotation_threshold_dps = ACCELERATION_THREASHOLD_ROTATION,
+        .quiet_level = ACCELEROMETER_MOTION_QUIET_LEVEL,
+        .quiet_us = ACCELEROMETER_GYRO_STANDBY_ENABLED ? ACCELEROMETER_MOTION_QUIET_MS * 1000LL : 0,
+        .gyro_settle_us = ACCELEROMETER_GYRO_SETTLE_MS * 1000LL,
+        .vibration = {
+            .sample_rate_hz = ACCELEROMETER_SAMPLE_RATE_HZ,
+            .window_samples = ACCELEROMETER_VIBRATION_WINDOW_SAMPLES,
+            .crossing_deadband_g = ACCELEROMETER_VIBRATION_DEADBAND_G,
+            .knock_peak_to_peak_g = ACCELEROMETER_KNOCK_PEAK_TO_PEAK_G,
+            .knock_jerk_g_per_s = ACCELEROMETER_KNOCK_JERK_G_PER_S,
+            .knock_crest_factor = ACCELEROMETER_KNOCK_CREST_FACTOR,
+            .sustained_rms_g = ACCELEROMETER_SUSTAINED_RMS_G,
+            .sustained_crossing_rate_hz = ACCELEROMETER_SUSTAINED_CROSSING_RATE_HZ,
+        },
+        .trigger = {
+            .trigger_threshold = 1.0f,
+            .release_threshold = ACCELEROMETER_TRIGGER_RELEASE_RATIO * ACCELEROMETER_TRIGGER_RELEASE_RATIO,
+            .debounce_us = ACCELEROMETER_TRIGGER_DEBOUNCE_MS * 1000LL,
+            .hold_off_us = ACCELEROMETER_TRIGGER_HOLD_OFF_MS * 1000LL,
+        },
+    };
+    accelerometer_monitor_init(&monitor, &monitor_config, esp_timer_get_time());
+
+    ESP_LOGI(TAG, "Registering metrics ring...");
+    spsc_ring_init(&metrics_ring, metrics_ring_buffer, ACCELEROMETER_METRICS_RING_SIZE);
+    esp_ret = metrics_publisher_register_ring(&metrics_ring, "ring/accel");
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register metrics ring: %s", esp_err_to_name(esp_ret));
+        goto cleanup_control_subscription;
+    }
+
+    ESP_LOGI(TAG, "Registering sampling scheduler...");
+    esp_ret = sampling_scheduler_register(&sampling_scheduler, "accel", ACCELEROMETER_RELEASE_PERIOD_MS);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register sampling scheduler: %s", esp_err_to_name(esp_ret));
+        goto cleanup_metrics_ring;
+    }
+
+    if (ACCELEROMETER_FIFO_ENABLED)
+    {
+        esp_ret = fifo_read_scales();
+        if (esp_ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read full scale ranges: %s", esp_err_to_name(esp_ret));
+            goto cleanup_sampling_scheduler;
+        }
+    }
+
+    if (ACCELEROMETER_FIFO_ENABLED)
+    {
+        ESP_LOGI(TAG, "Setting up interrupt...");
+        esp_ret = gpio_interrupt_attach(ACCELEROMETER_GPIO_INT, GPIO_INTR_POSEDGE, interrupt_isr_handler, NULL);
+        if (esp_ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to set up interrupt: %s", esp_err_to_name(esp_ret));
+            goto cleanup_sampling_scheduler;
+        }
+    }
+
     ESP_LOGI(TAG, "Initializing task...");
-    rtos_ret = xTaskCreate(accelerometer_task_handler, "Accelerometer", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &task_handle);
-    if (rtos_ret != pdPASS)
+    task_handle = app_resources_create_task(APP_RESOURCES_TASK_ACCELEROMETER, accelerometer_task_handler);
+    if (task_handle == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create task with error code %d", rtos_ret);
+        ESP_LOGE(TAG, "Failed to create task.");
         esp_ret = ESP_FAIL;
-        goto cleanup_device_descriptor;
+        goto cleanup_interrupt;
     }
 
     return ESP_OK;
 
+cleanup_interrupt:
+    if (ACCELEROMETER_FIFO_ENABLED)
+    {
+        ESP_LOGI(TAG, "Removing interrupt...");
+        gpio_interrupt_detach(ACCELEROMETER_GPIO_INT);
+    }
+cleanup_sampling_scheduler:
+    ESP_LOGI(TAG, "Unregistering sampling scheduler...");
+    sampling_scheduler_unregister(&sampling_scheduler);
+cleanup_metrics_ring:
+    ESP_LOGI(TAG, "Unregistering metrics ring...");
+    metrics_publisher_unregister_ring(&metrics_ring);
+cleanup_control_subscription:
+    ESP_LOGI(TAG, "Unsubscribing from sensor control...");
+    event_bus_unsubscribe(control_subscription);
+    control_subscription = NULL;
 cleanup_device_descriptor:
     ESP_LOGI(TAG, "Freeing device descriptor...");
     cleanup_ret = mpu6050_free_desc(&device_descriptor);
@@ -235,6 +838,28 @@ esp_err_t accelerometer_deinit(void)
     vTaskDelete(task_handle);
     task_handle = NULL;
 
+    ESP_LOGI(TAG, "Putting sensor to sleep...");
+    ret = sensor_sleep();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to put sensor to sleep: %s", esp_err_to_name(ret));
+    }
+
+    if (ACCELEROMETER_FIFO_ENABLED)
+    {
+        gpio_interrupt_detach(ACCELEROMETER_GPIO_INT);
+    }
+
+    ESP_LOGI(TAG, "Unregistering sampling scheduler...");
+    sampling_scheduler_unregister(&sampling_scheduler);
+
+    ESP_LOGI(TAG, "Unregistering metrics ring...");
+    metrics_publisher_unregister_ring(&metrics_ring);
+
+    ESP_LOGI(TAG, "Unsubscribing from sensor control...");
+    event_bus_unsubscribe(control_subscription);
+    control_subscription = NULL;
+
     ESP_LOGI(TAG, "Freeing device descriptor...");
     ret = mpu6050_free_desc(&device_descriptor);
     if (ret != ESP_OK)
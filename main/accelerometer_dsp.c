@@ -0,0 +1,95 @@
+#include "accelerometer_dsp.h"
+
+#if __has_include(<dsps_mul.h>) && __has_include(<dsps_add.h>)
+#include <dsps_add.h>
+#include <dsps_mul.h>
+#define ACCELEROMETER_DSP_USE_ESP_DSP 1
+#else
+#define ACCELEROMETER_DSP_USE_ESP_DSP 0
+#endif
+
+/* Samples processed per esp-dsp call, bounds the scratch buffer on the stack. */
+#define ACCELEROMETER_DSP_CHUNK_SIZE 32
+
+void accelerometer_dsp_squared_magnitude_f32(const float *x, const float *y, const float *z, float *squared_magnitudes, size_t count)
+{
+#if ACCELEROMETER_DSP_USE_ESP_DSP
+    float squares[ACCELEROMETER_DSP_CHUNK_SIZE];
+    for (size_t offset = 0; offset < count; offset += ACCELEROMETER_DSP_CHUNK_SIZE)
+    {
+        const int length = count - offset < ACCELEROMETER_DSP_CHUNK_SIZE ? count - offset : ACCELEROMETER_DSP_CHUNK_SIZE;
+        float *out = &squared_magnitudes[offset];
+        dsps_mul_f32(&x[offset], &x[offset], out, length, 1, 1, 1);
+        dsps_mul_f32(&y[offset], &y[offset], squares, length, 1, 1, 1);
+        dsps_add_f32(out, squares, out, length, 1, 1, 1);
+        dsps_mul_f32(&z[offset], &z[offset], squares, length, 1, 1, 1);
+        dsps_add_f32(out, squares, out, length, 1, 1, 1);
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+        squared_magnitudes[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+    }
+#endif
+}
+
+void accelerometer_dsp_squared_magnitude_s16(const int16_t *x, const int16_t *y, const int16_t *z, uint32_t *squared_magnitudes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        // Each square fits in 31 bits, so only the sum needs unsigned arithmetic.
+        squared_magnitudes[i] = (uint32_t)(x[i] * x[i]) + (uint32_t)(y[i] * y[i]) + (uint32_t)(z[i] * z[i]);
+    }
+}
+
+void accelerometer_dsp_gravity_filter_init(accelerometer_dsp_gravity_filter_t *filter, float alpha)
+{
+    filter->gravity_x = 0;
+    filter->gravity_y = 0;
+    filter->gravity_z = 0;
+    filter->alpha = alpha;
+    filter->primed = false;
+}
+
+void accelerometer_dsp_remove_gravity_f32(accelerometer_dsp_gravity_filter_t *filter, float *x, float *y, float *z, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (!filter->primed)
+    {
+        filter->gravity_x = x[0];
+        filter->gravity_y = y[0];
+        filter->gravity_z = z[0];
+        filter->primed = true;
+    }
+
+    // The filter is recursive, so it runs per sample with the state kept in registers.
+    const float alpha = filter->alpha;
+    float gravity_x = filter->gravity_x;
+    float gravity_y = filter->gravity_y;
+    float gravity_z = filter->gravity_z;
+    for (size_t i = 0; i < count; i++)
+    {
+        gravity_x += alpha * (x[i] - gravity_x);
+        gravity_y += alpha * (y[i] - gravity_y);
+        gravity_z += alpha * (z[i] - gravity_z);
+        x[i] -= gravity_x;
+        y[i] -= gravity_y;
+        z[i] -= gravity_z;
+    }
+    filter->gravity_x = gravity_x;
+    filter->gravity_y = gravity_y;
+    filter->gravity_z = gravity_z;
+}
+
+size_t accelerometer_dsp_count_above_f32(const float *values, size_t count, float threshold)
+{
+    size_t above = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        above += values[i] > threshold;
+    }
+    return above;
+}
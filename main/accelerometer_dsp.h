@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Block kernels for accelerometer and gyro samples.
+ *
+ * Every kernel processes a block of samples stored as one array per axis.
+ * Float kernels use esp-dsp when the component is part of the build and
+ * portable C otherwise, so they also run on the host.
+ */
+
+/**
+ * @brief State of the gravity removal filter of one sensor.
+ *
+ * Gravity is tracked with a first order low pass per axis and subtracted
+ * from every sample, which makes the output a first order high pass.
+ */
+typedef struct
+{
+    float gravity_x;
+    float gravity_y;
+    float gravity_z;
+    float alpha;
+    bool primed;
+} accelerometer_dsp_gravity_filter_t;
+
+/**
+ * @brief Computes x^2 + y^2 + z^2 of float samples.
+ *
+ * @param x X components.
+ * @param y Y components.
+ * @param z Z components.
+ * @param squared_magnitudes Output, may not alias the inputs.
+ * @param count Number of samples.
+ */
+void accelerometer_dsp_squared_magnitude_f32(const float *x, const float *y, const float *z, float *squared_magnitudes, size_t count);
+
+/**
+ * @brief Computes x^2 + y^2 + z^2 of raw sensor readings in exact integer arithmetic.
+ *
+ * The result is in LSB^2 and cannot overflow, as 3 * 32768^2 fits in 32 bits.
+ *
+ * @param x X components.
+ * @param y Y components.
+ * @param z Z components.
+ * @param squared_magnitudes Output.
+ * @param count Number of samples.
+ */
+void accelerometer_dsp_squared_magnitude_s16(const int16_t *x, const int16_t *y, const int16_t *z, uint32_t *squared_magnitudes, size_t count);
+
+/**
+ * @brief Sets up a gravity removal filter.
+ *
+ * The first filtered sample primes the gravity estimate, so the output
+ * starts at zero instead of at the full gravity vector.
+ *
+ * @param filter Filter to initialize.
+ * @param alpha Low pass coefficient between 0 and 1, smaller tracks gravity more slowly.
+ */
+void accelerometer_dsp_gravity_filter_init(accelerometer_dsp_gravity_filter_t *filter, float alpha);
+
+/**
+ * @brief Removes gravity from a block of acceleration samples in place.
+ *
+ * @param filter Filter state, carried over between blocks.
+ * @param x X components.
+ * @param y Y components.
+ * @param z Z components.
+ * @param count Number of samples.
+ */
+void accelerometer_dsp_remove_gravity_f32(accelerometer_dsp_gravity_filter_t *filter, float *x, float *y, float *z, size_t count);
+
+/**
+ * @brief Counts the values above a threshold.
+ *
+ * @param values Values to test.
+ * @param count Number of values.
+ * @param threshold Threshold, values equal to it are not counted.
+ *
+ * @return Number of values above the threshold.
+ */
+size_t accelerometer_dsp_count_above_f32(const float *values, size_t count, float threshold);
@@ -0,0 +1,86 @@
+#include "accelerometer_monitor.h"
+
+#include <math.h>
+#include <string.h>
+
+void accelerometer_monitor_init(accelerometer_monitor_t *monitor, const accelerometer_monitor_config_t *config, int64_t now_us)
+{
+    monitor->config = *config;
+    vibration_detector_init(&monitor->vibration_detector, &config->vibration);
+    trigger_detector_init(&monitor->trigger_detector, &config->trigger);
+    accelerometer_monitor_restart(monitor, now_us);
+}
+
+void accelerometer_monitor_restart(accelerometer_monitor_t *monitor, int64_t now_us)
+{
+    accelerometer_dsp_gravity_filter_init(&monitor->gravity_filter, monitor->config.gravity_filter_alpha);
+    vibration_detector_reset(&monitor->vibration_detector);
+    trigger_detector_reset(&monitor->trigger_detector);
+    monitor->last_activity_us = now_us;
+    monitor->gyro_standby = false;
+    monitor->rotation_valid_from_us = now_us;
+}
+
+size_t accelerometer_monitor_process(accelerometer_monitor_t *monitor, const float *acceleration_x, const float *acceleration_y, const float *acceleration_z, const float *rotation_squared,
+                                     const int64_t *timestamp_us, size_t count, int64_t *trigger_timestamps_us)
+{
+    const float rotation_scale = 1.0f / (monitor->config.rotation_threshold_dps * monitor->config.rotation_threshold_dps);
+    float linear_x[ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES];
+    float linear_y[ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES];
+    float linear_z[ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES];
+    float trigger_levels[ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES];
+
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (count > ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES)
+    {
+        count = ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES;
+    }
+
+    memcpy(linear_x, acceleration_x, count * sizeof(float));
+    memcpy(linear_y, acceleration_y, count * sizeof(float));
+    memcpy(linear_z, acceleration_z, count * sizeof(float));
+    accelerometer_dsp_remove_gravity_f32(&monitor->gravity_filter, linear_x, linear_y, linear_z, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const float vibration_level = vibration_detector_update(&monitor->vibration_detector, linear_x[i], linear_y[i], linear_z[i]);
+        const float rotation_level = accelerometer_monitor_rotation_valid(monitor, timestamp_us[i]) ? rotation_squared[i] * rotation_scale : 0;
+        trigger_levels[i] = fmaxf(vibration_level * vibration_level, rotation_level);
+    }
+
+    trigger_detector_t *detector = &monitor->trigger_detector;
+    if (detector->state != TRIGGER_DETECTOR_STATE_IDLE || accelerometer_dsp_count_above_f32(trigger_levels, count, monitor->config.quiet_level * monitor->config.quiet_level) > 0)
+    {
+        monitor->last_activity_us = timestamp_us[count - 1];
+    }
+
+    // An idle detector ignores everything up to the trigger level, so quiet blocks skip it entirely.
+    size_t trigger_count = 0;
+    if (detector->state != TRIGGER_DETECTOR_STATE_IDLE || accelerometer_dsp_count_above_f32(trigger_levels, count, 1.0f) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (trigger_detector_update(detector, trigger_levels[i], timestamp_us[i]))
+            {
+                trigger_timestamps_us[trigger_count++] = timestamp_us[i];
+            }
+        }
+    }
+    return trigger_count;
+}
+
+bool accelerometer_monitor_rotation_valid(const accelerometer_monitor_t *monitor, int64_t timestamp_us) { return timestamp_us >= monitor->rotation_valid_from_us; }
+
+bool accelerometer_monitor_gyro_needed(const accelerometer_monitor_t *monitor, int64_t now_us)
+{
+    return monitor->config.quiet_us == 0 || now_us - monitor->last_activity_us <= monitor->config.quiet_us || monitor->trigger_detector.state != TRIGGER_DETECTOR_STATE_IDLE;
+}
+
+void accelerometer_monitor_set_gyro_standby(accelerometer_monitor_t *monitor, bool standby, int64_t now_us)
+{
+    monitor->gyro_standby = standby;
+    // Samples are not rotation tested from the standby on, and only again once the gyro has settled.
+    monitor->rotation_valid_from_us = standby ? INT64_MAX : now_us + monitor->config.gyro_settle_us;
+}
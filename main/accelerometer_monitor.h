@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "accelerometer_dsp.h"
+#include "trigger_detector.h"
+#include "vibration_detector.h"
+
+/* Largest block of samples processed at once. */
+#define ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES 32
+
+/**
+ * @brief Tuning of an accelerometer monitor.
+ *
+ * The trigger level is the larger of the squared vibration level and the
+ * squared rotation relative to rotation_threshold_dps, so 1.0 is the
+ * trigger threshold. Below quiet_level the sensor counts as quiet, and
+ * after quiet_us of quiet the gyro is not needed any more. A quiet_us of 0
+ * keeps the gyro running. A woken gyro takes gyro_settle_us to measure
+ * again.
+ */
+typedef struct
+{
+    float gravity_filter_alpha;
+    float rotation_threshold_dps;
+    float quiet_level;
+    int64_t quiet_us;
+    int64_t gyro_settle_us;
+    vibration_detector_config_t vibration;
+    trigger_detector_config_t trigger;
+} accelerometer_monitor_config_t;
+
+/**
+ * @brief Turns a continuous stream of accelerometer and gyro samples into
+ * triggers, and decides when the gyro may be put on standby.
+ *
+ * The accelerometer never stops, so the detectors see every sample across
+ * the gyro standby and wakeup. Rotation is ignored while the gyro is on
+ * standby and until it has settled after waking.
+ */
+typedef struct
+{
+    accelerometer_monitor_config_t config;
+    accelerometer_dsp_gravity_filter_t gravity_filter;
+    vibration_detector_t vibration_detector;
+    trigger_detector_t trigger_detector;
+    int64_t last_activity_us;
+    bool gyro_standby;
+    int64_t rotation_valid_from_us;
+} accelerometer_monitor_t;
+
+/**
+ * @brief Sets up a monitor and starts it as accelerometer_monitor_restart() does.
+ *
+ * @param monitor Monitor to initialize.
+ * @param config Tuning, copied into the monitor.
+ * @param now_us Time the sensor starts sampling, in microseconds since boot.
+ */
+void accelerometer_monitor_init(accelerometer_monitor_t *monitor, const accelerometer_monitor_config_t *config, int64_t now_us);
+
+/**
+ * @brief Starts over on a new stream of samples, once the sensor was woken up and its gyro has settled.
+ *
+ * @param monitor Monitor to restart.
+ * @param now_us Time the sensor starts sampling, in microseconds since boot.
+ */
+void accelerometer_monitor_restart(accelerometer_monitor_t *monitor, int64_t now_us);
+
+/**
+ * @brief Runs trigger detection on a block of samples.
+ *
+ * @param monitor Monitor to update.
+ * @param acceleration_x Acceleration in g including gravity, the same for y and z.
+ * @param acceleration_y
+ * @param acceleration_z
+ * @param rotation_squared Squared magnitude of the rotation in dps², only used where accelerometer_monitor_rotation_valid().
+ * @param timestamp_us Time of each sample in microseconds since boot.
+ * @param count Number of samples, at most ACCELEROMETER_MONITOR_MAX_BLOCK_SAMPLES.
+ * @param trigger_timestamps_us Receives the time of every sample that starts a trigger episode, room for count.
+ *
+ * @return Number of triggers written to trigger_timestamps_us.
+ */
+size_t accelerometer_monitor_process(accelerometer_monitor_t *monitor, const float *acceleration_x, const float *acceleration_y, const float *acceleration_z, const float *rotation_squared,
+                                     const int64_t *timestamp_us, size_t count, int64_t *trigger_timestamps_us);
+
+/**
+ * @brief Tells whether the gyro measured a sample.
+ *
+ * @param monitor Monitor to ask.
+ * @param timestamp_us Time of the sample.
+ *
+ * @return false while the gyro is on standby or still settling.
+ */
+bool accelerometer_monitor_rotation_valid(const accelerometer_monitor_t *monitor, int64_t timestamp_us);
+
+/**
+ * @brief Tells whether the gyro has to run.
+ *
+ * @param monitor Monitor to ask.
+ * @param now_us Current time in microseconds since boot.
+ *
+ * @return true while there was activity within quiet_us, or a trigger episode is running.
+ */
+bool accelerometer_monitor_gyro_needed(const accelerometer_monitor_t *monitor, int64_t now_us);
+
+/**
+ * @brief Records that the gyro was put on standby or woken up.
+ *
+ * @param monitor Monitor to update.
+ * @param standby Whether the gyro is on standby now.
+ * @param now_us Time of the change, in microseconds since boot.
+ */
+void accelerometer_monitor_set_gyro_standby(accelerometer_monitor_t *monitor, bool standby, int64_t now_us);
@@ -1,14 +0,0 @@
-#pragma once
-/**
- * @brief Default FreeRTOS task stack size used across the application.
- *
- * Defines the stack size (in bytes) allocated for created tasks.
- */
-
-#define APP_CONFIG_TASK_STACK_SIZE 8192
-/**
- * @brief Default queue capacity used across the application.
- *
- * Defines the maximum number of items that can be stored in application queues.
- */
-#define APP_CONFIG_QUEUE_SIZE_ITEMS 16
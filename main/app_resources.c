@@ -0,0 +1,155 @@
+#include "app_resources.h"
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <stdint.h>
+
+#include "event_bus.h"
+
+static const char *TAG = "app resources";
+
+/* Wifi and lwIP run on core 0, so the uplink stays there and the sensor and alarm path gets the other core. */
+#define APP_RESOURCES_CORE_NETWORK 0
+#define APP_RESOURCES_CORE_REALTIME (portNUM_PROCESSORS > 1 ? 1 : 0)
+
+typedef struct
+{
+    const char *name;
+    StackType_t *stack;
+    uint32_t stack_size;
+    UBaseType_t priority;
+    BaseType_t core_id;
+} task_resource_t;
+
+typedef struct
+{
+    const char *name;
+    uint8_t *storage;
+    size_t depth;
+    size_t item_size;
+} queue_resource_t;
+
+#define APP_RESOURCES_TASK(task_name, stack_buffer, task_priority, task_core_id) \
+    {                                                                           \
+        .name = task_name,                                                      \
+        .stack = stack_buffer,                                                  \
+        .stack_size = sizeof(stack_buffer),                                     \
+        .priority = task_priority,                                              \
+        .core_id = task_core_id,                                                \
+    }
+
+#define APP_RESOURCES_QUEUE(queue_name, storage_buffer)              \
+    {                                                                \
+        .name = queue_name,                                          \
+        .storage = &storage_buffer[0][0],                            \
+        .depth = sizeof(storage_buffer) / sizeof(storage_buffer[0]), \
+        .item_size = sizeof(storage_buffer[0]),                      \
+    }
+
+/*
+ * Task stacks in bytes. They keep the 8 KB every task had on the heap until the high water marks
+ * app_resources_log_stack_usage() reports on hardware justify less, with at least 1 KB to spare.
+ */
+static StackType_t task_orchastrator_stack[8192];
+static StackType_t accelerometer_stack[8192];
+static StackType_t time_of_flight_stack[8192];
+static StackType_t card_reader_stack[8192];
+static StackType_t buzzer_stack[8192];
+static StackType_t buzzer_alarm_stack[8192];
+static StackType_t metrics_collector_stack[8192];
+static StackType_t metrics_transmit_stack[8192];
+
+static StaticTask_t task_buffers[APP_RESOURCES_TASK_COUNT];
+static TaskHandle_t task_handles[APP_RESOURCES_TASK_COUNT];
+
+/* Security events are handled first, sensors are sampled next, and telemetry only gets the remaining time. */
+static const task_resource_t task_resources[APP_RESOURCES_TASK_COUNT] = {
+    [APP_RESOURCES_TASK_TASK_ORCHASTRATOR] = APP_RESOURCES_TASK("Task Orchastrator", task_orchastrator_stack, 5, APP_RESOURCES_CORE_REALTIME),
+    [APP_RESOURCES_TASK_ACCELEROMETER] = APP_RESOURCES_TASK("Accelerometer", accelerometer_stack, 3, APP_RESOURCES_CORE_REALTIME),
+    [APP_RESOURCES_TASK_TIME_OF_FLIGHT] = APP_RESOURCES_TASK("Time of Flight", time_of_flight_stack, 3, APP_RESOURCES_CORE_REALTIME),
+    [APP_RESOURCES_TASK_CARD_READER] = APP_RESOURCES_TASK("Card Reader", card_reader_stack, 4, APP_RESOURCES_CORE_REALTIME),
+    [APP_RESOURCES_TASK_BUZZER] = APP_RESOURCES_TASK("Buzzer", buzzer_stack, 4, APP_RESOURCES_CORE_REALTIME),
+    [APP_RESOURCES_TASK_BUZZER_ALARM] = APP_RESOURCES_TASK("Buzzer Alarm", buzzer_alarm_stack, 4, APP_RESOURCES_CORE_REALTIME),
+    [APP_RESOURCES_TASK_METRICS_COLLECTOR] = APP_RESOURCES_TASK("Metrics publisher", metrics_collector_stack, 2, APP_RESOURCES_CORE_NETWORK),
+    [APP_RESOURCES_TASK_METRICS_TRANSMIT] = APP_RESOURCES_TASK("Metrics transmit", metrics_transmit_stack, 1, APP_RESOURCES_CORE_NETWORK),
+};
+
+/* Queue storage as [depth][item size]. */
+static uint8_t security_events_storage[16][EVENT_BUS_MESSAGE_ITEM_SIZE];
+static uint8_t accelerometer_control_storage[4][EVENT_BUS_MESSAGE_ITEM_SIZE];
+static uint8_t time_of_flight_control_storage[4][EVENT_BUS_MESSAGE_ITEM_SIZE];
+static uint8_t buzzer_storage[8][EVENT_BUS_MESSAGE_ITEM_SIZE];
+static uint8_t buzzer_alarm_storage[8][sizeof(int)]; /* alarm_queue_message_t */
+static uint8_t metrics_storage[128][EVENT_BUS_METRIC_ITEM_SIZE];
+static uint8_t metrics_critical_storage[16][EVENT_BUS_METRIC_ITEM_SIZE];
+/* The batch queues must hold every batch of the metrics publisher. */
+static uint8_t free_batches_storage[3][sizeof(void *)];
+static uint8_t ready_batches_storage[3][sizeof(void *)];
+
+static StaticQueue_t queue_buffers[APP_RESOURCES_QUEUE_COUNT];
+
+static const queue_resource_t queue_resources[APP_RESOURCES_QUEUE_COUNT] = {
+    [APP_RESOURCES_QUEUE_SECURITY_EVENTS] = APP_RESOURCES_QUEUE("security", security_events_storage),
+    [APP_RESOURCES_QUEUE_ACCELEROMETER_CONTROL] = APP_RESOURCES_QUEUE("ctl/accel", accelerometer_control_storage),
+    [APP_RESOURCES_QUEUE_TIME_OF_FLIGHT_CONTROL] = APP_RESOURCES_QUEUE("ctl/tof", time_of_flight_control_storage),
+    [APP_RESOURCES_QUEUE_BUZZER] = APP_RESOURCES_QUEUE("buzzer", buzzer_storage),
+    [APP_RESOURCES_QUEUE_BUZZER_ALARM] = APP_RESOURCES_QUEUE("alarm", buzzer_alarm_storage),
+    [APP_RESOURCES_QUEUE_METRICS] = APP_RESOURCES_QUEUE("metrics", metrics_storage),
+    [APP_RESOURCES_QUEUE_METRICS_CRITICAL] = APP_RESOURCES_QUEUE("metrics/crt", metrics_critical_storage),
+    [APP_RESOURCES_QUEUE_FREE_BATCHES] = APP_RESOURCES_QUEUE("batch/free", free_batches_storage),
+    [APP_RESOURCES_QUEUE_READY_BATCHES] = APP_RESOURCES_QUEUE("batch/ready", ready_batches_storage),
+};
+
+TaskHandle_t app_resources_create_task(app_resources_task_t task, TaskFunction_t handler)
+{
+    if (task >= APP_RESOURCES_TASK_COUNT)
+    {
+        ESP_LOGE(TAG, "Received invalid task, enum code %d.", task);
+        return NULL;
+    }
+
+    const task_resource_t *resource = &task_resources[task];
+    task_handles[task] = xTaskCreateStaticPinnedToCore(handler, resource->name, resource->stack_size, NULL, resource->priority, resource->stack, &task_buffers[task], resource->core_id);
+    return task_handles[task];
+}
+
+void app_resources_log_stack_usage(void)
+{
+    for (size_t task = 0; task < APP_RESOURCES_TASK_COUNT; task++)
+    {
+        const task_resource_t *resource = &task_resources[task];
+        if (task_handles[task] == NULL)
+        {
+            ESP_LOGI(TAG, "Task \"%s\" was not created, stack of %lu bytes unused.", resource->name, (unsigned long)resource->stack_size);
+            continue;
+        }
+
+        // The high water mark is the least stack that was ever free, in bytes as StackType_t is a byte.
+        const UBaseType_t free_bytes = uxTaskGetStackHighWaterMark(task_handles[task]);
+        ESP_LOGI(TAG, "Task \"%s\" used at most %lu of %lu stack bytes, %lu free.", resource->name, (unsigned long)(resource->stack_size - free_bytes), (unsigned long)resource->stack_size, (unsigned long)free_bytes);
+    }
+}
+
+QueueHandle_t app_resources_create_queue(app_resources_queue_t queue, size_t item_size)
+{
+    if (queue >= APP_RESOURCES_QUEUE_COUNT)
+    {
+        ESP_LOGE(TAG, "Received invalid queue, enum code %d.", queue);
+        return NULL;
+    }
+
+    const queue_resource_t *resource = &queue_resources[queue];
+    if (item_size > resource->item_size)
+    {
+        ESP_LOGE(TAG, "Queue \"%s\" holds items of %zu bytes, %zu requested.", resource->name, resource->item_size, item_size);
+        return NULL;
+    }
+
+    return xQueueCreateStatic(resource->depth, item_size, resource->storage, &queue_buffers[queue]);
+}
+
+size_t app_resources_queue_depth(app_resources_queue_t queue) { return queue_resources[queue].depth; }
+
+const char *app_resources_queue_name(app_resources_queue_t queue) { return queue_resources[queue].name; }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <stddef.h>
+
+/**
+ * @brief Every FreeRTOS task of the application.
+ *
+ * Stack size, priority and core of each task are fixed in the resource table
+ * in app_resources.c, and their stacks are allocated statically.
+ */
+typedef enum
+{
+    APP_RESOURCES_TASK_TASK_ORCHASTRATOR,
+    APP_RESOURCES_TASK_ACCELEROMETER,
+    APP_RESOURCES_TASK_TIME_OF_FLIGHT,
+    APP_RESOURCES_TASK_CARD_READER,
+    APP_RESOURCES_TASK_BUZZER,
+    APP_RESOURCES_TASK_BUZZER_ALARM,
+    APP_RESOURCES_TASK_METRICS_COLLECTOR,
+    APP_RESOURCES_TASK_METRICS_TRANSMIT,
+    APP_RESOURCES_TASK_COUNT,
+} app_resources_task_t;
+
+/**
+ * @brief Every FreeRTOS queue of the application.
+ *
+ * Depth and item size of each queue are fixed in the resource table in
+ * app_resources.c, and their storage is allocated statically. Event bus
+ * subscriptions are created from these queues as well.
+ */
+typedef enum
+{
+    APP_RESOURCES_QUEUE_SECURITY_EVENTS,
+    APP_RESOURCES_QUEUE_ACCELEROMETER_CONTROL,
+    APP_RESOURCES_QUEUE_TIME_OF_FLIGHT_CONTROL,
+    APP_RESOURCES_QUEUE_BUZZER,
+    APP_RESOURCES_QUEUE_BUZZER_ALARM,
+    APP_RESOURCES_QUEUE_METRICS,
+    APP_RESOURCES_QUEUE_METRICS_CRITICAL,
+    APP_RESOURCES_QUEUE_FREE_BATCHES,
+    APP_RESOURCES_QUEUE_READY_BATCHES,
+    APP_RESOURCES_QUEUE_COUNT,
+} app_resources_queue_t;
+
+/**
+ * @brief Creates a task from its entry in the resource table.
+ *
+ * The task runs on the stack and control block reserved for it, so each task
+ * can only exist once. It may be created again after it was deleted.
+ *
+ * @param task Task to create.
+ * @param handler Function the task runs, receives NULL as parameter.
+ *
+ * @return Handle of the task, or NULL on failure.
+ */
+TaskHandle_t app_resources_create_task(app_resources_task_t task, TaskFunction_t handler);
+
+/**
+ * @brief Logs the stack high water mark of every task in the resource table.
+ *
+ * Call it once the tasks run, the marks of deleted tasks are not meaningful.
+ */
+void app_resources_log_stack_usage(void);
+
+/**
+ * @brief Creates a queue from its entry in the resource table.
+ *
+ * The queue uses the storage reserved for it, so each queue can only exist
+ * once. It may be created again after it was deleted.
+ *
+ * @param queue Queue to create.
+ * @param item_size Size of one item, must not exceed the item size reserved in the table.
+ *
+ * @return Handle of the queue, or NULL on failure.
+ */
+QueueHandle_t app_resources_create_queue(app_resources_queue_t queue, size_t item_size);
+
+/**
+ * @brief Returns the number of items a queue holds.
+ */
+size_t app_resources_queue_depth(app_resources_queue_t queue);
+
+/**
+ * @brief Returns the short name of a queue, at most 11 characters long.
+ */
+const char *app_resources_queue_name(app_resources_queue_t queue);
@@ -0,0 +1,56 @@
+#include "background_model.h"
+
+#include <math.h>
+
+void background_model_init(background_model_t *model, const background_model_config_t *config)
+{
+    model->config = *config;
+    background_model_reset(model);
+}
+
+void background_model_reset(background_model_t *model)
+{
+    model->sample_count = 0;
+    model->mean = 0.0f;
+    model->variance = 0.0f;
+}
+
+bool background_model_learned(const background_model_t *model) { return model->sample_count >= model->config.learning_samples; }
+
+float background_model_stddev(const background_model_t *model) { return background_model_learned(model) ? sqrtf(model->variance) : 0.0f; }
+
+float background_model_update(background_model_t *model, float value)
+{
+    const background_model_config_t *config = &model->config;
+
+    if (!background_model_learned(model))
+    {
+        // Welford's algorithm, the scene is weighted evenly while it is learned.
+        model->sample_count++;
+        const float delta = value - model->mean;
+        model->mean += delta / model->sample_count;
+        model->variance += delta * (value - model->mean);
+        if (background_model_learned(model))
+        {
+            model->variance /= model->sample_count;
+        }
+        return 0.0f;
+    }
+
+    const float difference = value - model->mean;
+    const float allowed = fmaxf(config->sensitivity * sqrtf(model->variance), config->min_deviation);
+    const float score = fabsf(difference) / allowed;
+
+    if (score > 1.0f)
+    {
+        // A deviating sample would inflate the variance until the deviation no longer counts, so it only drags the mean.
+        model->mean += config->foreground_alpha * difference;
+        return score;
+    }
+
+    // Exponentially weighted mean and variance, see Finch, "Incremental calculation of weighted mean and variance".
+    model->mean += config->alpha * difference;
+    model->variance = (1.0f - config->alpha) * (model->variance + config->alpha * difference * difference);
+
+    return score;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Tuning of a background model.
+ *
+ * The model first learns the mean and variance of the static scene from
+ * learning_samples samples. Afterwards it tracks slow drift of the scene with
+ * an exponentially weighted mean and variance. A sample deviates once it is
+ * further from the mean than sensitivity standard deviations, and at least
+ * min_deviation, which keeps a very steady scene from reacting to noise.
+ * Deviating samples only move the mean, with the much smaller
+ * foreground_alpha, so an intruder is not learned as background, while an
+ * object that stays, like a moved chair, is eventually.
+ */
+typedef struct
+{
+    uint16_t learning_samples;
+    float alpha;
+    float foreground_alpha;
+    float sensitivity;
+    float min_deviation;
+} background_model_config_t;
+
+/**
+ * @brief Adaptive model of the value a sensor sees in an empty scene.
+ *
+ * Every update runs in constant time and memory.
+ */
+typedef struct
+{
+    background_model_config_t config;
+    uint32_t sample_count;
+    float mean;
+    float variance; /* Sum of squared differences while learning. */
+} background_model_t;
+
+/**
+ * @brief Sets up a model that has not learned anything yet.
+ *
+ * @param model Model to initialize.
+ * @param config Tuning, learning_samples must be at least 1 and both alphas between 0 and 1.
+ */
+void background_model_init(background_model_t *model, const background_model_config_t *config);
+
+/**
+ * @brief Forgets the learned scene, for example when the sensor is armed again.
+ *
+ * @param model Model to reset.
+ */
+void background_model_reset(background_model_t *model);
+
+/**
+ * @brief Feeds one sample into the model.
+ *
+ * @param model Model to update.
+ * @param value Sampled value.
+ *
+ * @return Deviation of the sample relative to the allowed deviation, so 1.0
+ * is where a sample starts to deviate. Always 0 while learning.
+ */
+float background_model_update(background_model_t *model, float value);
+
+/**
+ * @brief Returns true once the model has learned the scene.
+ */
+bool background_model_learned(const background_model_t *model);
+
+/**
+ * @brief Returns the standard deviation of the learned scene.
+ */
+float background_model_stddev(const background_model_t *model);
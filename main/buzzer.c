@@ -7,7 +7,8 @@
 #include <freertos/queue.h>
 #include <freertos/task.h>
 
-#include "app_config.h"
+#include "app_resources.h"
+#include "event_bus.h"
 #include "queue.h"
 
 static const char *TAG = "buzzer";
@@ -19,6 +20,8 @@ static TaskHandle_t alarm_task_handle;
 
 static QueueHandle_t alarm_queue_handle;
 
+static event_bus_subscription_t *buzzer_subscription;
+
 typedef enum alarm_queue_message_t
 {
     ALARM_QUEUE_MESSAGE_START,
@@ -47,7 +50,7 @@ static void log_gpio_set_level(esp_err_t ret)
 
 /**
  * @brief Task handler for buzzer control.
- * Processes messages from the buzzer queue and controls the alarm.
+ * Processes buzzer commands from the event bus and controls the alarm.
  *
  * @param pvParameters Unused.
  */
@@ -57,7 +60,7 @@ static void buzzer_task_handler(void *)
     for (;;)
     {
         message_t incoming_message;
-        xQueueReceive(queue_handle_buzzer, &incoming_message, portMAX_DELAY);
+        event_bus_receive(buzzer_subscription, &incoming_message, portMAX_DELAY);
         ESP_LOGD(TAG, "Received message type \"%s\" from component \"%s\"", queue_message_type_to_name(incoming_message.type), queue_component_to_name(incoming_message.component));
 
         alarm_queue_message_t outgoing_message;
@@ -185,7 +188,6 @@ static void alarm_task_handler(void *)
 esp_err_t buzzer_init(void)
 {
     esp_err_t esp_ret;
-    BaseType_t rtos_ret;
     esp_err_t cleanup_ret;
 
     ESP_LOGI(TAG, "Configuring GPIO...");
@@ -212,27 +214,36 @@ esp_err_t buzzer_init(void)
     }
 
     ESP_LOGI(TAG, "Creating alarm queue...");
-    alarm_queue_handle = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(alarm_queue_message_t));
+    alarm_queue_handle = app_resources_create_queue(APP_RESOURCES_QUEUE_BUZZER_ALARM, sizeof(alarm_queue_message_t));
     if (alarm_queue_handle == NULL)
     {
         ESP_LOGE(TAG, "Failed to initialize alarm queue");
         goto cleanup_gpio;
     }
 
+    ESP_LOGI(TAG, "Subscribing to buzzer commands...");
+    esp_ret = event_bus_subscribe(EVENT_BUS_TOPIC_BUZZER, APP_RESOURCES_QUEUE_BUZZER, EVENT_BUS_POLICY_BLOCK, &buzzer_subscription);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to subscribe to buzzer commands: %s", esp_err_to_name(esp_ret));
+        goto cleanup_alarm_queue;
+    }
+
     ESP_LOGI(TAG, "Creating buzzer task...");
-    rtos_ret = xTaskCreate(buzzer_task_handler, "Buzzer", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &buzzer_task_handle);
-    if (rtos_ret != pdPASS)
+    buzzer_task_handle = app_resources_create_task(APP_RESOURCES_TASK_BUZZER, buzzer_task_handler);
+    if (buzzer_task_handle == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create buzzer task with error code: %d", rtos_ret);
+        ESP_LOGE(TAG, "Failed to create buzzer task.");
         esp_ret = ESP_FAIL;
-        goto cleanup_alarm_queue;
+        goto cleanup_buzzer_subscription;
     }
 
     ESP_LOGI(TAG, "Creating alarm task...");
-    rtos_ret = xTaskCreate(alarm_task_handler, "Buzzer Alarm", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &alarm_task_handle);
-    if (rtos_ret != pdPASS)
+    alarm_task_handle = app_resources_create_task(APP_RESOURCES_TASK_BUZZER_ALARM, alarm_task_handler);
+    if (alarm_task_handle == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create alarm task with error code: %d", rtos_ret);
+        ESP_LOGE(TAG, "Failed to create alarm task.");
+        esp_ret = ESP_FAIL;
         goto cleanup_buzzer_task;
     }
 
@@ -242,6 +253,10 @@ cleanup_buzzer_task:
     ESP_LOGI(TAG, "Deleting buzzer task...");
     vTaskDelete(buzzer_task_handle);
     buzzer_task_handle = NULL;
+cleanup_buzzer_subscription:
+    ESP_LOGI(TAG, "Unsubscribing from buzzer commands...");
+    event_bus_unsubscribe(buzzer_subscription);
+    buzzer_subscription = NULL;
 cleanup_alarm_queue:
     ESP_LOGI(TAG, "Deleting alarm queue...");
     vQueueDelete(alarm_queue_handle);
@@ -270,6 +285,10 @@ esp_err_t buzzer_deinit(void)
     vTaskDelete(buzzer_task_handle);
     buzzer_task_handle = NULL;
 
+    ESP_LOGI(TAG, "Unsubscribing from buzzer commands...");
+    event_bus_unsubscribe(buzzer_subscription);
+    buzzer_subscription = NULL;
+
     ESP_LOGI(TAG, "Deleting alarm queue...");
     vQueueDelete(alarm_queue_handle);
     alarm_queue_handle = NULL;
@@ -0,0 +1,59 @@
+#include "card_frame_parser.h"
+
+#include <ctype.h>
+#include <string.h>
+
+void card_frame_parser_init(card_frame_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+}
+
+void card_frame_parser_reset(card_frame_parser_t *parser)
+{
+    if (parser->in_frame)
+    {
+        parser->rejected++;
+    }
+    parser->in_frame = false;
+    parser->pending_length = 0;
+}
+
+bool card_frame_parser_push(card_frame_parser_t *parser, uint8_t byte)
+{
+    if (byte == CARD_FRAME_PARSER_START)
+    {
+        card_frame_parser_reset(parser);
+        parser->in_frame = true;
+        return false;
+    }
+
+    // Anything between frames is line noise.
+    if (!parser->in_frame)
+    {
+        return false;
+    }
+
+    if (byte == CARD_FRAME_PARSER_END)
+    {
+        if (parser->pending_length != CARD_FRAME_PARSER_ID_LENGTH)
+        {
+            card_frame_parser_reset(parser);
+            return false;
+        }
+        memcpy(parser->id, parser->pending, CARD_FRAME_PARSER_ID_LENGTH);
+        parser->id[CARD_FRAME_PARSER_ID_LENGTH] = '\0';
+        parser->in_frame = false;
+        parser->pending_length = 0;
+        parser->frames++;
+        return true;
+    }
+
+    if (!isxdigit(byte) || parser->pending_length == CARD_FRAME_PARSER_ID_LENGTH)
+    {
+        card_frame_parser_reset(parser);
+        return false;
+    }
+
+    parser->pending[parser->pending_length++] = (char)byte;
+    return false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Frames are 0x0A, the tag ID as ASCII hex digits, 0x0D. */
+#define CARD_FRAME_PARSER_START 0x0A
+#define CARD_FRAME_PARSER_END 0x0D
+#define CARD_FRAME_PARSER_ID_LENGTH 10
+
+/**
+ * @brief Streaming parser for the frames of the RFID reader.
+ *
+ * Bytes are fed one at a time in any chunking, so a frame may be split
+ * across reads and a read may hold several frames. A start byte always
+ * begins a new frame, which resynchronizes the parser after a lost byte.
+ * The frame carries no checksum, so a frame only counts if it has exactly
+ * CARD_FRAME_PARSER_ID_LENGTH hex digits between its start and end bytes.
+ */
+typedef struct
+{
+    char id[CARD_FRAME_PARSER_ID_LENGTH + 1]; /* ID of the last complete frame, NUL terminated. */
+    char pending[CARD_FRAME_PARSER_ID_LENGTH];
+    uint8_t pending_length;
+    bool in_frame;
+    uint32_t frames;
+    uint32_t rejected;
+} card_frame_parser_t;
+
+/**
+ * @brief Sets up a parser that waits for the start of a frame.
+ *
+ * @param parser Parser to initialize.
+ */
+void card_frame_parser_init(card_frame_parser_t *parser);
+
+/**
+ * @brief Drops a partially received frame, for example after the UART lost data.
+ *
+ * @param parser Parser to reset.
+ */
+void card_frame_parser_reset(card_frame_parser_t *parser);
+
+/**
+ * @brief Feeds one received byte into the parser.
+ *
+ * @param parser Parser to update.
+ * @param byte Received byte.
+ *
+ * @return true if the byte completed a valid frame, its ID is in parser->id.
+ */
+bool card_frame_parser_push(card_frame_parser_t *parser, uint8_t byte);
@@ -4,9 +4,14 @@
 #include <driver/uart.h>
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <string.h>
 
-#include "app_config.h"
+#include "app_resources.h"
+#include "card_frame_parser.h"
+#include "event_bus.h"
 #include "queue.h"
 
 static const char *TAG = "card reader";
@@ -19,86 +24,157 @@ static const char *TAG = "card reader";
 #define CARD_READER_UART_BAUD_RATE 2400
 #define CARD_READER_TAG_ID "01004B1DA2"
 
+#define CARD_READER_UART_EVENT_QUEUE_SIZE 8
+#define CARD_READER_UART_PATTERN_QUEUE_SIZE 8
+#define CARD_READER_UART_PATTERN_CHR_TIMEOUT 9 /* In baud periods, the default of the UART driver. */
+#define CARD_READER_UART_READ_CHUNK_SIZE 32
+#define CARD_READER_REPEAT_HOLD_OFF_MS 1000
+
 static TaskHandle_t task_handle;
+static QueueHandle_t uart_event_queue;
+static card_frame_parser_t frame_parser;
 
-static void card_reader_task_handler(void *)
+/* The last frame, to tell a card still in the field from a new presentation. */
+static char last_id[CARD_FRAME_PARSER_ID_LENGTH + 1];
+static int64_t last_frame_us;
+
+/**
+ * @brief Publishes the access decision for a presented card.
+ */
+static void publish_card_result(const char *id, int64_t timestamp_us)
 {
-    BaseType_t rtos_ret;
+    const bool valid = strcmp(id, CARD_READER_TAG_ID) == 0;
+    if (valid)
+    {
+        ESP_LOGI(TAG, "Valid RFID tag detected: %s", id);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Invalid RFID tag detected: %s", id);
+    }
 
-    bool valid = false;
-    for (;;)
+    message_t tx_msg = {
+        .component = COMPONENT_CARD_READER,
+        .type = valid ? MESSAGE_TYPE_CARD_READER_CARD_VALID : MESSAGE_TYPE_CARD_READER_CARD_INVALID,
+        .timestamp_us = timestamp_us,
+    };
+    esp_err_t esp_ret = event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &tx_msg);
+    if (esp_ret != ESP_OK)
     {
-        uint8_t uid[12] = {0};
-        size_t uid_len = sizeof(uid);
+        ESP_LOGE(TAG, "Failed to publish card read result: %s", esp_err_to_name(esp_ret));
+    }
+
+    metric_t metric_card_reader_valid = {
+        .metric_type = METRIC_TYPE_CARD_READER_VALID,
+        .timestamp_us = timestamp_us,
+        .bool_value = valid,
+    };
+    event_bus_publish(EVENT_BUS_TOPIC_METRICS_CRITICAL, &metric_card_reader_valid);
+}
 
-        int len = uart_read_bytes(CARD_READER_UART_NUM, uid, uid_len, pdMS_TO_TICKS(100));
-        if (len > 0)
+/**
+ * @brief Decides on a received frame unless it repeats the card still in the field.
+ *
+ * The reader sends the frame over and over while a card stays in its field,
+ * so frames of the same card closer than CARD_READER_REPEAT_HOLD_OFF_MS
+ * apart belong to one presentation.
+ */
+static void handle_frame(const char *id, int64_t timestamp_us)
+{
+    const bool repeat = strcmp(id, last_id) == 0 && timestamp_us - last_frame_us < CARD_READER_REPEAT_HOLD_OFF_MS * 1000LL;
+    memcpy(last_id, id, sizeof(last_id));
+    last_frame_us = timestamp_us;
+    if (repeat)
+    {
+        ESP_LOGD(TAG, "Ignoring repeated RFID tag: %s", id);
+        return;
+    }
+
+    publish_card_result(id, timestamp_us);
+}
+
+/**
+ * @brief Feeds every byte the UART driver buffered into the frame parser.
+ *
+ * @param timestamp_us Time the UART event was received, used for every frame completed by these bytes.
+ */
+static void receive_frames(int64_t timestamp_us)
+{
+    size_t buffered = 0;
+    esp_err_t esp_ret = uart_get_buffered_data_len(CARD_READER_UART_NUM, &buffered);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to get buffered data length: %s", esp_err_to_name(esp_ret));
+        return;
+    }
+
+    while (buffered > 0)
+    {
+        uint8_t chunk[CARD_READER_UART_READ_CHUNK_SIZE];
+        const int len = uart_read_bytes(CARD_READER_UART_NUM, chunk, buffered < sizeof(chunk) ? buffered : sizeof(chunk), 0);
+        if (len <= 0)
         {
-            uid[len] = '\0'; // Null-terminate the received data
-            ESP_LOGI(TAG, "Received RFID tag ID: %s", (char *)uid);
-            if (len >= 12 && uid[0] == 0x0A && uid[11] == 0x0D)
-            {
-                char id[11];
-                memcpy(id, &uid[1], 10);
-                id[10] = '\0';
-                if (strcmp(id, CARD_READER_TAG_ID) == 0)
-                {
-                    ESP_LOGI(TAG, "Valid RFID tag detected: %s", id);
-                    valid = true;
-
-                    message_t tx_msg = {
-                        .component = COMPONENT_CARD_READER,
-                        .type = valid ? MESSAGE_TYPE_CARD_READER_CARD_VALID : MESSAGE_TYPE_CARD_READER_CARD_INVALID,
-                    };
-                    rtos_ret = xQueueSendToBack(queue_handle_task_orchastrator, &tx_msg, 0);
-                    if (rtos_ret != pdTRUE)
-                    {
-                        ESP_LOGE(TAG, "Failed to send card read result to queue with error code: %d", rtos_ret);
-                    }
-
-                    metric_t metric_card_reader_valid = {
-                        .metric_type = METRIC_TYPE_CARD_READER_VALID,
-                        .timestamp = time(NULL),
-                        .bool_value = valid ? true : false,
-                    };
-                    xQueueSendToBack(queue_handle_metrics, &metric_card_reader_valid, 0);
-                }
-                else
-                {
-                    ESP_LOGW(TAG, "Invalid RFID tag detected: %s", id);
-                    valid = false;
-
-                    message_t tx_msg = {
-                        .component = COMPONENT_CARD_READER,
-                        .type = valid ? MESSAGE_TYPE_CARD_READER_CARD_VALID : MESSAGE_TYPE_CARD_READER_CARD_INVALID,
-                    };
-                    rtos_ret = xQueueSendToBack(queue_handle_task_orchastrator, &tx_msg, 0);
-                    if (rtos_ret != pdPASS)
-                    {
-                        ESP_LOGE(TAG, "Failed to send card read result to queue with error code: %d", rtos_ret);
-                    }
-
-                    metric_t metric_card_reader_valid = {
-                        .metric_type = METRIC_TYPE_CARD_READER_VALID,
-                        .timestamp = time(NULL),
-                        .bool_value = valid ? true : false,
-                    };
-                    xQueueSendToBack(queue_handle_metrics, &metric_card_reader_valid, 0);
-                }
-            }
-            while (len > 0)
+            break;
+        }
+        buffered -= len;
+
+        for (int i = 0; i < len; i++)
+        {
+            if (card_frame_parser_push(&frame_parser, chunk[i]))
             {
-                uint8_t discard;
-                len = uart_read_bytes(CARD_READER_UART_NUM, &discard, 1, pdMS_TO_TICKS(1000));
+                handle_frame(frame_parser.id, timestamp_us);
             }
         }
     }
 }
 
+/**
+ * @brief Task handler for the card reader.
+ * Sleeps on the UART event queue. The driver raises an event as soon as the
+ * end byte of a frame arrives, so a card is decided on one frame time after
+ * it entered the field instead of after a read timeout.
+ *
+ * @param pvParameters Unused.
+ */
+static void card_reader_task_handler(void *)
+{
+    for (;;)
+    {
+        uart_event_t event;
+        if (xQueueReceive(uart_event_queue, &event, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        const int64_t timestamp_us = esp_timer_get_time();
+
+        switch (event.type)
+        {
+        case UART_PATTERN_DET:
+            // The parser finds the end byte itself, the position is only popped so the pattern queue does not fill up.
+            uart_pattern_pop_pos(CARD_READER_UART_NUM);
+            /* fall through */
+        case UART_DATA:
+            receive_frames(timestamp_us);
+            break;
+
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            ESP_LOGW(TAG, "UART lost data, dropping buffered bytes.");
+            uart_flush_input(CARD_READER_UART_NUM);
+            xQueueReset(uart_event_queue);
+            card_frame_parser_reset(&frame_parser);
+            break;
+
+        default:
+            ESP_LOGD(TAG, "Ignoring UART event %d.", event.type);
+            break;
+        }
+    }
+}
+
 esp_err_t card_reader_init(void)
 {
     esp_err_t esp_ret;
-    BaseType_t rtos_ret;
     esp_err_t cleanup_ret;
 
     ESP_LOGI(TAG, "Configuring UART parameter...");
@@ -126,13 +202,32 @@ esp_err_t card_reader_init(void)
     }
 
     ESP_LOGI(TAG, "Installing UART driver...");
-    esp_ret = uart_driver_install(CARD_READER_UART_NUM, CARD_READER_UART_RX_BUFFER_SIZE, 0, 0, NULL, 0);
+    esp_ret = uart_driver_install(CARD_READER_UART_NUM, CARD_READER_UART_RX_BUFFER_SIZE, 0, CARD_READER_UART_EVENT_QUEUE_SIZE, &uart_event_queue, 0);
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to install UART driver: %s", esp_err_to_name(esp_ret));
         goto cleanup_nothing;
     }
 
+    ESP_LOGI(TAG, "Enabling frame end detection...");
+    esp_ret = uart_enable_pattern_det_baud_intr(CARD_READER_UART_NUM, CARD_FRAME_PARSER_END, 1, CARD_READER_UART_PATTERN_CHR_TIMEOUT, 0, 0);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to enable frame end detection: %s", esp_err_to_name(esp_ret));
+        goto cleanup_uart_driver;
+    }
+
+    esp_ret = uart_pattern_queue_reset(CARD_READER_UART_NUM, CARD_READER_UART_PATTERN_QUEUE_SIZE);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to allocate pattern queue: %s", esp_err_to_name(esp_ret));
+        goto cleanup_uart_driver;
+    }
+
+    card_frame_parser_init(&frame_parser);
+    last_id[0] = '\0';
+    last_frame_us = 0;
+
     ESP_LOGI(TAG, "Configuring GPIO...");
     gpio_config_t config_enable = {
         .pin_bit_mask = 1ULL << CARD_READER_GPIO_ENABLE,
@@ -157,10 +252,10 @@ esp_err_t card_reader_init(void)
     }
 
     ESP_LOGI(TAG, "Creating task...");
-    rtos_ret = xTaskCreate(card_reader_task_handler, "Card Reader", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &task_handle);
-    if (rtos_ret != pdPASS)
+    task_handle = app_resources_create_task(APP_RESOURCES_TASK_CARD_READER, card_reader_task_handler);
+    if (task_handle == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create card reader task with error code: %d", rtos_ret);
+        ESP_LOGE(TAG, "Failed to create card reader task.");
         esp_ret = ESP_FAIL;
         goto cleanup_gpio;
     }
@@ -174,7 +269,7 @@ cleanup_gpio:
         ESP_LOGE(TAG, "Failed to reset GPIO pin: %s. aborting progarm.", esp_err_to_name(cleanup_ret));
         abort();
     }
-    // uart cleanup
+cleanup_uart_driver:
     ESP_LOGI(TAG, "Deleting UART driver...");
     cleanup_ret = uart_driver_delete(CARD_READER_UART_NUM);
     if (cleanup_ret != ESP_OK)
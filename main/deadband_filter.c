@@ -0,0 +1,36 @@
+#include "deadband_filter.h"
+
+#include <math.h>
+
+void deadband_filter_init(deadband_filter_t *filter, const deadband_filter_config_t *config)
+{
+    filter->config = *config;
+    deadband_filter_reset(filter);
+}
+
+void deadband_filter_reset(deadband_filter_t *filter)
+{
+    filter->passed_value = 0;
+    filter->passed_us = 0;
+    filter->passed = false;
+}
+
+bool deadband_filter_check(const deadband_filter_t *filter, float value, float noise_stddev, int64_t timestamp_us)
+{
+    if (!filter->passed)
+    {
+        return true;
+    }
+
+    const float deadband = fmaxf(filter->config.min_deadband, filter->config.noise_stddevs * noise_stddev);
+    const bool changed = fabsf(value - filter->passed_value) >= deadband;
+    const bool silent = timestamp_us - filter->passed_us >= filter->config.heartbeat_us;
+    return changed || silent;
+}
+
+void deadband_filter_passed(deadband_filter_t *filter, float value, int64_t timestamp_us)
+{
+    filter->passed_value = value;
+    filter->passed_us = timestamp_us;
+    filter->passed = true;
+}
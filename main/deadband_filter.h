@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Tuning of a deadband filter.
+ *
+ * A value is only passed on once it moved out of the deadband around the
+ * last value passed on. The deadband is min_deadband wide, or noise_stddevs
+ * standard deviations of the noise if that is wider. After heartbeat_us
+ * without passing anything on, the next value is passed on regardless, so a
+ * receiver can tell a steady value from a dead sensor.
+ */
+typedef struct
+{
+    float min_deadband;
+    float noise_stddevs;
+    int64_t heartbeat_us;
+} deadband_filter_config_t;
+
+/**
+ * @brief Drops values that did not change significantly since the last one passed on.
+ */
+typedef struct
+{
+    deadband_filter_config_t config;
+    float passed_value;
+    int64_t passed_us;
+    bool passed; /* false until the first value is passed on. */
+} deadband_filter_t;
+
+/**
+ * @brief Sets up a filter that passes on the next value.
+ *
+ * @param filter Filter to initialize.
+ * @param config Tuning.
+ */
+void deadband_filter_init(deadband_filter_t *filter, const deadband_filter_config_t *config);
+
+/**
+ * @brief Forgets the last value passed on, so the next one is passed on.
+ *
+ * @param filter Filter to reset.
+ */
+void deadband_filter_reset(deadband_filter_t *filter);
+
+/**
+ * @brief Tells whether a value has to be passed on.
+ *
+ * @param filter Filter to ask.
+ * @param value Sampled value.
+ * @param noise_stddev Standard deviation of the noise on the value.
+ * @param timestamp_us Time of the sample in microseconds since boot.
+ *
+ * @return true for the first value, a value outside the deadband, or once the heartbeat is due.
+ */
+bool deadband_filter_check(const deadband_filter_t *filter, float value, float noise_stddev, int64_t timestamp_us);
+
+/**
+ * @brief Records that a value was passed on, the deadband is centred on it from now on.
+ *
+ * @param filter Filter to update.
+ * @param value Value passed on.
+ * @param timestamp_us Time of the sample in microseconds since boot.
+ */
+void deadband_filter_passed(deadband_filter_t *filter, float value, int64_t timestamp_us);
@@ -0,0 +1,353 @@
+#include "event_bus.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "app_resources.h"
+#include "queue.h"
+#include "queue_stats.h"
+
+static const char *TAG = "event bus";
+
+#define EVENT_BUS_MAX_SUBSCRIPTIONS 12
+#define EVENT_BUS_MAX_SUBSCRIBERS_PER_TOPIC 4
+
+struct event_bus_subscription
+{
+    bool in_use;
+    event_bus_topic_t topic;
+    event_bus_policy_t policy;
+    QueueHandle_t queue_handle;
+    queue_stats_t stats;
+    uint64_t queued_messages; /* One bit per component and message type of the triggers queued, for EVENT_BUS_POLICY_COALESCE. */
+};
+
+/**
+ * @brief An event as it is stored in a subscription's queue.
+ *
+ * Queues are created with the size of the topic's event type, so only the
+ * matching union member is ever copied.
+ */
+typedef struct
+{
+    int64_t published_us;
+    union
+    {
+        message_t message;
+        metric_t metric;
+    };
+} envelope_t;
+
+#define EVENT_BUS_ENVELOPE_HEADER_SIZE offsetof(envelope_t, message)
+
+_Static_assert(EVENT_BUS_ENVELOPE_HEADER_SIZE == sizeof(int64_t), "EVENT_BUS_*_ITEM_SIZE no longer match the envelope");
+_Static_assert(COMPONENT_COUNT * MESSAGE_TYPE_COUNT <= 64, "Coalescing needs one bit per component and message type");
+
+typedef struct
+{
+    event_bus_subscription_t *subscribers[EVENT_BUS_MAX_SUBSCRIBERS_PER_TOPIC];
+    size_t subscriber_count;
+    size_t reserved_count; /* Subscribers plus subscriptions still being set up. */
+} topic_t;
+
+/* Size of the event type carried by every topic. */
+static const size_t topic_event_sizes[EVENT_BUS_TOPIC_COUNT] = {
+    [EVENT_BUS_TOPIC_SECURITY_EVENTS] = sizeof(message_t),
+    [EVENT_BUS_TOPIC_SENSOR_CONTROL] = sizeof(message_t),
+    [EVENT_BUS_TOPIC_BUZZER] = sizeof(message_t),
+    [EVENT_BUS_TOPIC_METRICS] = sizeof(metric_t),
+    [EVENT_BUS_TOPIC_METRICS_CRITICAL] = sizeof(metric_t),
+};
+
+static event_bus_subscription_t subscriptions[EVENT_BUS_MAX_SUBSCRIPTIONS];
+static topic_t topics[EVENT_BUS_TOPIC_COUNT];
+
+/* Guards the subscriber lists and the queued message bits. Publishing only holds it briefly. */
+static portMUX_TYPE topics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint64_t message_bit(const message_t *message) { return UINT64_C(1) << (message->component * MESSAGE_TYPE_COUNT + message->type); }
+
+/**
+ * @brief Delivers an event to one subscription according to its policy.
+ *
+ * @return true if no event was lost.
+ */
+static bool deliver(event_bus_subscription_t *subscription, const envelope_t *envelope)
+{
+    bool delivered;
+    bool lost = false;
+    switch (subscription->policy)
+    {
+    case EVENT_BUS_POLICY_BLOCK:
+        delivered = xQueueSendToBack(subscription->queue_handle, envelope, portMAX_DELAY) == pdTRUE;
+        break;
+
+    case EVENT_BUS_POLICY_DROP_NEWEST:
+        delivered = xQueueSendToBack(subscription->queue_handle, envelope, 0) == pdTRUE;
+        break;
+
+    case EVENT_BUS_POLICY_COALESCE:
+    {
+        if (envelope->message.type != MESSAGE_TYPE_SENSOR_TRIGGERED)
+        {
+            // State changes such as card reads must each reach the subscriber, so only triggers are coalesced.
+            delivered = xQueueSendToBack(subscription->queue_handle, envelope, portMAX_DELAY) == pdTRUE;
+            break;
+        }
+
+        const uint64_t bit = message_bit(&envelope->message);
+        taskENTER_CRITICAL(&topics_lock);
+        const bool already_queued = (subscription->queued_messages & bit) != 0;
+        subscription->queued_messages |= bit;
+        taskEXIT_CRITICAL(&topics_lock);
+        if (already_queued)
+        {
+            // The subscriber has not seen the queued copy yet, so nothing is lost.
+            return true;
+        }
+
+        delivered = xQueueSendToBack(subscription->queue_handle, envelope, 0) == pdTRUE;
+        if (!delivered)
+        {
+            taskENTER_CRITICAL(&topics_lock);
+            subscription->queued_messages &= ~bit;
+            taskEXIT_CRITICAL(&topics_lock);
+        }
+        break;
+    }
+
+    case EVENT_BUS_POLICY_DROP_OLDEST:
+        delivered = xQueueSendToBack(subscription->queue_handle, envelope, 0) == pdTRUE;
+        if (!delivered)
+        {
+            envelope_t oldest_envelope;
+            xQueueReceive(subscription->queue_handle, &oldest_envelope, 0);
+            lost = true;
+            delivered = xQueueSendToBack(subscription->queue_handle, envelope, 0) == pdTRUE;
+        }
+        break;
+
+    default:
+        ESP_LOGE(TAG, "Received invalid delivery policy, enum code %d.", subscription->policy);
+        delivered = false;
+        break;
+    }
+
+    if (lost || !delivered)
+    {
+        queue_stats_record_drop(&subscription->stats);
+    }
+    if (delivered)
+    {
+        queue_stats_record_enqueue(&subscription->stats, uxQueueMessagesWaiting(subscription->queue_handle));
+    }
+    return delivered && !lost;
+}
+
+/**
+ * @brief Frees a subscription and its subscriber slot on the topic.
+ */
+static void release_reservation(event_bus_subscription_t *subscription)
+{
+    taskENTER_CRITICAL(&topics_lock);
+    topics[subscription->topic].reserved_count--;
+    subscription->in_use = false;
+    taskEXIT_CRITICAL(&topics_lock);
+}
+
+esp_err_t event_bus_init(void)
+{
+    memset(subscriptions, 0, sizeof(subscriptions));
+    memset(topics, 0, sizeof(topics));
+    return ESP_OK;
+}
+
+void event_bus_deinit(void)
+{
+    for (size_t i = 0; i < EVENT_BUS_MAX_SUBSCRIPTIONS; i++)
+    {
+        if (subscriptions[i].in_use)
+        {
+            event_bus_unsubscribe(&subscriptions[i]);
+        }
+    }
+}
+
+esp_err_t event_bus_subscribe(event_bus_topic_t topic, app_resources_queue_t queue, event_bus_policy_t policy, event_bus_subscription_t **subscription)
+{
+    if (topic >= EVENT_BUS_TOPIC_COUNT)
+    {
+        ESP_LOGE(TAG, "Received invalid topic, enum code %d.", topic);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (policy == EVENT_BUS_POLICY_COALESCE && topic_event_sizes[topic] != sizeof(message_t))
+    {
+        ESP_LOGE(TAG, "Topic \"%s\" does not carry messages and cannot be coalesced.", event_bus_topic_to_name(topic));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The subscriber slot is reserved together with the subscription, so concurrent subscribers cannot overfill the topic.
+    event_bus_subscription_t *new_subscription = NULL;
+    taskENTER_CRITICAL(&topics_lock);
+    if (topics[topic].reserved_count < EVENT_BUS_MAX_SUBSCRIBERS_PER_TOPIC)
+    {
+        for (size_t i = 0; i < EVENT_BUS_MAX_SUBSCRIPTIONS; i++)
+        {
+            if (!subscriptions[i].in_use)
+            {
+                new_subscription = &subscriptions[i];
+                new_subscription->in_use = true;
+                topics[topic].reserved_count++;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&topics_lock);
+
+    if (new_subscription == NULL)
+    {
+        ESP_LOGE(TAG, "No free subscription for topic \"%s\".", event_bus_topic_to_name(topic));
+        return ESP_ERR_NO_MEM;
+    }
+
+    new_subscription->topic = topic;
+    new_subscription->policy = policy;
+    new_subscription->queued_messages = 0;
+    new_subscription->queue_handle = app_resources_create_queue(queue, EVENT_BUS_ENVELOPE_HEADER_SIZE + topic_event_sizes[topic]);
+    if (new_subscription->queue_handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create queue for topic \"%s\".", event_bus_topic_to_name(topic));
+        release_reservation(new_subscription);
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_err_t ret = queue_stats_register(&new_subscription->stats, app_resources_queue_name(queue), app_resources_queue_depth(queue));
+    if (ret != ESP_OK)
+    {
+        vQueueDelete(new_subscription->queue_handle);
+        new_subscription->queue_handle = NULL;
+        release_reservation(new_subscription);
+        return ret;
+    }
+
+    taskENTER_CRITICAL(&topics_lock);
+    topics[topic].subscribers[topics[topic].subscriber_count++] = new_subscription;
+    taskEXIT_CRITICAL(&topics_lock);
+
+    *subscription = new_subscription;
+    return ESP_OK;
+}
+
+void event_bus_unsubscribe(event_bus_subscription_t *subscription)
+{
+    topic_t *topic = &topics[subscription->topic];
+
+    taskENTER_CRITICAL(&topics_lock);
+    for (size_t i = 0; i < topic->subscriber_count; i++)
+    {
+        if (topic->subscribers[i] == subscription)
+        {
+            topic->subscribers[i] = topic->subscribers[--topic->subscriber_count];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&topics_lock);
+
+    queue_stats_unregister(&subscription->stats);
+    vQueueDelete(subscription->queue_handle);
+    subscription->queue_handle = NULL;
+    release_reservation(subscription);
+}
+
+esp_err_t event_bus_publish(event_bus_topic_t topic, const void *event)
+{
+    if (topic >= EVENT_BUS_TOPIC_COUNT)
+    {
+        ESP_LOGE(TAG, "Received invalid topic, enum code %d.", topic);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    event_bus_subscription_t *subscribers[EVENT_BUS_MAX_SUBSCRIBERS_PER_TOPIC];
+    size_t subscriber_count;
+
+    taskENTER_CRITICAL(&topics_lock);
+    subscriber_count = topics[topic].subscriber_count;
+    memcpy(subscribers, topics[topic].subscribers, subscriber_count * sizeof(subscribers[0]));
+    taskEXIT_CRITICAL(&topics_lock);
+
+    envelope_t envelope = {
+        .published_us = esp_timer_get_time(),
+    };
+    memcpy(&envelope.message, event, topic_event_sizes[topic]);
+
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < subscriber_count; i++)
+    {
+        if (!deliver(subscribers[i], &envelope))
+        {
+            ESP_LOGD(TAG, "Subscriber of topic \"%s\" is full, dropped an event.", event_bus_topic_to_name(topic));
+            ret = ESP_FAIL;
+        }
+    }
+
+    return ret;
+}
+
+bool event_bus_receive(event_bus_subscription_t *subscription, void *event, TickType_t timeout)
+{
+    envelope_t envelope;
+    if (xQueueReceive(subscription->queue_handle, &envelope, timeout) != pdTRUE)
+    {
+        return false;
+    }
+
+    queue_stats_record_latency(&subscription->stats, esp_timer_get_time() - envelope.published_us);
+    if (subscription->policy == EVENT_BUS_POLICY_COALESCE)
+    {
+        // A duplicate published since the receive above is coalesced into the message returned here.
+        taskENTER_CRITICAL(&topics_lock);
+        subscription->queued_messages &= ~message_bit(&envelope.message);
+        taskEXIT_CRITICAL(&topics_lock);
+    }
+    memcpy(event, &envelope.message, topic_event_sizes[subscription->topic]);
+    return true;
+}
+
+bool event_bus_peek(event_bus_subscription_t *subscription, void *event)
+{
+    envelope_t envelope;
+    if (xQueuePeek(subscription->queue_handle, &envelope, 0) != pdTRUE)
+    {
+        return false;
+    }
+
+    memcpy(event, &envelope.message, topic_event_sizes[subscription->topic]);
+    return true;
+}
+
+size_t event_bus_pending(const event_bus_subscription_t *subscription) { return uxQueueMessagesWaiting(subscription->queue_handle); }
+
+const char *event_bus_topic_to_name(event_bus_topic_t topic)
+{
+    switch (topic)
+    {
+    case EVENT_BUS_TOPIC_SECURITY_EVENTS:
+        return "EVENT_BUS_TOPIC_SECURITY_EVENTS";
+    case EVENT_BUS_TOPIC_SENSOR_CONTROL:
+        return "EVENT_BUS_TOPIC_SENSOR_CONTROL";
+    case EVENT_BUS_TOPIC_BUZZER:
+        return "EVENT_BUS_TOPIC_BUZZER";
+    case EVENT_BUS_TOPIC_METRICS:
+        return "EVENT_BUS_TOPIC_METRICS";
+    case EVENT_BUS_TOPIC_METRICS_CRITICAL:
+        return "EVENT_BUS_TOPIC_METRICS_CRITICAL";
+    default:
+        ESP_LOGE(TAG, "Received invalid topic, enum code %d.", topic);
+        return "INVALID_TOPIC";
+    }
+}
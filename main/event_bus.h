@@ -0,0 +1,141 @@
+#pragma once
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_resources.h"
+#include "queue.h"
+
+/**
+ * @brief Topics events are published on.
+ *
+ * Every topic carries one event type. Producers publish to a topic without
+ * knowing who listens, and every subscription of the topic receives its own
+ * copy of the event.
+ */
+typedef enum
+{
+    EVENT_BUS_TOPIC_SECURITY_EVENTS,  /**< message_t, sensor triggers and card reads. */
+    EVENT_BUS_TOPIC_SENSOR_CONTROL,   /**< message_t, enable and disable requests for every sensor. */
+    EVENT_BUS_TOPIC_BUZZER,           /**< message_t, buzzer commands. */
+    EVENT_BUS_TOPIC_METRICS,          /**< metric_t, bulk telemetry. */
+    EVENT_BUS_TOPIC_METRICS_CRITICAL, /**< metric_t, security relevant metrics. */
+    EVENT_BUS_TOPIC_COUNT,
+} event_bus_topic_t;
+
+/**
+ * @brief What a publish does when a subscription's queue is full.
+ */
+typedef enum
+{
+    EVENT_BUS_POLICY_BLOCK,       /**< Wait until the subscriber makes room. */
+    EVENT_BUS_POLICY_DROP_NEWEST, /**< Drop the event being published. */
+    EVENT_BUS_POLICY_DROP_OLDEST, /**< Drop the oldest queued event to make room. */
+    EVENT_BUS_POLICY_COALESCE,    /**< Skip a MESSAGE_TYPE_SENSOR_TRIGGERED whose component is still queued, otherwise like DROP_NEWEST. Other messages wait like BLOCK. */
+} event_bus_policy_t;
+
+/**
+ * @brief A subscriber's bounded queue of events from one topic.
+ */
+typedef struct event_bus_subscription event_bus_subscription_t;
+
+/**
+ * @brief Initializes the event bus.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t event_bus_init(void);
+
+/**
+ * @brief Removes every remaining subscription and frees its queue.
+ */
+void event_bus_deinit(void);
+
+/**
+ * @brief Size of one queued event of a topic carrying message_t, including
+ * the time it was published.
+ */
+#define EVENT_BUS_MESSAGE_ITEM_SIZE (sizeof(int64_t) + sizeof(message_t))
+
+/**
+ * @brief Size of one queued event of a topic carrying metric_t, including
+ * the time it was published.
+ */
+#define EVENT_BUS_METRIC_ITEM_SIZE (sizeof(int64_t) + sizeof(metric_t))
+
+/**
+ * @brief Subscribes to a topic.
+ *
+ * The subscription's events are held in a queue from the resource table,
+ * which must reserve EVENT_BUS_MESSAGE_ITEM_SIZE or EVENT_BUS_METRIC_ITEM_SIZE
+ * per item for the topic. Every subscription keeps queue statistics under
+ * the name of its queue, see queue_stats_snapshot_all().
+ *
+ * @param topic Topic to subscribe to.
+ * @param queue Queue holding the events of the subscription.
+ * @param policy What to do when the subscription is full.
+ * @param subscription Set to the new subscription.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if no more subscriptions can be
+ * created, ESP_ERR_INVALID_ARG if EVENT_BUS_POLICY_COALESCE is used on a
+ * topic that does not carry message_t.
+ */
+esp_err_t event_bus_subscribe(event_bus_topic_t topic, app_resources_queue_t queue, event_bus_policy_t policy, event_bus_subscription_t **subscription);
+
+/**
+ * @brief Removes a subscription and frees its queue.
+ *
+ * No task may publish to the topic or receive from the subscription while
+ * it is being removed.
+ *
+ * @param subscription Subscription to remove.
+ */
+void event_bus_unsubscribe(event_bus_subscription_t *subscription);
+
+/**
+ * @brief Delivers an event to every subscription of a topic.
+ *
+ * Only subscriptions with EVENT_BUS_POLICY_BLOCK can make this call wait.
+ *
+ * @param topic Topic to publish to.
+ * @param event Event to publish, of the type carried by the topic.
+ *
+ * @return ESP_OK if every subscription received the event without losing
+ * another one, ESP_FAIL if an event was dropped, ESP_ERR_INVALID_ARG for an
+ * unknown topic. An event coalesced into an equal queued one is not a loss.
+ */
+esp_err_t event_bus_publish(event_bus_topic_t topic, const void *event);
+
+/**
+ * @brief Takes the oldest event from a subscription.
+ *
+ * @param subscription Subscription to receive from.
+ * @param event Buffer the event is copied into.
+ * @param timeout Ticks to wait for an event.
+ *
+ * @return true if an event was received.
+ */
+bool event_bus_receive(event_bus_subscription_t *subscription, void *event, TickType_t timeout);
+
+/**
+ * @brief Copies the oldest event of a subscription without taking it.
+ *
+ * @param subscription Subscription to peek at.
+ * @param event Buffer the event is copied into.
+ *
+ * @return true if an event was waiting.
+ */
+bool event_bus_peek(event_bus_subscription_t *subscription, void *event);
+
+/**
+ * @brief Returns the number of events waiting in a subscription.
+ */
+size_t event_bus_pending(const event_bus_subscription_t *subscription);
+
+/**
+ * @brief Returns a readable name for a topic.
+ */
+const char *event_bus_topic_to_name(event_bus_topic_t topic);
@@ -0,0 +1,41 @@
+#include "gpio_interrupt.h"
+
+esp_err_t gpio_interrupt_attach(gpio_num_t gpio_num, gpio_int_type_t intr_type, gpio_isr_t handler, void *arg)
+{
+    // The sensors drive their interrupt lines, and input only pins like GPIO 34 and 35 have no internal pulls.
+    const gpio_config_t config = {
+        .pin_bit_mask = 1ULL << gpio_num,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = intr_type,
+    };
+    esp_err_t ret = gpio_config(&config);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    // The ISR service is shared between drivers, so it may already be installed.
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+    {
+        gpio_reset_pin(gpio_num);
+        return ret;
+    }
+
+    ret = gpio_isr_handler_add(gpio_num, handler, arg);
+    if (ret != ESP_OK)
+    {
+        gpio_reset_pin(gpio_num);
+        return ret;
+    }
+
+    return ESP_OK;
+}
+
+void gpio_interrupt_detach(gpio_num_t gpio_num)
+{
+    gpio_isr_handler_remove(gpio_num);
+    gpio_reset_pin(gpio_num);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <driver/gpio.h>
+#include <esp_err.h>
+
+/**
+ * @brief Configures a pin as a floating input and attaches an interrupt handler to it.
+ *
+ * Installs the GPIO ISR service if no other driver has installed it yet.
+ * On failure the pin is reset.
+ *
+ * @param gpio_num Pin the interrupt line is connected to.
+ * @param intr_type Edge or level that triggers the interrupt.
+ * @param handler Handler to attach, must be placed in IRAM.
+ * @param arg Argument passed to the handler.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t gpio_interrupt_attach(gpio_num_t gpio_num, gpio_int_type_t intr_type, gpio_isr_t handler, void *arg);
+
+/**
+ * @brief Removes the interrupt handler of a pin and resets the pin.
+ *
+ * The ISR service stays installed for the other drivers.
+ *
+ * @param gpio_num Pin passed to gpio_interrupt_attach().
+ */
+void gpio_interrupt_detach(gpio_num_t gpio_num);
@@ -0,0 +1,53 @@
+#include "log2_histogram.h"
+
+void log2_histogram_init(atomic_uint_least32_t *buckets)
+{
+    for (size_t bucket = 0; bucket < LOG2_HISTOGRAM_BUCKET_COUNT; bucket++)
+    {
+        atomic_init(&buckets[bucket], 0);
+    }
+}
+
+void log2_histogram_record(atomic_uint_least32_t *buckets, int64_t value)
+{
+    size_t bucket = 0;
+    while (bucket < LOG2_HISTOGRAM_BUCKET_COUNT - 1 && value >= (INT64_C(2) << bucket))
+    {
+        bucket++;
+    }
+    atomic_fetch_add_explicit(&buckets[bucket], 1, memory_order_relaxed);
+}
+
+void log2_histogram_load(atomic_uint_least32_t *buckets, uint32_t *counts)
+{
+    for (size_t bucket = 0; bucket < LOG2_HISTOGRAM_BUCKET_COUNT; bucket++)
+    {
+        counts[bucket] = atomic_load_explicit(&buckets[bucket], memory_order_relaxed);
+    }
+}
+
+uint32_t log2_histogram_percentile(const uint32_t *counts, uint32_t percentile)
+{
+    uint64_t total = 0;
+    for (size_t bucket = 0; bucket < LOG2_HISTOGRAM_BUCKET_COUNT; bucket++)
+    {
+        total += counts[bucket];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t rank = (total * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LOG2_HISTOGRAM_BUCKET_COUNT; bucket++)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+        {
+            return UINT32_C(2) << bucket;
+        }
+    }
+
+    return UINT32_C(2) << (LOG2_HISTOGRAM_BUCKET_COUNT - 1);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of buckets of a log2 histogram.
+ *
+ * Bucket 0 counts values below 2, bucket i values from 2^i up to 2^(i + 1),
+ * and the last bucket everything from 2^19 up, about half a second for
+ * values in microseconds.
+ */
+#define LOG2_HISTOGRAM_BUCKET_COUNT 20
+
+/**
+ * @brief Resets the buckets of a live histogram.
+ *
+ * @param buckets LOG2_HISTOGRAM_BUCKET_COUNT buckets to reset.
+ */
+void log2_histogram_init(atomic_uint_least32_t *buckets);
+
+/**
+ * @brief Counts a value in the bucket of its power of two.
+ *
+ * Buckets are updated with relaxed atomics, so any task can record while
+ * another copies the histogram.
+ *
+ * @param buckets LOG2_HISTOGRAM_BUCKET_COUNT buckets to record into.
+ * @param value Value to count, negative values count in bucket 0.
+ */
+void log2_histogram_record(atomic_uint_least32_t *buckets, int64_t value);
+
+/**
+ * @brief Copies the buckets of a live histogram.
+ *
+ * @param buckets LOG2_HISTOGRAM_BUCKET_COUNT buckets to copy.
+ * @param counts Buffer of LOG2_HISTOGRAM_BUCKET_COUNT counts the buckets are copied into.
+ */
+void log2_histogram_load(atomic_uint_least32_t *buckets, uint32_t *counts);
+
+/**
+ * @brief Estimates a percentile from a copy of a histogram.
+ *
+ * @param counts LOG2_HISTOGRAM_BUCKET_COUNT counts, see log2_histogram_load().
+ * @param percentile Percentile between 0 and 100.
+ *
+ * @return Upper bound of the bucket holding the percentile, 0 if nothing was
+ * recorded.
+ */
+uint32_t log2_histogram_percentile(const uint32_t *counts, uint32_t percentile);
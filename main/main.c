@@ -1,7 +1,10 @@
+#include <esp_heap_caps.h>
 #include <esp_log.h>
+#include <esp_system.h>
 
+#include "app_resources.h"
 #include "app_wifi.h"
-#include "queue.h"
+#include "event_bus.h"
 #include "task_orchastrator.h"
 #include "time_sync.h"
 
@@ -12,11 +15,11 @@ void app_main(void)
     esp_err_t ret;
     esp_err_t cleanup_ret;
 
-    ESP_LOGI(TAG, "Initializing queues...");
-    ret = queue_init();
+    ESP_LOGI(TAG, "Initializing event bus...");
+    ret = event_bus_init();
     if (ret != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to initialize queues: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to initialize event bus: %s", esp_err_to_name(ret));
         goto cleanup_none;
     }
 
@@ -25,7 +28,7 @@ void app_main(void)
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to initialize wifi: %s", esp_err_to_name(ret));
-        goto cleanup_queue;
+        goto cleanup_event_bus;
     }
 
     ESP_LOGI(TAG, "Synchronizing time...");
@@ -44,6 +47,9 @@ void app_main(void)
         goto cleanup_wifi;
     }
 
+    // Tasks and queues are allocated statically, so this is what is left for wifi, TLS and HTTP buffers.
+    ESP_LOGI(TAG, "Started with %lu bytes of heap free, largest free block %zu bytes.", (unsigned long)esp_get_free_heap_size(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    app_resources_log_stack_usage();
     return;
 
 cleanup_wifi:
@@ -54,9 +60,9 @@ cleanup_wifi:
         ESP_LOGE(TAG, "Failed to deinitialize wifi: %s. aborting program.", esp_err_to_name(cleanup_ret));
         abort();
     }
-cleanup_queue:
-    ESP_LOGI(TAG, "Deinitializing queues...");
-    queue_deinit();
+cleanup_event_bus:
+    ESP_LOGI(TAG, "Deinitializing event bus...");
+    event_bus_deinit();
 cleanup_none:
     abort();
 }
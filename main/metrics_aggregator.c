@@ -0,0 +1,228 @@
+#include "metrics_aggregator.h"
+
+#include <esp_log.h>
+#include <math.h>
+
+#include "queue.h"
+
+static const char *TAG = "metrics aggregator";
+
+/* The host test builds with fewer channels, to run out of them with the metric types that exist. */
+#ifndef METRICS_AGGREGATOR_MAX_CHANNELS
+#define METRICS_AGGREGATOR_MAX_CHANNELS 16
+#endif
+
+/* Metric types an accelerometer sample is split into, in the order of its fields. */
+static const metric_type_t accelerometer_sample_types[] = {
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_X,
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y,
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z,
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_X,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_Y,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_Z,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL,
+};
+#define METRICS_AGGREGATOR_ACCELEROMETER_SAMPLE_TYPES (sizeof(accelerometer_sample_types) / sizeof(accelerometer_sample_types[0]))
+
+/**
+ * @brief Running statistics of one metric type, updated with Welford's
+ * algorithm so the variance stays accurate in single precision.
+ */
+typedef struct
+{
+    metric_type_t metric_type;
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float m2;
+} channel_t;
+
+static channel_t channels[METRICS_AGGREGATOR_MAX_CHANNELS];
+static size_t channel_count;
+
+/**
+ * @brief Extracts the numeric value of an aggregatable sample.
+ *
+ * @return true if the sample is aggregatable.
+ */
+static bool sample_value(const metric_t *metric, float *value)
+{
+    if (metric->kind != METRIC_KIND_SAMPLE)
+    {
+        return false;
+    }
+
+    switch (metric->metric_type)
+    {
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_X:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_X:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_Y:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_Z:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL:
+        *value = metric->float_value;
+        return true;
+
+    case METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE:
+        *value = metric->uint16_value;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static channel_t *existing_channel(metric_type_t metric_type)
+{
+    for (size_t i = 0; i < channel_count; i++)
+    {
+        if (channels[i].metric_type == metric_type)
+        {
+            return &channels[i];
+        }
+    }
+    return NULL;
+}
+
+static channel_t *find_channel(metric_type_t metric_type)
+{
+    channel_t *channel = existing_channel(metric_type);
+    if (channel != NULL)
+    {
+        return channel;
+    }
+
+    if (channel_count >= METRICS_AGGREGATOR_MAX_CHANNELS)
+    {
+        ESP_LOGE(TAG, "No free channel for metric type \"%s\".", queue_metric_type_to_name(metric_type));
+        return NULL;
+    }
+
+    channel = &channels[channel_count++];
+    channel->metric_type = metric_type;
+    channel->count = 0;
+    return channel;
+}
+
+/**
+ * @brief Adds one value to the running statistics of a metric type.
+ *
+ * @return true if the value was aggregated.
+ */
+static bool channel_add(metric_type_t metric_type, float value)
+{
+    channel_t *channel = find_channel(metric_type);
+    if (channel == NULL)
+    {
+        return false;
+    }
+
+    if (channel->count == 0)
+    {
+        channel->min = value;
+        channel->max = value;
+        channel->mean = 0;
+        channel->m2 = 0;
+    }
+
+    channel->count++;
+    channel->min = fminf(channel->min, value);
+    channel->max = fmaxf(channel->max, value);
+    const float delta = value - channel->mean;
+    channel->mean += delta / channel->count;
+    channel->m2 += delta * (value - channel->mean);
+    return true;
+}
+
+/**
+ * @brief Splits an accelerometer sample into the statistics of its axes.
+ *
+ * The summaries keep the per axis metric types, so they look the same
+ * whether the accelerometer sent one combined sample or one metric per axis.
+ */
+static bool add_accelerometer_sample(const metric_accelerometer_sample_t *sample)
+{
+    // All axes or none, a sample published raw must not also be counted in some of the summaries.
+    size_t missing_count = 0;
+    for (size_t i = 0; i < METRICS_AGGREGATOR_ACCELEROMETER_SAMPLE_TYPES; i++)
+    {
+        missing_count += existing_channel(accelerometer_sample_types[i]) == NULL;
+    }
+    if (channel_count + missing_count > METRICS_AGGREGATOR_MAX_CHANNELS)
+    {
+        ESP_LOGE(TAG, "No free channels for the %zu axes of an accelerometer sample.", missing_count);
+        return false;
+    }
+
+    const float values[] = {
+        sample->acceleration_x,
+        sample->acceleration_y,
+        sample->acceleration_z,
+        sample->acceleration_total,
+        sample->rotation_x,
+        sample->rotation_y,
+        sample->rotation_z,
+        sample->rotation_total,
+    };
+    for (size_t i = 0; i < METRICS_AGGREGATOR_ACCELEROMETER_SAMPLE_TYPES; i++)
+    {
+        channel_add(accelerometer_sample_types[i], values[i]);
+    }
+    return true;
+}
+
+bool metrics_aggregator_add(const metric_t *metric)
+{
+    if (metric->kind == METRIC_KIND_SAMPLE && metric->metric_type == METRIC_TYPE_ACCELEROMETER_SAMPLE)
+    {
+        return add_accelerometer_sample(&metric->accelerometer_sample);
+    }
+
+    float value;
+    if (!sample_value(metric, &value))
+    {
+        return false;
+    }
+
+    return channel_add(metric->metric_type, value);
+}
+
+size_t metrics_aggregator_flush(metric_t *summaries, size_t max_summary_count, int64_t window_start_us)
+{
+    size_t summary_count = 0;
+    size_t dropped_count = 0;
+    for (size_t i = 0; i < channel_count; i++)
+    {
+        const channel_t *channel = &channels[i];
+        if (summary_count >= max_summary_count)
+        {
+            dropped_count++;
+            continue;
+        }
+
+        summaries[summary_count++] = (metric_t){
+            .metric_type = channel->metric_type,
+            .kind = METRIC_KIND_SUMMARY,
+            .timestamp_us = window_start_us,
+            .summary = {
+                .count = channel->count,
+                .min = channel->min,
+                .max = channel->max,
+                .mean = channel->mean,
+                .stddev = channel->count > 1 ? sqrtf(channel->m2 / (channel->count - 1)) : 0,
+            },
+        };
+    }
+    // Every channel is released, including the dropped ones, so nothing leaks into the next window.
+    channel_count = 0;
+
+    if (dropped_count > 0)
+    {
+        ESP_LOGW(TAG, "Dropped %zu summaries that did not fit in %zu.", dropped_count, max_summary_count);
+    }
+    return summary_count;
+}
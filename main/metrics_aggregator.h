@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+/**
+ * @brief Adds a metric sample to the running statistics of its metric type.
+ *
+ * Only numeric samples are aggregated. Boolean events and summaries are left
+ * for the caller to publish as is.
+ *
+ * @param metric Metric to aggregate.
+ *
+ * @return true if the metric was aggregated, false if it must be published raw.
+ */
+bool metrics_aggregator_add(const metric_t *metric);
+
+/**
+ * @brief Emits one summary per metric type seen since the last flush and
+ * starts a new window.
+ *
+ * Summaries that do not fit in the buffer are dropped, the new window starts
+ * without any statistics either way.
+ *
+ * @param summaries Buffer the summaries are written into.
+ * @param max_summary_count Capacity of the buffer.
+ * @param window_start_us Timestamp given to the summaries.
+ *
+ * @return Number of summaries written.
+ */
+size_t metrics_aggregator_flush(metric_t *summaries, size_t max_summary_count, int64_t window_start_us);
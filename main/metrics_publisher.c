@@ -1,121 +1,530 @@
 #include "metrics_publisher.h"
 
-#include <cJSON.h>
 #include <esp_err.h>
 #include <esp_event.h>
 #include <esp_http_client.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/task.h>
+#include <stdint.h>
 #include <string.h>
 
-#include "app_config.h"
+#include "app_resources.h"
 #include "app_wifi.h"
+#include "event_bus.h"
+#include "metrics_aggregator.h"
+#include "metrics_serializer.h"
+#include "metrics_store.h"
 #include "queue.h"
+#include "queue_stats.h"
+#include "sampling_scheduler.h"
+#include "spsc_ring.h"
+#include "time_sync.h"
 
 static const char *TAG = "metrics publisher";
 
 #define METRICS_PUBLISHER_ENDPOINT_URL "http://4.233.137.69/ingest/metrics"
+#define METRICS_PUBLISHER_BATCH_MAX_METRICS 64
+#define METRICS_PUBLISHER_BATCH_MAX_AGE_MS 1000
+#define METRICS_PUBLISHER_BATCH_COUNT 3
+#define METRICS_PUBLISHER_PAYLOAD_SIZE 8192
+#define METRICS_PUBLISHER_FORMAT METRICS_SERIALIZER_FORMAT_JSON
+#define METRICS_PUBLISHER_CRITICAL_POLL_MS 10
+#define METRICS_PUBLISHER_AGGREGATION_ENABLED true
+#define METRICS_PUBLISHER_AGGREGATION_WINDOW_MS 1000
+#define METRICS_PUBLISHER_AGGREGATION_MAX_SUMMARIES 16
+#define METRICS_PUBLISHER_MAX_RINGS 4
+#define METRICS_PUBLISHER_QUEUE_STATS_PERIOD_MS 10000
+#define METRICS_PUBLISHER_QUEUE_STATS_MAX_QUEUES 16
+#define METRICS_PUBLISHER_SAMPLING_STATS_MAX_LOOPS 8
+
+/**
+ * @brief A batch of metrics together with its serialized payload.
+ *
+ * Batches cycle between the collector task, which fills and serializes
+ * them, and the transmit task, which posts them. With more than one batch
+ * the collector serializes the next batch while the previous one is still
+ * being transferred.
+ */
+typedef struct
+{
+    metric_t metrics[METRICS_PUBLISHER_BATCH_MAX_METRICS];
+    size_t metric_count;
+    char payload[METRICS_PUBLISHER_PAYLOAD_SIZE];
+    metrics_serializer_t serializer;
+    bool critical;
+} metrics_batch_t;
 
-static TaskHandle_t task_handle;
+static TaskHandle_t collector_task_handle;
+static TaskHandle_t transmit_task_handle;
 
 static esp_http_client_handle_t http_client_handle;
 
-static cJSON *metric_to_cjson(metric_t *metric)
+static metrics_batch_t batches[METRICS_PUBLISHER_BATCH_COUNT];
+static QueueHandle_t free_batches_queue_handle;
+static QueueHandle_t ready_batches_queue_handle;
+
+static event_bus_subscription_t *metrics_subscription;
+static event_bus_subscription_t *metrics_critical_subscription;
+
+static spsc_ring_t *rings[METRICS_PUBLISHER_MAX_RINGS];
+static size_t ring_count;
+static portMUX_TYPE rings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static metrics_batch_t *bulk_batch;
+static TickType_t bulk_batch_start;
+
+static int64_t critical_latency_max_us;
+
+/**
+ * @brief Takes an empty batch from the pool, waiting for one if all are in use.
+ *
+ * @param critical Whether the batch will carry critical metrics.
+ *
+ * @return The empty batch.
+ */
+static metrics_batch_t *batch_acquire(bool critical)
 {
-    cJSON *json = cJSON_CreateObject();
-    cJSON_AddNumberToObject(json, "timestamp", (double)metric->timestamp);
+    metrics_batch_t *batch;
+    if (xQueueReceive(free_batches_queue_handle, &batch, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "All batches are in flight, waiting for the uplink...");
+        xQueueReceive(free_batches_queue_handle, &batch, portMAX_DELAY);
+    }
+
+    metrics_serializer_begin(&batch->serializer, time_sync_wall_clock_offset_us());
+    batch->metric_count = 0;
+    batch->critical = critical;
+    return batch;
+}
 
-    switch (metric->metric_type)
+/**
+ * @brief Adds a metric to a batch and serializes it into the batch payload.
+ *
+ * @param batch Batch to append to.
+ * @param metric Metric to append.
+ *
+ * @return true if the metric was consumed, false if the batch is full.
+ */
+static bool batch_append(metrics_batch_t *batch, const metric_t *metric)
+{
+    if (batch->metric_count >= METRICS_PUBLISHER_BATCH_MAX_METRICS)
     {
-    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_X:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ACCELERATION_X");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+        return false;
+    }
 
-    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+    const esp_err_t ret = metrics_serializer_append(&batch->serializer, metric);
+    if (ret == ESP_ERR_NO_MEM && batch->metric_count > 0)
+    {
+        return false;
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to serialize metric \"%s\": %s", queue_metric_type_to_name(metric->metric_type), esp_err_to_name(ret));
+        return true;
+    }
 
-    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+    batch->metrics[batch->metric_count++] = *metric;
+    return true;
+}
 
-    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+/**
+ * @brief Hands a filled batch over to the transmit task.
+ *
+ * Critical batches are queued ahead of any bulk batch waiting to be sent.
+ *
+ * @param batch Batch to submit.
+ */
+static void batch_submit(metrics_batch_t *batch)
+{
+    if (batch->metric_count == 0)
+    {
+        xQueueSendToBack(free_batches_queue_handle, &batch, portMAX_DELAY);
+        return;
+    }
 
-    case METRIC_TYPE_ACCELEROMETER_ROTATION_X:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ROTATION_X");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+    metrics_serializer_end(&batch->serializer);
+    if (batch->critical)
+    {
+        xQueueSendToFront(ready_batches_queue_handle, &batch, portMAX_DELAY);
+    }
+    else
+    {
+        xQueueSendToBack(ready_batches_queue_handle, &batch, portMAX_DELAY);
+    }
+}
 
-    case METRIC_TYPE_ACCELEROMETER_ROTATION_Y:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ROTATION_Y");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+/**
+ * @brief Sends the payload of a batch in a single POST request.
+ *
+ * @param batch Batch to send.
+ *
+ * @return ESP_OK if the endpoint accepted the payload, or an error code on failure.
+ */
+static esp_err_t post_payload(const metrics_batch_t *batch)
+{
+    esp_err_t ret = esp_http_client_set_header(http_client_handle, "Content-Type", metrics_serializer_content_type(&batch->serializer));
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to set http client header: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
-    case METRIC_TYPE_ACCELEROMETER_ROTATION_Z:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ROTATION_Z");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+    ret = esp_http_client_set_post_field(http_client_handle, batch->serializer.buffer, batch->serializer.length);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to set http client post field: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
-    case METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL");
-        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
-        break;
+    ret = esp_http_client_perform(http_client_handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to perform POST request: %s.", esp_err_to_name(ret));
+        return ret;
+    }
+
+    const int status_code = esp_http_client_get_status_code(http_client_handle);
+    if (status_code < 200 || status_code >= 300)
+    {
+        ESP_LOGE(TAG, "POST request failed with status code %d.", status_code);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
 
-    case METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE");
-        cJSON_AddNumberToObject(json, "uint16_value", metric->uint16_value);
-        break;
+    ESP_LOGD(TAG, "Published batch of %zu metrics.", batch->metric_count);
+    return ESP_OK;
+}
+
+/**
+ * @brief Publishes one batch of metrics from the metrics store, oldest first.
+ *
+ * Stored metrics are only removed from the store once the endpoint accepted them.
+ *
+ * @param batch Idle batch used as scratch space for the replay.
+ *
+ * @return ESP_OK if the metrics were delivered and removed from the store, ESP_ERR_NOT_FOUND if none could be read,
+ * or the error of the POST request or of the store.
+ */
+static esp_err_t replay_stored_metrics(metrics_batch_t *batch)
+{
+    // The stored metrics are read straight into the batch, a copy would not fit on the task stack.
+    int64_t wall_clock_offset_us;
+    const size_t read_count = metrics_store_read(batch->metrics, METRICS_PUBLISHER_BATCH_MAX_METRICS, &wall_clock_offset_us);
+    if (read_count == 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
 
-    case METRIC_TYPE_CARD_READER_VALID:
-        cJSON_AddStringToObject(json, "metric_type", "METRIC_TYPE_CARD_READER_VALID");
-        cJSON_AddBoolToObject(json, "bool_value", metric->bool_value);
-        break;
+    metrics_serializer_begin(&batch->serializer, wall_clock_offset_us);
+    batch->metric_count = 0;
+    size_t consumed = 0;
+    // batch_append() copies each metric to the same or an earlier slot, so appending in place is safe.
+    while (consumed < read_count && batch_append(batch, &batch->metrics[consumed]))
+    {
+        consumed++;
+    }
+    metrics_serializer_end(&batch->serializer);
 
-    default:
-        ESP_LOGE(TAG, "Unknown metric type: %s", queue_metric_type_to_name(metric->metric_type));
-        break;
+    esp_err_t ret = post_payload(batch);
+    if (ret != ESP_OK)
+    {
+        return ret;
     }
 
-    return json;
+    ret = metrics_store_consume(consumed);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to remove replayed metrics from store: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Replayed %zu stored metrics, %zu remaining.", consumed, metrics_store_count());
+    return ESP_OK;
 }
 
-static void metrics_publisher_handler(void *)
+/**
+ * @brief Moves every waiting critical metric into a critical batch.
+ */
+static void collect_critical_metrics(void)
 {
+    if (event_bus_pending(metrics_critical_subscription) == 0)
+    {
+        return;
+    }
+
+    metrics_batch_t *batch = batch_acquire(true);
     for (;;)
     {
-        metric_t msg;
-        xQueueReceive(queue_handle_metrics, &msg, portMAX_DELAY);
+        metric_t metric;
+        if (!event_bus_peek(metrics_critical_subscription, &metric) || !batch_append(batch, &metric))
+        {
+            break;
+        }
+        event_bus_receive(metrics_critical_subscription, &metric, 0);
+    }
+    batch_submit(batch);
+}
 
-        cJSON *metric_json = metric_to_cjson(&msg);
-        char *metric_json_string = cJSON_Print(metric_json);
+/**
+ * @brief Adds a bulk metric to the bulk batch being filled, submitting the
+ * batch first if it is full.
+ *
+ * @param metric Metric to add.
+ */
+static void collect_bulk_metric(const metric_t *metric)
+{
+    if (bulk_batch != NULL && batch_append(bulk_batch, metric))
+    {
+        return;
+    }
 
-        esp_err_t ret = esp_http_client_set_header(http_client_handle, "Content-Type", "application/json");
-        if (ret != ESP_OK)
+    if (bulk_batch != NULL)
+    {
+        batch_submit(bulk_batch);
+    }
+    bulk_batch = batch_acquire(false);
+    bulk_batch_start = xTaskGetTickCount();
+    batch_append(bulk_batch, metric);
+}
+
+/**
+ * @brief Aggregates a bulk metric or adds it to the bulk batch.
+ *
+ * @param metric Metric to collect.
+ */
+static void collect_metric(const metric_t *metric)
+{
+    if (METRICS_PUBLISHER_AGGREGATION_ENABLED && metrics_aggregator_add(metric))
+    {
+        return;
+    }
+
+    collect_bulk_metric(metric);
+}
+
+/**
+ * @brief Drains every registered sensor ring, reading the metrics in place.
+ */
+static void collect_ring_metrics(void)
+{
+    spsc_ring_t *registered_rings[METRICS_PUBLISHER_MAX_RINGS];
+    size_t registered_ring_count;
+
+    taskENTER_CRITICAL(&rings_lock);
+    registered_ring_count = ring_count;
+    memcpy(registered_rings, rings, registered_ring_count * sizeof(registered_rings[0]));
+    taskEXIT_CRITICAL(&rings_lock);
+
+    for (size_t i = 0; i < registered_ring_count; i++)
+    {
+        const metric_t *metrics;
+        size_t metric_count;
+        while ((metric_count = spsc_ring_peek(registered_rings[i], &metrics, SIZE_MAX)) > 0)
         {
-            ESP_LOGE(TAG, "Failed to set http client header: %s", esp_err_to_name(ret));
+            const int64_t now_us = esp_timer_get_time();
+            for (size_t j = 0; j < metric_count; j++)
+            {
+                queue_stats_record_latency(&registered_rings[i]->stats, now_us - metrics[j].timestamp_us);
+                collect_metric(&metrics[j]);
+            }
+            spsc_ring_release(registered_rings[i], metric_count);
         }
+    }
+}
 
-        ret = esp_http_client_set_post_field(http_client_handle, metric_json_string, strlen(metric_json_string));
-        if (ret != ESP_OK)
+/**
+ * @brief Adds the statistics of every inter-task queue to the bulk batch.
+ */
+static void collect_queue_stats(void)
+{
+    static queue_stats_snapshot_t snapshots[METRICS_PUBLISHER_QUEUE_STATS_MAX_QUEUES];
+    const size_t snapshot_count = queue_stats_snapshot_all(snapshots, METRICS_PUBLISHER_QUEUE_STATS_MAX_QUEUES);
+    const int64_t now_us = esp_timer_get_time();
+
+    for (size_t i = 0; i < snapshot_count; i++)
+    {
+        const queue_stats_snapshot_t *snapshot = &snapshots[i];
+        metric_t metric = {
+            .metric_type = METRIC_TYPE_QUEUE_STATS,
+            .kind = METRIC_KIND_SAMPLE,
+            .timestamp_us = now_us,
+            .queue_stats = {
+                .capacity = snapshot->capacity > UINT16_MAX ? UINT16_MAX : snapshot->capacity,
+                .high_water = snapshot->high_water > UINT16_MAX ? UINT16_MAX : snapshot->high_water,
+                .enqueued = snapshot->enqueued,
+                .dropped = snapshot->dropped,
+                .latency_p50_us = queue_stats_latency_percentile_us(snapshot, 50),
+                .latency_p99_us = queue_stats_latency_percentile_us(snapshot, 99),
+            },
+        };
+        memcpy(metric.queue_stats.name, snapshot->name, sizeof(metric.queue_stats.name));
+        collect_bulk_metric(&metric);
+
+        if (snapshot->dropped > 0)
         {
-            ESP_LOGE(TAG, "Failed to set http client post field: %s", esp_err_to_name(ret));
+            ESP_LOGW(TAG, "Queue \"%s\" dropped %lu of %lu items, high water %lu of %lu.", snapshot->name, (unsigned long)snapshot->dropped, (unsigned long)(snapshot->enqueued + snapshot->dropped), (unsigned long)snapshot->high_water, (unsigned long)snapshot->capacity);
         }
+    }
+}
 
-        ret = esp_http_client_perform(http_client_handle);
+/**
+ * @brief Adds the timing statistics of every sensor loop to the bulk batch.
+ */
+static void collect_sampling_stats(void)
+{
+    static sampling_scheduler_snapshot_t snapshots[METRICS_PUBLISHER_SAMPLING_STATS_MAX_LOOPS];
+    const size_t snapshot_count = sampling_scheduler_snapshot_all(snapshots, METRICS_PUBLISHER_SAMPLING_STATS_MAX_LOOPS);
+    const int64_t now_us = esp_timer_get_time();
+
+    for (size_t i = 0; i < snapshot_count; i++)
+    {
+        const sampling_scheduler_snapshot_t *snapshot = &snapshots[i];
+        metric_t metric = {
+            .metric_type = METRIC_TYPE_SAMPLING_STATS,
+            .kind = METRIC_KIND_SAMPLE,
+            .timestamp_us = now_us,
+            .sampling_stats = {
+                .period_us = snapshot->period_us,
+                .released = snapshot->released,
+                .overruns = snapshot->overruns,
+                .jitter_p99_us = sampling_scheduler_jitter_percentile_us(snapshot, 99),
+                .jitter_max_us = snapshot->jitter_max_us,
+            },
+        };
+        memcpy(metric.sampling_stats.name, snapshot->name, sizeof(metric.sampling_stats.name));
+        collect_bulk_metric(&metric);
+
+        if (snapshot->overruns > 0)
+        {
+            ESP_LOGW(TAG, "Sensor loop \"%s\" overran %lu of %lu periods of %lu us, max jitter %lu us.", snapshot->name, (unsigned long)snapshot->overruns, (unsigned long)snapshot->released, (unsigned long)snapshot->period_us, (unsigned long)snapshot->jitter_max_us);
+        }
+    }
+}
+
+/**
+ * @brief Task handler for the metrics collector.
+ * Drains the bulk metrics from the sensor rings and the event bus into a
+ * batch and hands it to the transmit task
+ * once the batch is full or its oldest metric reaches the maximum batch age.
+ * Serialization happens here, so it overlaps with the transfer of the
+ * previous batch.
+ *
+ * With aggregation enabled, numeric samples are folded into per metric type
+ * statistics and only one summary per type is published per window.
+ *
+ * Critical metrics are checked for at least every
+ * METRICS_PUBLISHER_CRITICAL_POLL_MS, and critical batches jump ahead of
+ * queued bulk batches.
+ *
+ * Every METRICS_PUBLISHER_QUEUE_STATS_PERIOD_MS the statistics of all
+ * inter-task queues and sensor loops are added to the bulk batch.
+ *
+ * @param pvParameters Unused.
+ */
+static void collector_task_handler(void *)
+{
+    const TickType_t critical_poll = pdMS_TO_TICKS(METRICS_PUBLISHER_CRITICAL_POLL_MS);
+    const TickType_t batch_max_age = pdMS_TO_TICKS(METRICS_PUBLISHER_BATCH_MAX_AGE_MS);
+    const TickType_t aggregation_window = pdMS_TO_TICKS(METRICS_PUBLISHER_AGGREGATION_WINDOW_MS);
+    const TickType_t queue_stats_period = pdMS_TO_TICKS(METRICS_PUBLISHER_QUEUE_STATS_PERIOD_MS);
+
+    TickType_t window_start = xTaskGetTickCount();
+    TickType_t queue_stats_start = window_start;
+    int64_t window_start_us = esp_timer_get_time();
+    for (;;)
+    {
+        collect_critical_metrics();
+        collect_ring_metrics();
+
+        const TickType_t now = xTaskGetTickCount();
+        if (METRICS_PUBLISHER_AGGREGATION_ENABLED && now - window_start >= aggregation_window)
+        {
+            metric_t summaries[METRICS_PUBLISHER_AGGREGATION_MAX_SUMMARIES];
+            const size_t summary_count = metrics_aggregator_flush(summaries, METRICS_PUBLISHER_AGGREGATION_MAX_SUMMARIES, window_start_us);
+            for (size_t i = 0; i < summary_count; i++)
+            {
+                collect_bulk_metric(&summaries[i]);
+            }
+            window_start = now;
+            window_start_us = esp_timer_get_time();
+        }
+
+        if (now - queue_stats_start >= queue_stats_period)
+        {
+            collect_queue_stats();
+            collect_sampling_stats();
+            queue_stats_start = now;
+        }
+
+        TickType_t wait = critical_poll;
+        if (bulk_batch != NULL)
+        {
+            const TickType_t batch_age = now - bulk_batch_start;
+            if (batch_age >= batch_max_age)
+            {
+                batch_submit(bulk_batch);
+                bulk_batch = NULL;
+            }
+            else if (batch_max_age - batch_age < wait)
+            {
+                wait = batch_max_age - batch_age;
+            }
+        }
+
+        metric_t metric;
+        if (!event_bus_receive(metrics_subscription, &metric, wait))
+        {
+            continue;
+        }
+
+        collect_metric(&metric);
+    }
+}
+
+/**
+ * @brief Task handler for the metrics transmitter.
+ * Posts ready batches in order, stores the metrics of batches that could not
+ * be delivered, and drains the stored metrics whenever it has nothing else to send.
+ *
+ * @param pvParameters Unused.
+ */
+static void transmit_task_handler(void *)
+{
+    for (;;)
+    {
+        metrics_batch_t *batch;
+        xQueueReceive(ready_batches_queue_handle, &batch, portMAX_DELAY);
+
+        const esp_err_t ret = post_payload(batch);
         if (ret != ESP_OK)
         {
-            ESP_LOGE(TAG, "Failed to perform POST request: %s.", esp_err_to_name(ret));
+            ESP_LOGW(TAG, "Storing %zu undelivered metrics...", batch->metric_count);
+            const esp_err_t store_ret = metrics_store_write(batch->metrics, batch->metric_count, batch->serializer.wall_clock_offset_us);
+            if (store_ret != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to store undelivered metrics: %s", esp_err_to_name(store_ret));
+            }
+        }
+        else if (batch->critical)
+        {
+            // Metrics are batched in order, so the first one has waited the longest since it was taken.
+            const int64_t latency_us = esp_timer_get_time() - batch->metrics[0].timestamp_us;
+            if (latency_us > critical_latency_max_us)
+            {
+                critical_latency_max_us = latency_us;
+            }
+            ESP_LOGI(TAG, "Delivered %zu critical metrics in %lld us, worst case so far %lld us.", batch->metric_count, latency_us, critical_latency_max_us);
         }
 
-        free(metric_json_string);
-        cJSON_free(metric_json);
+        // Drain the store while the endpoint keeps accepting, but give way as soon as a live batch is ready.
+        esp_err_t replay_ret = ret;
+        while (replay_ret == ESP_OK && metrics_store_count() > 0 && uxQueueMessagesWaiting(ready_batches_queue_handle) == 0)
+        {
+            replay_ret = replay_stored_metrics(batch);
+        }
+
+        xQueueSendToBack(free_batches_queue_handle, &batch, portMAX_DELAY);
     }
 }
 
@@ -124,7 +533,6 @@ static esp_err_t http_event_handler(esp_http_client_event_t *event) { return ESP
 esp_err_t metrics_publisher_init(void)
 {
     esp_err_t esp_ret;
-    BaseType_t rtos_ret;
     esp_err_t cleanup_ret;
 
     ESP_LOGI(TAG, "Initializing HTTP client...");
@@ -137,20 +545,104 @@ esp_err_t metrics_publisher_init(void)
     if (http_client_handle == NULL)
     {
         ESP_LOGE(TAG, "Failed to initialize http client.");
+        esp_ret = ESP_FAIL;
         goto cleanup_none;
     }
 
-    ESP_LOGI(TAG, "Creating task...");
-    rtos_ret = xTaskCreate(metrics_publisher_handler, "Metrics publisher", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &task_handle);
-    if (rtos_ret != pdPASS)
+    ESP_LOGI(TAG, "Initializing metrics store...");
+    esp_ret = metrics_store_init();
+    if (esp_ret != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to craete task with error code: %d", rtos_ret);
+        ESP_LOGE(TAG, "Failed to initialize metrics store: %s", esp_err_to_name(esp_ret));
+        goto cleanup_http_client;
+    }
+
+    ESP_LOGI(TAG, "Creating batch queues...");
+    if (app_resources_queue_depth(APP_RESOURCES_QUEUE_FREE_BATCHES) < METRICS_PUBLISHER_BATCH_COUNT || app_resources_queue_depth(APP_RESOURCES_QUEUE_READY_BATCHES) < METRICS_PUBLISHER_BATCH_COUNT)
+    {
+        ESP_LOGE(TAG, "Batch queues cannot hold all %d batches.", METRICS_PUBLISHER_BATCH_COUNT);
+        esp_ret = ESP_ERR_INVALID_SIZE;
+        goto cleanup_http_client;
+    }
+
+    free_batches_queue_handle = app_resources_create_queue(APP_RESOURCES_QUEUE_FREE_BATCHES, sizeof(metrics_batch_t *));
+    if (free_batches_queue_handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create free batches queue.");
         esp_ret = ESP_FAIL;
         goto cleanup_http_client;
     }
 
+    ready_batches_queue_handle = app_resources_create_queue(APP_RESOURCES_QUEUE_READY_BATCHES, sizeof(metrics_batch_t *));
+    if (ready_batches_queue_handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create ready batches queue.");
+        esp_ret = ESP_FAIL;
+        goto cleanup_free_batches_queue;
+    }
+
+    for (size_t i = 0; i < METRICS_PUBLISHER_BATCH_COUNT; i++)
+    {
+        metrics_batch_t *batch = &batches[i];
+        metrics_serializer_init(&batch->serializer, METRICS_PUBLISHER_FORMAT, batch->payload, sizeof(batch->payload));
+        xQueueSendToBack(free_batches_queue_handle, &batch, 0);
+    }
+
+    ESP_LOGI(TAG, "Subscribing to metrics...");
+    esp_ret = event_bus_subscribe(EVENT_BUS_TOPIC_METRICS, APP_RESOURCES_QUEUE_METRICS, EVENT_BUS_POLICY_DROP_OLDEST, &metrics_subscription);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to subscribe to metrics: %s", esp_err_to_name(esp_ret));
+        goto cleanup_ready_batches_queue;
+    }
+
+    esp_ret = event_bus_subscribe(EVENT_BUS_TOPIC_METRICS_CRITICAL, APP_RESOURCES_QUEUE_METRICS_CRITICAL, EVENT_BUS_POLICY_DROP_NEWEST, &metrics_critical_subscription);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to subscribe to critical metrics: %s", esp_err_to_name(esp_ret));
+        goto cleanup_metrics_subscription;
+    }
+
+    ESP_LOGI(TAG, "Creating transmit task...");
+    transmit_task_handle = app_resources_create_task(APP_RESOURCES_TASK_METRICS_TRANSMIT, transmit_task_handler);
+    if (transmit_task_handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create transmit task.");
+        esp_ret = ESP_FAIL;
+        goto cleanup_metrics_critical_subscription;
+    }
+
+    ESP_LOGI(TAG, "Creating collector task...");
+    collector_task_handle = app_resources_create_task(APP_RESOURCES_TASK_METRICS_COLLECTOR, collector_task_handler);
+    if (collector_task_handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create collector task.");
+        esp_ret = ESP_FAIL;
+        goto cleanup_transmit_task;
+    }
+
     return ESP_OK;
 
+cleanup_transmit_task:
+    ESP_LOGI(TAG, "Deleting transmit task...");
+    vTaskDelete(transmit_task_handle);
+    transmit_task_handle = NULL;
+cleanup_metrics_critical_subscription:
+    ESP_LOGI(TAG, "Unsubscribing from critical metrics...");
+    event_bus_unsubscribe(metrics_critical_subscription);
+    metrics_critical_subscription = NULL;
+cleanup_metrics_subscription:
+    ESP_LOGI(TAG, "Unsubscribing from metrics...");
+    event_bus_unsubscribe(metrics_subscription);
+    metrics_subscription = NULL;
+cleanup_ready_batches_queue:
+    ESP_LOGI(TAG, "Deleting ready batches queue...");
+    vQueueDelete(ready_batches_queue_handle);
+    ready_batches_queue_handle = NULL;
+cleanup_free_batches_queue:
+    ESP_LOGI(TAG, "Deleting free batches queue...");
+    vQueueDelete(free_batches_queue_handle);
+    free_batches_queue_handle = NULL;
 cleanup_http_client:
     ESP_LOGI(TAG, "Cleaning up HTTP client...");
     cleanup_ret = esp_http_client_cleanup(http_client_handle);
@@ -163,10 +655,78 @@ cleanup_none:
     return esp_ret;
 }
 
+esp_err_t metrics_publisher_register_ring(spsc_ring_t *ring, const char *name)
+{
+    esp_err_t ret = queue_stats_register(&ring->stats, name, ring->mask + 1);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    taskENTER_CRITICAL(&rings_lock);
+    if (ring_count < METRICS_PUBLISHER_MAX_RINGS)
+    {
+        rings[ring_count++] = ring;
+    }
+    else
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+    taskEXIT_CRITICAL(&rings_lock);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot register more than %d metric rings.", METRICS_PUBLISHER_MAX_RINGS);
+        queue_stats_unregister(&ring->stats);
+    }
+    return ret;
+}
+
+void metrics_publisher_unregister_ring(spsc_ring_t *ring)
+{
+    taskENTER_CRITICAL(&rings_lock);
+    for (size_t i = 0; i < ring_count; i++)
+    {
+        if (rings[i] == ring)
+        {
+            rings[i] = rings[--ring_count];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&rings_lock);
+
+    queue_stats_unregister(&ring->stats);
+}
+
 esp_err_t metrics_publisher_deinit(void)
 {
     esp_err_t ret;
 
+    ESP_LOGI(TAG, "Deleting collector task...");
+    vTaskDelete(collector_task_handle);
+    collector_task_handle = NULL;
+    bulk_batch = NULL;
+
+    ESP_LOGI(TAG, "Deleting transmit task...");
+    vTaskDelete(transmit_task_handle);
+    transmit_task_handle = NULL;
+
+    ESP_LOGI(TAG, "Unsubscribing from critical metrics...");
+    event_bus_unsubscribe(metrics_critical_subscription);
+    metrics_critical_subscription = NULL;
+
+    ESP_LOGI(TAG, "Unsubscribing from metrics...");
+    event_bus_unsubscribe(metrics_subscription);
+    metrics_subscription = NULL;
+
+    ESP_LOGI(TAG, "Deleting ready batches queue...");
+    vQueueDelete(ready_batches_queue_handle);
+    ready_batches_queue_handle = NULL;
+
+    ESP_LOGI(TAG, "Deleting free batches queue...");
+    vQueueDelete(free_batches_queue_handle);
+    free_batches_queue_handle = NULL;
+
     ESP_LOGI(TAG, "Cleaning up HTTP client...");
     ret = esp_http_client_cleanup(http_client_handle);
     if (ret != ESP_OK)
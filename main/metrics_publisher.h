@@ -2,12 +2,18 @@
 
 #include <esp_err.h>
 
+#include "spsc_ring.h"
+
 /**
  * @brief Initializes the metrics publisher module.
  *
- * Sets up the HTTP client and creates the FreeRTOS task responsible
- * for reading metrics from the metrics queue and sending them to the
- * configured remote endpoint using HTTP POST requests.
+ * Sets up the HTTP client and creates two FreeRTOS tasks: a collector
+ * that receives metrics from the event bus and serializes them into
+ * batches, and a transmitter that sends each batch to the configured
+ * remote endpoint in one HTTP POST request. Serializing the next batch
+ * overlaps with sending the previous one. The statistics of every
+ * inter-task queue and every sensor loop are published periodically as
+ * METRIC_TYPE_QUEUE_STATS and METRIC_TYPE_SAMPLING_STATS.
  *
  * @return ESP_OK on success, or an error code on failure.
  */
@@ -17,10 +23,33 @@ esp_err_t metrics_publisher_init(void);
 /**
  * @brief Deinitializes the metrics publisher module.
  *
- * Cleans up the HTTP client and releases any allocated resources
- * associated with the metrics publishing functionality.
+ * Stops the publisher tasks, cleans up the HTTP client and releases any
+ * allocated resources associated with the metrics publishing functionality.
  *
  * @return ESP_OK on success, or an error code on failure.
  */
 
 esp_err_t metrics_publisher_deinit(void);
+
+/**
+ * @brief Registers a sensor's metric ring with the metrics publisher.
+ *
+ * The publisher becomes the consumer of the ring and drains it at least every
+ * few milliseconds. High rate sensors use a ring instead of the event bus so
+ * their metrics are handed over without locking or copying through a queue.
+ *
+ * The statistics of the ring are registered under the given name.
+ *
+ * @param ring Ring to drain.
+ * @param name Short name of the ring used in its statistics.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if too many rings are registered.
+ */
+esp_err_t metrics_publisher_register_ring(spsc_ring_t *ring, const char *name);
+
+/**
+ * @brief Stops the metrics publisher from draining a ring.
+ *
+ * @param ring Ring to forget.
+ */
+void metrics_publisher_unregister_ring(spsc_ring_t *ring);
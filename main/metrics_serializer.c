@@ -0,0 +1,388 @@
+#include "metrics_serializer.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "queue.h"
+
+static const char *TAG = "metrics serializer";
+
+/* Room kept free at the end of a JSON buffer for the closing brackets and NUL terminator. */
+#define METRICS_SERIALIZER_JSON_TERMINATOR_SIZE 3
+
+/* Longest float written as %.7g, "-1.234568e+38", or null, with the NUL terminator. */
+#define METRICS_SERIALIZER_JSON_FLOAT_SIZE 16
+
+#define METRICS_SERIALIZER_BINARY_HEADER_SIZE 22
+#define METRICS_SERIALIZER_BINARY_RECORD_HEADER_SIZE 6
+#define METRICS_SERIALIZER_BINARY_SAMPLE_VALUE_SIZE 4
+#define METRICS_SERIALIZER_BINARY_ACCELEROMETER_SAMPLE_VALUE_SIZE 32
+#define METRICS_SERIALIZER_BINARY_QUEUE_STATS_VALUE_SIZE 32
+#define METRICS_SERIALIZER_BINARY_SAMPLING_STATS_VALUE_SIZE 32
+#define METRICS_SERIALIZER_BINARY_SUMMARY_VALUE_SIZE 20
+#define METRICS_SERIALIZER_BINARY_MAX_RECORDS UINT16_MAX
+
+static void write_u16_le(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+static void write_u32_le(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static void write_u64_le(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static void write_float_le(uint8_t *out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write_u32_le(out, bits);
+}
+
+/**
+ * @brief Formats a float as a JSON number, or null for NaN and infinity that JSON has no number for.
+ *
+ * @param out Buffer of METRICS_SERIALIZER_JSON_FLOAT_SIZE bytes.
+ * @param value Value to format.
+ *
+ * @return out.
+ */
+static const char *format_json_float(char *out, float value)
+{
+    if (isfinite(value))
+    {
+        snprintf(out, METRICS_SERIALIZER_JSON_FLOAT_SIZE, "%.7g", value);
+    }
+    else
+    {
+        strcpy(out, "null");
+    }
+    return out;
+}
+
+static int format_json_sample(char *start, size_t available, const char *separator, long long timestamp_us, const char *metric_type, const metric_t *metric)
+{
+    char value[METRICS_SERIALIZER_JSON_FLOAT_SIZE];
+    int written;
+    switch (metric->metric_type)
+    {
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_X:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_X:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_Y:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_Z:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL:
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"float_value\":%s}", separator, timestamp_us, metric_type, format_json_float(value, metric->float_value));
+        break;
+
+    case METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE:
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"uint16_value\":%u}", separator, timestamp_us, metric_type, metric->uint16_value);
+        break;
+
+    case METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE:
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"zone_distance\":{\"zone\":%u,\"distance_mm\":%u}}", separator, timestamp_us, metric_type, metric->zone_distance.zone, metric->zone_distance.distance_mm);
+        break;
+
+    case METRIC_TYPE_ACCELEROMETER_SAMPLE:
+    {
+        const metric_accelerometer_sample_t *sample = &metric->accelerometer_sample;
+        char values[8][METRICS_SERIALIZER_JSON_FLOAT_SIZE];
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"acceleration\":{\"x\":%s,\"y\":%s,\"z\":%s,\"total\":%s},\"rotation\":{\"x\":%s,\"y\":%s,\"z\":%s,\"total\":%s}}", separator, timestamp_us, metric_type, format_json_float(values[0], sample->acceleration_x), format_json_float(values[1], sample->acceleration_y), format_json_float(values[2], sample->acceleration_z), format_json_float(values[3], sample->acceleration_total), format_json_float(values[4], sample->rotation_x), format_json_float(values[5], sample->rotation_y), format_json_float(values[6], sample->rotation_z), format_json_float(values[7], sample->rotation_total));
+        break;
+    }
+
+    case METRIC_TYPE_QUEUE_STATS:
+    {
+        const metric_queue_stats_t *stats = &metric->queue_stats;
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"queue_stats\":{\"name\":\"%.*s\",\"capacity\":%u,\"high_water\":%u,\"enqueued\":%lu,\"dropped\":%lu,\"latency_p50_us\":%lu,\"latency_p99_us\":%lu}}", separator, timestamp_us, metric_type, (int)sizeof(stats->name), stats->name, stats->capacity, stats->high_water, (unsigned long)stats->enqueued, (unsigned long)stats->dropped, (unsigned long)stats->latency_p50_us, (unsigned long)stats->latency_p99_us);
+        break;
+    }
+
+    case METRIC_TYPE_SAMPLING_STATS:
+    {
+        const metric_sampling_stats_t *stats = &metric->sampling_stats;
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"sampling_stats\":{\"name\":\"%.*s\",\"period_us\":%lu,\"released\":%lu,\"overruns\":%lu,\"jitter_p99_us\":%lu,\"jitter_max_us\":%lu}}", separator, timestamp_us, metric_type, (int)sizeof(stats->name), stats->name, (unsigned long)stats->period_us, (unsigned long)stats->released, (unsigned long)stats->overruns, (unsigned long)stats->jitter_p99_us, (unsigned long)stats->jitter_max_us);
+        break;
+    }
+
+    case METRIC_TYPE_CARD_READER_VALID:
+    case METRIC_TYPE_ALARM_TRIGGERED:
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"bool_value\":%s}", separator, timestamp_us, metric_type, metric->bool_value ? "true" : "false");
+        break;
+
+    default:
+        ESP_LOGE(TAG, "Unknown metric type: %s", metric_type);
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld}", separator, timestamp_us);
+        break;
+    }
+
+    return written;
+}
+
+static esp_err_t append_json(metrics_serializer_t *serializer, const metric_t *metric)
+{
+    char *const start = serializer->buffer + serializer->length;
+    const size_t available = serializer->capacity - serializer->length - METRICS_SERIALIZER_JSON_TERMINATOR_SIZE;
+    const char *const separator = serializer->metric_count > 0 ? "," : "";
+    const char *const metric_type = queue_metric_type_to_name(metric->metric_type);
+    const long long timestamp_us = (long long)metric->timestamp_us;
+
+    int written;
+    if (metric->kind == METRIC_KIND_SUMMARY)
+    {
+        const metric_summary_t *summary = &metric->summary;
+        char values[4][METRICS_SERIALIZER_JSON_FLOAT_SIZE];
+        written = snprintf(start, available, "%s{\"timestamp_us\":%lld,\"metric_type\":\"%s\",\"summary\":{\"count\":%lu,\"min\":%s,\"max\":%s,\"mean\":%s,\"stddev\":%s}}", separator, timestamp_us, metric_type, (unsigned long)summary->count, format_json_float(values[0], summary->min), format_json_float(values[1], summary->max), format_json_float(values[2], summary->mean), format_json_float(values[3], summary->stddev));
+    }
+    else
+    {
+        written = format_json_sample(start, available, separator, timestamp_us, metric_type, metric);
+    }
+
+    if (written < 0 || (size_t)written >= available)
+    {
+        start[0] = '\0';
+        return ESP_ERR_NO_MEM;
+    }
+
+    serializer->length += written;
+    return ESP_OK;
+}
+
+static uint32_t binary_sample_value(const metric_t *metric)
+{
+    uint32_t value;
+    switch (metric->metric_type)
+    {
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_X:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z:
+    case METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_X:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_Y:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_Z:
+    case METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL:
+        memcpy(&value, &metric->float_value, sizeof(value));
+        return value;
+
+    case METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE:
+        return metric->uint16_value;
+
+    case METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE:
+        return metric->zone_distance.distance_mm | ((uint32_t)metric->zone_distance.zone << 16);
+
+    case METRIC_TYPE_CARD_READER_VALID:
+    case METRIC_TYPE_ALARM_TRIGGERED:
+        return metric->bool_value ? 1 : 0;
+
+    default:
+        ESP_LOGE(TAG, "Unknown metric type: %s", queue_metric_type_to_name(metric->metric_type));
+        return 0;
+    }
+}
+
+static size_t binary_value_size(const metric_t *metric)
+{
+    if (metric->kind == METRIC_KIND_SUMMARY)
+    {
+        return METRICS_SERIALIZER_BINARY_SUMMARY_VALUE_SIZE;
+    }
+    if (metric->metric_type == METRIC_TYPE_ACCELEROMETER_SAMPLE)
+    {
+        return METRICS_SERIALIZER_BINARY_ACCELEROMETER_SAMPLE_VALUE_SIZE;
+    }
+    if (metric->metric_type == METRIC_TYPE_QUEUE_STATS)
+    {
+        return METRICS_SERIALIZER_BINARY_QUEUE_STATS_VALUE_SIZE;
+    }
+    if (metric->metric_type == METRIC_TYPE_SAMPLING_STATS)
+    {
+        return METRICS_SERIALIZER_BINARY_SAMPLING_STATS_VALUE_SIZE;
+    }
+    return METRICS_SERIALIZER_BINARY_SAMPLE_VALUE_SIZE;
+}
+
+static esp_err_t append_binary(metrics_serializer_t *serializer, const metric_t *metric)
+{
+    const size_t value_size = binary_value_size(metric);
+    const size_t record_size = METRICS_SERIALIZER_BINARY_RECORD_HEADER_SIZE + value_size;
+    if (serializer->capacity - serializer->length < record_size || serializer->metric_count >= METRICS_SERIALIZER_BINARY_MAX_RECORDS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (serializer->metric_count == 0)
+    {
+        serializer->base_timestamp_us = metric->timestamp_us;
+    }
+
+    const int64_t timestamp_delta_us = metric->timestamp_us - serializer->base_timestamp_us;
+    if (timestamp_delta_us < INT32_MIN || timestamp_delta_us > INT32_MAX)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t *const record = (uint8_t *)serializer->buffer + serializer->length;
+    record[0] = (uint8_t)metric->metric_type;
+    record[1] = (uint8_t)metric->kind;
+    write_u32_le(&record[2], (uint32_t)(int32_t)timestamp_delta_us);
+
+    uint8_t *const value = &record[METRICS_SERIALIZER_BINARY_RECORD_HEADER_SIZE];
+    if (metric->kind == METRIC_KIND_SUMMARY)
+    {
+        write_u32_le(&value[0], metric->summary.count);
+        write_float_le(&value[4], metric->summary.min);
+        write_float_le(&value[8], metric->summary.max);
+        write_float_le(&value[12], metric->summary.mean);
+        write_float_le(&value[16], metric->summary.stddev);
+    }
+    else if (metric->metric_type == METRIC_TYPE_ACCELEROMETER_SAMPLE)
+    {
+        const metric_accelerometer_sample_t *sample = &metric->accelerometer_sample;
+        write_float_le(&value[0], sample->acceleration_x);
+        write_float_le(&value[4], sample->acceleration_y);
+        write_float_le(&value[8], sample->acceleration_z);
+        write_float_le(&value[12], sample->acceleration_total);
+        write_float_le(&value[16], sample->rotation_x);
+        write_float_le(&value[20], sample->rotation_y);
+        write_float_le(&value[24], sample->rotation_z);
+        write_float_le(&value[28], sample->rotation_total);
+    }
+    else if (metric->metric_type == METRIC_TYPE_QUEUE_STATS)
+    {
+        const metric_queue_stats_t *stats = &metric->queue_stats;
+        memcpy(&value[0], stats->name, sizeof(stats->name));
+        write_u16_le(&value[12], stats->capacity);
+        write_u16_le(&value[14], stats->high_water);
+        write_u32_le(&value[16], stats->enqueued);
+        write_u32_le(&value[20], stats->dropped);
+        write_u32_le(&value[24], stats->latency_p50_us);
+        write_u32_le(&value[28], stats->latency_p99_us);
+    }
+    else if (metric->metric_type == METRIC_TYPE_SAMPLING_STATS)
+    {
+        const metric_sampling_stats_t *stats = &metric->sampling_stats;
+        memcpy(&value[0], stats->name, sizeof(stats->name));
+        write_u32_le(&value[12], stats->period_us);
+        write_u32_le(&value[16], stats->released);
+        write_u32_le(&value[20], stats->overruns);
+        write_u32_le(&value[24], stats->jitter_p99_us);
+        write_u32_le(&value[28], stats->jitter_max_us);
+    }
+    else
+    {
+        write_u32_le(&value[0], binary_sample_value(metric));
+    }
+
+    serializer->length += record_size;
+    return ESP_OK;
+}
+
+void metrics_serializer_init(metrics_serializer_t *serializer, metrics_serializer_format_t format, char *buffer, size_t capacity)
+{
+    serializer->format = format;
+    serializer->buffer = buffer;
+    serializer->capacity = capacity;
+    metrics_serializer_begin(serializer, 0);
+}
+
+const char *metrics_serializer_content_type(const metrics_serializer_t *serializer)
+{
+    switch (serializer->format)
+    {
+    case METRICS_SERIALIZER_FORMAT_JSON:
+        return "application/json";
+    case METRICS_SERIALIZER_FORMAT_BINARY:
+        return "application/octet-stream";
+    default:
+        ESP_LOGE(TAG, "Received invalid serializer format, enum code %d.", serializer->format);
+        return "application/octet-stream";
+    }
+}
+
+void metrics_serializer_begin(metrics_serializer_t *serializer, int64_t wall_clock_offset_us)
+{
+    serializer->metric_count = 0;
+    serializer->base_timestamp_us = 0;
+    serializer->wall_clock_offset_us = wall_clock_offset_us;
+
+    int written;
+    switch (serializer->format)
+    {
+    case METRICS_SERIALIZER_FORMAT_JSON:
+        written = snprintf(serializer->buffer, serializer->capacity, "{\"wall_clock_offset_us\":%lld,\"metrics\":[", (long long)wall_clock_offset_us);
+        serializer->length = written > 0 ? (size_t)written : 0;
+        break;
+
+    case METRICS_SERIALIZER_FORMAT_BINARY:
+        /* The header is filled in by metrics_serializer_end() once the record count is known. */
+        serializer->length = METRICS_SERIALIZER_BINARY_HEADER_SIZE;
+        break;
+    }
+}
+
+esp_err_t metrics_serializer_append(metrics_serializer_t *serializer, const metric_t *metric)
+{
+    esp_err_t ret;
+    switch (serializer->format)
+    {
+    case METRICS_SERIALIZER_FORMAT_JSON:
+        ret = append_json(serializer, metric);
+        break;
+
+    case METRICS_SERIALIZER_FORMAT_BINARY:
+        ret = append_binary(serializer, metric);
+        break;
+
+    default:
+        ret = ESP_ERR_INVALID_STATE;
+        break;
+    }
+
+    if (ret == ESP_OK)
+    {
+        serializer->metric_count++;
+    }
+    return ret;
+}
+
+void metrics_serializer_end(metrics_serializer_t *serializer)
+{
+    uint8_t *header;
+    switch (serializer->format)
+    {
+    case METRICS_SERIALIZER_FORMAT_JSON:
+        serializer->buffer[serializer->length++] = ']';
+        serializer->buffer[serializer->length++] = '}';
+        serializer->buffer[serializer->length] = '\0';
+        break;
+
+    case METRICS_SERIALIZER_FORMAT_BINARY:
+        header = (uint8_t *)serializer->buffer;
+        header[0] = 'M';
+        header[1] = 'T';
+        header[2] = METRICS_SERIALIZER_BINARY_VERSION;
+        header[3] = 0;
+        write_u16_le(&header[4], (uint16_t)serializer->metric_count);
+        write_u64_le(&header[6], (uint64_t)serializer->base_timestamp_us);
+        write_u64_le(&header[14], (uint64_t)serializer->wall_clock_offset_us);
+        break;
+    }
+}
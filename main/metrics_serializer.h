@@ -0,0 +1,127 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+/**
+ * @brief Wire formats supported by the serializer.
+ *
+ * Metric timestamps are monotonic microseconds since boot. Every payload
+ * carries one wall clock offset, the wall clock time at boot in microseconds
+ * since the epoch, which the receiver adds to the timestamps.
+ *
+ * METRICS_SERIALIZER_FORMAT_JSON produces a compact JSON object holding the
+ * "wall_clock_offset_us" and a "metrics" array of objects carrying the
+ * "timestamp_us", the metric type name and either its value or, for summaries, a
+ * "summary" object with count, min, max, mean and stddev. Accelerometer
+ * samples carry "acceleration" and "rotation" objects with x, y, z and total.
+ * Zone distances carry a "zone_distance" object with zone and distance_mm.
+ *
+ * METRICS_SERIALIZER_FORMAT_BINARY produces a little endian packed record
+ * stream. The payload starts with a 22 byte header:
+ *
+ *   offset 0  u8[2]  magic "MT"
+ *   offset 2  u8     format version (METRICS_SERIALIZER_BINARY_VERSION)
+ *   offset 3  u8     reserved, always 0
+ *   offset 4  u16    number of records
+ *   offset 6  i64    base timestamp in us, the timestamp of the first record
+ *   offset 14 i64    wall clock offset in us
+ *
+ * followed by one record per metric:
+ *
+ *   offset 0  u8     metric_type_t value
+ *   offset 1  u8     metric_kind_t value
+ *   offset 2  i32    timestamp in us relative to the base timestamp
+ *   offset 6         value, depending on the kind
+ *
+ * A sample value is 4 bytes: IEEE 754 float for float metrics, u16 zero
+ * extended to 32 bits for uint16 metrics, 0 or 1 for bool metrics, u16
+ * distance in mm followed by u8 zone index and a zero byte for zone
+ * distances.
+ * An accelerometer sample value is 32 bytes: the floats acceleration x, y,
+ * z, total followed by rotation x, y, z, total.
+ * A queue statistics value is 32 bytes: the queue name as 12 NUL padded
+ * bytes, u16 capacity, u16 high water mark, followed by the u32 enqueued
+ * and dropped counts and the u32 p50 and p99 latencies in us.
+ * A sampling statistics value is 32 bytes: the sensor loop name as 12 NUL
+ * padded bytes followed by the u32 period in us, release count, overrun
+ * count, p99 jitter in us and maximum jitter in us.
+ * A summary value is 20 bytes: u32 count followed by the float min, max,
+ * mean and stddev.
+ */
+typedef enum
+{
+    METRICS_SERIALIZER_FORMAT_JSON,
+    METRICS_SERIALIZER_FORMAT_BINARY,
+} metrics_serializer_format_t;
+
+#define METRICS_SERIALIZER_BINARY_VERSION 7
+
+/**
+ * @brief Streaming serializer that writes metrics into a caller owned buffer.
+ *
+ * The serializer never allocates memory. Metrics are appended one by one in
+ * the selected wire format, and the buffer can be reused for the next batch
+ * after calling metrics_serializer_begin() again.
+ */
+typedef struct
+{
+    metrics_serializer_format_t format;
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    size_t metric_count;
+    int64_t base_timestamp_us;
+    int64_t wall_clock_offset_us;
+} metrics_serializer_t;
+
+/**
+ * @brief Binds a serializer to a preallocated buffer.
+ *
+ * @param serializer Serializer to initialize.
+ * @param format Wire format to produce.
+ * @param buffer Buffer the serialized payload is written into.
+ * @param capacity Size of the buffer in bytes.
+ */
+void metrics_serializer_init(metrics_serializer_t *serializer, metrics_serializer_format_t format, char *buffer, size_t capacity);
+
+/**
+ * @brief Returns the HTTP content type matching the serializer's wire format.
+ */
+const char *metrics_serializer_content_type(const metrics_serializer_t *serializer);
+
+/**
+ * @brief Starts a new payload, discarding anything previously written.
+ *
+ * @param serializer Serializer to reset.
+ * @param wall_clock_offset_us Wall clock offset of the boot the metrics of this payload were taken in.
+ */
+void metrics_serializer_begin(metrics_serializer_t *serializer, int64_t wall_clock_offset_us);
+
+/**
+ * @brief Appends one metric to the payload.
+ *
+ * The payload is left untouched if the metric does not fit. In the binary
+ * format a metric also does not fit if its timestamp is too far from the
+ * base timestamp to be encoded.
+ *
+ * @param serializer Serializer to append to.
+ * @param metric Metric to serialize.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the metric does not fit.
+ */
+esp_err_t metrics_serializer_append(metrics_serializer_t *serializer, const metric_t *metric);
+
+/**
+ * @brief Terminates the payload.
+ *
+ * Space for the terminator is reserved by metrics_serializer_append(), so
+ * this call cannot fail. The payload is available in serializer->buffer with
+ * length serializer->length. JSON payloads are NUL terminated.
+ *
+ * @param serializer Serializer to finish.
+ */
+void metrics_serializer_end(metrics_serializer_t *serializer);
@@ -0,0 +1,486 @@
+#include "metrics_store.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "queue.h"
+
+static const char *TAG = "metrics store";
+
+#define METRICS_STORE_PARTITION_LABEL "metrics"
+#define METRICS_STORE_SECTOR_SIZE 4096
+#define METRICS_STORE_RECORD_STATE_ERASED 0xFFFFFFFFu
+#define METRICS_STORE_RECORD_STATE_WRITTEN 0x0000FFFFu
+#define METRICS_STORE_RECORD_STATE_CONSUMED 0x00000000u
+
+/**
+ * @brief Header written at the start of every sector in use.
+ *
+ * Sequence numbers increase by one every time the write position moves to a
+ * new sector, which lets init recover the ring order after a reboot. The wall
+ * clock offset applies to every record of the sector.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sequence;
+    int64_t wall_clock_offset_us;
+} sector_header_t;
+
+/**
+ * @brief One stored metric.
+ *
+ * The state only ever moves from ERASED to WRITTEN to CONSUMED, each step
+ * clearing bits, so records can be consumed in place without an erase. The
+ * metric is programmed before the state, so a record only reads as WRITTEN
+ * once its metric is complete.
+ */
+typedef struct
+{
+    uint32_t state;
+    metric_t metric;
+} record_t;
+
+typedef struct
+{
+    size_t sector;
+    size_t record;
+} position_t;
+
+/* The layout version and record size are part of the magic so a change of layout invalidates old sectors. */
+#define METRICS_STORE_LAYOUT_VERSION 2
+#define METRICS_STORE_SECTOR_MAGIC (0x4D530000u | (METRICS_STORE_LAYOUT_VERSION << 12) | sizeof(record_t))
+#define METRICS_STORE_RECORDS_PER_SECTOR ((METRICS_STORE_SECTOR_SIZE - sizeof(sector_header_t)) / sizeof(record_t))
+#define METRICS_STORE_RECORD_CAPACITY (sector_count * METRICS_STORE_RECORDS_PER_SECTOR)
+
+static const esp_partition_t *partition;
+static size_t sector_count;
+
+static position_t head;
+static uint32_t head_sequence;
+static int64_t head_wall_clock_offset_us;
+static position_t tail;
+static size_t stored_count;
+
+static size_t record_address(position_t position) { return position.sector * METRICS_STORE_SECTOR_SIZE + sizeof(sector_header_t) + position.record * sizeof(record_t); }
+
+static void advance(position_t *position)
+{
+    position->record++;
+    if (position->record >= METRICS_STORE_RECORDS_PER_SECTOR)
+    {
+        position->sector = (position->sector + 1) % sector_count;
+        position->record = 0;
+    }
+}
+
+static esp_err_t read_header(size_t sector, sector_header_t *header) { return esp_partition_read(partition, sector * METRICS_STORE_SECTOR_SIZE, header, sizeof(*header)); }
+
+static esp_err_t read_state(position_t position, uint32_t *state) { return esp_partition_read(partition, record_address(position), state, sizeof(*state)); }
+
+static esp_err_t write_state(position_t position, uint32_t state) { return esp_partition_write(partition, record_address(position), &state, sizeof(state)); }
+
+/**
+ * @brief Checks whether a record is fully erased and can be programmed.
+ *
+ * A record whose state reads ERASED may still hold part of a metric when
+ * power was lost while the metric was being programmed.
+ */
+static esp_err_t record_erased(position_t position, bool *erased)
+{
+    record_t record;
+    const esp_err_t ret = esp_partition_read(partition, record_address(position), &record, sizeof(record));
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)&record;
+    *erased = true;
+    for (size_t i = 0; i < sizeof(record); i++)
+    {
+        if (bytes[i] != 0xFF)
+        {
+            *erased = false;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Erases a sector and marks it as the newest sector of the ring.
+ */
+static esp_err_t start_sector(size_t sector, uint32_t sequence, int64_t wall_clock_offset_us)
+{
+    esp_err_t ret = esp_partition_erase_range(partition, sector * METRICS_STORE_SECTOR_SIZE, METRICS_STORE_SECTOR_SIZE);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to erase sector %zu: %s", sector, esp_err_to_name(ret));
+        return ret;
+    }
+
+    const sector_header_t header = {
+        .magic = METRICS_STORE_SECTOR_MAGIC,
+        .sequence = sequence,
+        .wall_clock_offset_us = wall_clock_offset_us,
+    };
+    ret = esp_partition_write(partition, sector * METRICS_STORE_SECTOR_SIZE, &header, sizeof(header));
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to write header of sector %zu: %s", sector, esp_err_to_name(ret));
+        return ret;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Drops the unconsumed records of the tail sector so it can be reused.
+ */
+static void drop_tail_sector(void)
+{
+    size_t dropped = 0;
+    for (position_t position = tail; position.record < METRICS_STORE_RECORDS_PER_SECTOR && stored_count > 0; position.record++)
+    {
+        uint32_t state;
+        if (read_state(position, &state) == ESP_OK && state == METRICS_STORE_RECORD_STATE_WRITTEN)
+        {
+            dropped++;
+            stored_count--;
+        }
+    }
+
+    tail.sector = (tail.sector + 1) % sector_count;
+    tail.record = 0;
+    ESP_LOGW(TAG, "Store full, dropped %zu oldest metrics.", dropped);
+}
+
+/**
+ * @brief Moves the write position to a fresh sector with the given wall clock offset.
+ *
+ * An empty head sector is restarted in place instead of being skipped.
+ */
+static esp_err_t open_head_sector(int64_t wall_clock_offset_us)
+{
+    esp_err_t ret;
+
+    if (head.record == 0)
+    {
+        ret = start_sector(head.sector, head_sequence, wall_clock_offset_us);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+        head_wall_clock_offset_us = wall_clock_offset_us;
+        return ESP_OK;
+    }
+
+    const size_t next_sector = (head.sector + 1) % sector_count;
+    if (stored_count > 0 && tail.sector == next_sector)
+    {
+        drop_tail_sector();
+    }
+
+    ret = start_sector(next_sector, head_sequence + 1, wall_clock_offset_us);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    head.sector = next_sector;
+    head.record = 0;
+    head_sequence++;
+    head_wall_clock_offset_us = wall_clock_offset_us;
+    return ESP_OK;
+}
+
+esp_err_t metrics_store_init(void)
+{
+    esp_err_t ret;
+
+    ESP_LOGI(TAG, "Finding partition...");
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, METRICS_STORE_PARTITION_LABEL);
+    if (partition == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to find partition \"%s\".", METRICS_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sector_count = partition->size / METRICS_STORE_SECTOR_SIZE;
+    if (sector_count < 2)
+    {
+        ESP_LOGE(TAG, "Partition \"%s\" must hold at least 2 sectors.", METRICS_STORE_PARTITION_LABEL);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ESP_LOGI(TAG, "Finding newest sector...");
+    bool head_found = false;
+    for (size_t sector = 0; sector < sector_count; sector++)
+    {
+        sector_header_t header;
+        ret = read_header(sector, &header);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read header of sector %zu: %s", sector, esp_err_to_name(ret));
+            return ret;
+        }
+
+        if (header.magic != METRICS_STORE_SECTOR_MAGIC)
+        {
+            continue;
+        }
+
+        if (!head_found || (int32_t)(header.sequence - head_sequence) > 0)
+        {
+            head.sector = sector;
+            head_sequence = header.sequence;
+            head_found = true;
+        }
+    }
+
+    stored_count = 0;
+    if (!head_found)
+    {
+        ESP_LOGI(TAG, "No stored metrics found, formatting store...");
+        head.sector = 0;
+        head.record = 0;
+        head_sequence = 0;
+        head_wall_clock_offset_us = 0;
+        tail = head;
+        return start_sector(head.sector, head_sequence, head_wall_clock_offset_us);
+    }
+
+    sector_header_t head_header;
+    ret = read_header(head.sector, &head_header);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read header of sector %zu: %s", head.sector, esp_err_to_name(ret));
+        return ret;
+    }
+    head_wall_clock_offset_us = head_header.wall_clock_offset_us;
+
+    for (head.record = 0; head.record < METRICS_STORE_RECORDS_PER_SECTOR; head.record++)
+    {
+        uint32_t state;
+        ret = read_state(head, &state);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read record state: %s", esp_err_to_name(ret));
+            return ret;
+        }
+
+        if (state != METRICS_STORE_RECORD_STATE_ERASED)
+        {
+            continue;
+        }
+
+        bool erased;
+        ret = record_erased(head, &erased);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read record: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        if (erased)
+        {
+            break;
+        }
+
+        ESP_LOGW(TAG, "Discarding record torn by a power loss.");
+        ret = write_state(head, METRICS_STORE_RECORD_STATE_CONSUMED);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to mark torn record as consumed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    ESP_LOGI(TAG, "Counting stored metrics...");
+    tail = head;
+    bool tail_found = false;
+    for (size_t age = sector_count - 1;; age--)
+    {
+        const size_t sector = (head.sector + sector_count - age) % sector_count;
+
+        sector_header_t header;
+        ret = read_header(sector, &header);
+        if (ret == ESP_OK && header.magic == METRICS_STORE_SECTOR_MAGIC && header.sequence == head_sequence - age)
+        {
+            const size_t record_count = age == 0 ? head.record : METRICS_STORE_RECORDS_PER_SECTOR;
+            for (size_t record = 0; record < record_count; record++)
+            {
+                const position_t position = {
+                    .sector = sector,
+                    .record = record,
+                };
+
+                uint32_t state;
+                if (read_state(position, &state) != ESP_OK || state != METRICS_STORE_RECORD_STATE_WRITTEN)
+                {
+                    continue;
+                }
+
+                if (!tail_found)
+                {
+                    tail = position;
+                    tail_found = true;
+                }
+                stored_count++;
+            }
+        }
+
+        if (age == 0)
+        {
+            break;
+        }
+    }
+
+    ESP_LOGI(TAG, "Recovered %zu stored metrics, capacity %zu.", stored_count, metrics_store_capacity());
+    return ESP_OK;
+}
+
+esp_err_t metrics_store_write(const metric_t *metrics, size_t metric_count, int64_t wall_clock_offset_us)
+{
+    esp_err_t ret;
+
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        if (head.record >= METRICS_STORE_RECORDS_PER_SECTOR || head_wall_clock_offset_us != wall_clock_offset_us)
+        {
+            ret = open_head_sector(wall_clock_offset_us);
+            if (ret != ESP_OK)
+            {
+                return ret;
+            }
+        }
+
+        if (stored_count == 0)
+        {
+            tail = head;
+        }
+
+        /* Once programming started the record is used up, even if it never becomes WRITTEN. */
+        const position_t position = head;
+        head.record++;
+
+        ret = esp_partition_write(partition, record_address(position) + offsetof(record_t, metric), &metrics[i], sizeof(metrics[i]));
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to write record: %s", esp_err_to_name(ret));
+            return ret;
+        }
+
+        ret = write_state(position, METRICS_STORE_RECORD_STATE_WRITTEN);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to mark record as written: %s", esp_err_to_name(ret));
+            return ret;
+        }
+
+        stored_count++;
+    }
+
+    return ESP_OK;
+}
+
+size_t metrics_store_read(metric_t *metrics, size_t max_metric_count, int64_t *wall_clock_offset_us)
+{
+    size_t read_count = 0;
+    size_t remaining = stored_count;
+    size_t header_sector = sector_count;
+    int64_t sector_wall_clock_offset_us = 0;
+    position_t position = tail;
+    for (size_t visited = 0; visited < METRICS_STORE_RECORD_CAPACITY && read_count < max_metric_count && remaining > 0; visited++, advance(&position))
+    {
+        if (position.sector != header_sector)
+        {
+            sector_header_t header;
+            const esp_err_t ret = read_header(position.sector, &header);
+            if (ret != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to read header of sector %zu: %s", position.sector, esp_err_to_name(ret));
+                break;
+            }
+            header_sector = position.sector;
+            sector_wall_clock_offset_us = header.wall_clock_offset_us;
+        }
+
+        record_t record;
+        const esp_err_t ret = esp_partition_read(partition, record_address(position), &record, sizeof(record));
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read record: %s", esp_err_to_name(ret));
+            break;
+        }
+
+        if (record.state != METRICS_STORE_RECORD_STATE_WRITTEN)
+        {
+            continue;
+        }
+
+        if (read_count == 0)
+        {
+            *wall_clock_offset_us = sector_wall_clock_offset_us;
+        }
+        else if (sector_wall_clock_offset_us != *wall_clock_offset_us)
+        {
+            break;
+        }
+
+        metrics[read_count++] = record.metric;
+        remaining--;
+    }
+
+    return read_count;
+}
+
+esp_err_t metrics_store_consume(size_t metric_count)
+{
+    esp_err_t ret;
+
+    for (size_t visited = 0; visited < METRICS_STORE_RECORD_CAPACITY && metric_count > 0 && stored_count > 0; visited++)
+    {
+        uint32_t state;
+        ret = read_state(tail, &state);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read record state: %s", esp_err_to_name(ret));
+            return ret;
+        }
+
+        if (state == METRICS_STORE_RECORD_STATE_WRITTEN)
+        {
+            ret = write_state(tail, METRICS_STORE_RECORD_STATE_CONSUMED);
+            if (ret != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to mark record as consumed: %s", esp_err_to_name(ret));
+                return ret;
+            }
+            metric_count--;
+            stored_count--;
+        }
+
+        advance(&tail);
+    }
+
+    /* Going around the whole ring without finding the written records means the count drifted from the flash contents. */
+    if (metric_count > 0 && stored_count > 0)
+    {
+        ESP_LOGW(TAG, "No written record left for %zu stored metrics, resetting count.", stored_count);
+        stored_count = 0;
+    }
+
+    if (stored_count == 0)
+    {
+        tail = head;
+    }
+
+    return ESP_OK;
+}
+
+size_t metrics_store_count(void) { return stored_count; }
+
+size_t metrics_store_capacity(void) { return (sector_count - 1) * METRICS_STORE_RECORDS_PER_SECTOR; }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+/**
+ * @brief Initializes the metrics store.
+ *
+ * Locates the "metrics" flash partition and recovers the read and write
+ * positions of the ring buffer from the records left by a previous boot.
+ *
+ * The store is not thread safe and must only be used from a single task.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t metrics_store_init(void);
+
+/**
+ * @brief Appends metrics to the end of the store.
+ *
+ * When the store is full the oldest sector is erased to make room, and the
+ * records it held are lost.
+ *
+ * Every sector records the wall clock offset its metrics were taken with, so
+ * metrics from an earlier boot keep their wall clock time. A change of offset
+ * starts a new sector.
+ *
+ * @param metrics Metrics to store.
+ * @param metric_count Number of metrics to store.
+ * @param wall_clock_offset_us Wall clock offset of the metrics, see time_sync_wall_clock_offset_us().
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t metrics_store_write(const metric_t *metrics, size_t metric_count, int64_t wall_clock_offset_us);
+
+/**
+ * @brief Reads the oldest stored metrics without removing them.
+ *
+ * Only metrics sharing the wall clock offset of the oldest metric are read,
+ * so one read never mixes metrics from different boots.
+ *
+ * @param metrics Buffer the metrics are read into.
+ * @param max_metric_count Capacity of the buffer.
+ * @param wall_clock_offset_us Set to the wall clock offset of the metrics read.
+ *
+ * @return Number of metrics read, 0 if the store is empty or on failure.
+ */
+size_t metrics_store_read(metric_t *metrics, size_t max_metric_count, int64_t *wall_clock_offset_us);
+
+/**
+ * @brief Removes the oldest stored metrics.
+ *
+ * Must be called after a successful metrics_store_read() once the metrics
+ * it returned have been delivered.
+ *
+ * @param metric_count Number of metrics to remove.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t metrics_store_consume(size_t metric_count);
+
+/**
+ * @brief Returns the number of metrics waiting in the store.
+ */
+size_t metrics_store_count(void);
+
+/**
+ * @brief Returns the number of metrics the store holds without dropping any.
+ *
+ * One sector is kept out of the count because the oldest sector is erased as
+ * soon as the write position needs it, whether or not it was fully used. A
+ * change of wall clock offset also starts a new sector, so every change
+ * lowers the capacity by up to one sector.
+ */
+size_t metrics_store_capacity(void);
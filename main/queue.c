@@ -1,123 +1,9 @@
 #include "queue.h"
 
 #include <esp_log.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
-
-#include "app_config.h"
 
 static const char *TAG = "queue";
 
-QueueHandle_t queue_handle_task_orchastrator;
-QueueHandle_t queue_handle_card_reader;
-QueueHandle_t queue_handle_buzzer;
-QueueHandle_t queue_handle_accelerometer;
-QueueHandle_t queue_handle_time_of_flight;
-QueueHandle_t queue_handle_metrics;
-
-esp_err_t queue_init(void)
-{
-    ESP_LOGI(TAG, "Creating task orchastrator queue...");
-    queue_handle_task_orchastrator = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(message_t));
-    if (queue_handle_task_orchastrator == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create task_orchastrator queue.");
-        goto cleanup_time_of_flight;
-    }
-
-    ESP_LOGI(TAG, "Creating card reader queue...");
-    queue_handle_card_reader = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(message_t));
-    if (queue_handle_card_reader == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create card_reader queue.");
-        goto cleanup_accelerometer;
-    }
-
-    ESP_LOGI(TAG, "Creating buzzer queue...");
-    queue_handle_buzzer = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(message_t));
-    if (queue_handle_buzzer == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create buzzer queue.");
-        goto cleanup_buzzer;
-    }
-
-    ESP_LOGI(TAG, "Creating accelerometer queue...");
-    queue_handle_accelerometer = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(message_t));
-    if (queue_handle_accelerometer == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create accelerometer queue.");
-        goto cleanup_card_reader;
-    }
-
-    ESP_LOGI(TAG, "Creating time of flight queue...");
-    queue_handle_time_of_flight = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(message_t));
-    if (queue_handle_time_of_flight == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create time of flight queue.");
-        goto cleanup_task_orchastrator;
-    }
-
-    ESP_LOGI(TAG, "Creating metric queue...");
-    queue_handle_metrics = xQueueCreate(APP_CONFIG_QUEUE_SIZE_ITEMS, sizeof(metric_t));
-    if (queue_handle_metrics == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create metric queue.");
-        goto cleanup_none;
-    }
-
-    return ESP_OK;
-
-cleanup_time_of_flight:
-    ESP_LOGI(TAG, "Deleting time of flight queue...");
-    vQueueDelete(queue_handle_time_of_flight);
-    queue_handle_time_of_flight = NULL;
-cleanup_accelerometer:
-    ESP_LOGI(TAG, "Deleting accelerometer queue...");
-    vQueueDelete(queue_handle_accelerometer);
-    queue_handle_accelerometer = NULL;
-cleanup_buzzer:
-    ESP_LOGI(TAG, "Deleting buzzer queue...");
-    vQueueDelete(queue_handle_buzzer);
-    queue_handle_buzzer = NULL;
-cleanup_card_reader:
-    ESP_LOGI(TAG, "Deleting card reader queue...");
-    vQueueDelete(queue_handle_card_reader);
-    queue_handle_card_reader = NULL;
-cleanup_task_orchastrator:
-    ESP_LOGI(TAG, "Deleting task orchastrator queue...");
-    vQueueDelete(queue_handle_task_orchastrator);
-    queue_handle_task_orchastrator = NULL;
-cleanup_none:
-    return ESP_FAIL;
-}
-
-void queue_deinit(void)
-{
-    ESP_LOGI(TAG, "Deleting metrics queue...");
-    vQueueDelete(queue_handle_metrics);
-    queue_handle_metrics = NULL;
-
-    ESP_LOGI(TAG, "Deleting time of flight queue...");
-    vQueueDelete(queue_handle_time_of_flight);
-    queue_handle_time_of_flight = NULL;
-
-    ESP_LOGI(TAG, "Deleting accelerometer queue...");
-    vQueueDelete(queue_handle_accelerometer);
-    queue_handle_accelerometer = NULL;
-
-    ESP_LOGI(TAG, "Deleting buzzer queue...");
-    vQueueDelete(queue_handle_buzzer);
-    queue_handle_buzzer = NULL;
-
-    ESP_LOGI(TAG, "Deleting card reader queue...");
-    vQueueDelete(queue_handle_card_reader);
-    queue_handle_card_reader = NULL;
-
-    ESP_LOGI(TAG, "Deleting task orchastrator queue...");
-    vQueueDelete(queue_handle_task_orchastrator);
-    queue_handle_task_orchastrator = NULL;
-}
-
 const char *queue_message_type_to_name(message_type_t type)
 {
     switch (type)
@@ -192,6 +78,16 @@ const char *queue_metric_type_to_name(metric_type_t metric_type)
         return "METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE";
     case METRIC_TYPE_CARD_READER_VALID:
         return "METRIC_TYPE_CARD_READER_VALID";
+    case METRIC_TYPE_ALARM_TRIGGERED:
+        return "METRIC_TYPE_ALARM_TRIGGERED";
+    case METRIC_TYPE_ACCELEROMETER_SAMPLE:
+        return "METRIC_TYPE_ACCELEROMETER_SAMPLE";
+    case METRIC_TYPE_QUEUE_STATS:
+        return "METRIC_TYPE_QUEUE_STATS";
+    case METRIC_TYPE_SAMPLING_STATS:
+        return "METRIC_TYPE_SAMPLING_STATS";
+    case METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE:
+        return "METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE";
     default:
         ESP_LOGE(TAG, "Received invalid metric type, enum code %d.", metric_type);
         return "INVALID_METRIC_TYPE";
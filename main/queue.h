@@ -1,26 +1,20 @@
 #pragma once
 
 #include <esp_err.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <time.h>
 
 /**
- * @brief Global queue handles used for inter-task communication.
+ * @brief Messages and metrics exchanged between tasks over the event bus.
  *
- * These queues are created in queue_init() and are used by the
- * different modules to exchange messages and metrics.
+ * Metrics are split in two priority lanes. Bulk telemetry goes to
+ * EVENT_BUS_TOPIC_METRICS, or for high rate sensors to a spsc_ring_t drained
+ * by the metrics publisher, and is published best effort, while security
+ * relevant events such as card reads and alarms go to
+ * EVENT_BUS_TOPIC_METRICS_CRITICAL, which the metrics publisher always
+ * drains first.
  */
 
-extern QueueHandle_t queue_handle_task_orchastrator;
-extern QueueHandle_t queue_handle_card_reader;
-extern QueueHandle_t queue_handle_buzzer;
-extern QueueHandle_t queue_handle_accelerometer;
-extern QueueHandle_t queue_handle_time_of_flight;
-extern QueueHandle_t queue_handle_metrics;
-
 /**
  * @brief Enumeration of all supported message types exchanged between tasks.
  *
@@ -39,6 +33,7 @@ typedef enum
     MESSAGE_TYPE_BUZZER_CARD_INVALID,
     MESSAGE_TYPE_CARD_READER_CARD_VALID,
     MESSAGE_TYPE_CARD_READER_CARD_INVALID,
+    MESSAGE_TYPE_COUNT,
 } message_type_t;
 
 /**
@@ -55,18 +50,22 @@ typedef enum
     COMPONENT_CARD_READER,
     COMPONENT_ACCELEROMETER,
     COMPONENT_TIME_OF_FLIGHT,
+    COMPONENT_COUNT,
 } component_t;
 
 /**
  * @brief Generic message structure exchanged between tasks.
  *
- * Contains the originating component and the message type.
+ * Contains the originating component, the message type and the time the
+ * message was created, in microseconds since boot as returned by
+ * esp_timer_get_time().
  */
 
 typedef struct
 {
     component_t component;
     message_type_t type;
+    int64_t timestamp_us;
 } message_t;
 
 /**
@@ -84,37 +83,128 @@ typedef enum
     METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL,
     METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE,
     METRIC_TYPE_CARD_READER_VALID,
+    METRIC_TYPE_ALARM_TRIGGERED,
+    METRIC_TYPE_ACCELEROMETER_SAMPLE,
+    METRIC_TYPE_QUEUE_STATS,
+    METRIC_TYPE_SAMPLING_STATS,
+    METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE,
 } metric_type_t;
 
+/**
+ * @brief Kinds of values a metric can carry.
+ *
+ * Producers send samples. The metrics publisher may replace the samples of
+ * one metric type by a summary over a time window.
+ */
+typedef enum
+{
+    METRIC_KIND_SAMPLE,
+    METRIC_KIND_SUMMARY,
+} metric_kind_t;
+
+/**
+ * @brief Statistics of the samples of one metric type over a time window.
+ */
+typedef struct
+{
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float stddev;
+} metric_summary_t;
+
+/**
+ * @brief One full reading of the accelerometer, sent as a single metric.
+ */
+typedef struct
+{
+    float acceleration_x;
+    float acceleration_y;
+    float acceleration_z;
+    float acceleration_total;
+    float rotation_x;
+    float rotation_y;
+    float rotation_z;
+    float rotation_total;
+} metric_accelerometer_sample_t;
+
+/**
+ * @brief Health of one inter-task queue, see queue_stats_snapshot_all().
+ *
+ * Counts are cumulative since the queue was created. Latencies are upper
+ * bounds of the log2 histogram bucket holding the percentile.
+ */
+typedef struct
+{
+    char name[12];
+    uint16_t capacity;
+    uint16_t high_water;
+    uint32_t enqueued;
+    uint32_t dropped;
+    uint32_t latency_p50_us;
+    uint32_t latency_p99_us;
+} metric_queue_stats_t;
+
+/**
+ * @brief Timing of one sensor loop, see sampling_scheduler_snapshot_all().
+ *
+ * Counts are cumulative since the loop was registered. The p99 jitter is
+ * the upper bound of the log2 histogram bucket holding it.
+ */
+typedef struct
+{
+    char name[12];
+    uint32_t period_us;
+    uint32_t released;
+    uint32_t overruns;
+    uint32_t jitter_p99_us;
+    uint32_t jitter_max_us;
+} metric_sampling_stats_t;
+
+/**
+ * @brief Distance measured in one zone of a scanning time of flight sensor.
+ */
+typedef struct
+{
+    uint8_t zone;
+    uint16_t distance_mm;
+} metric_zone_distance_t;
+
 /**
  * @brief Structure that represents one metric value.
  *
- * The value can be a float, bool or uint16_t.
+ * Samples carry a float, bool or uint16_t depending on the metric type, or a
+ * metric_accelerometer_sample_t for METRIC_TYPE_ACCELEROMETER_SAMPLE, a
+ * metric_queue_stats_t for METRIC_TYPE_QUEUE_STATS, a
+ * metric_sampling_stats_t for METRIC_TYPE_SAMPLING_STATS, or a
+ * metric_zone_distance_t for METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE.
+ * Summaries carry a metric_summary_t and their timestamp is the start of
+ * the summarized window.
+ *
+ * Timestamps are monotonic microseconds since boot as returned by
+ * esp_timer_get_time(). The metrics publisher pairs every batch with the
+ * wall clock offset of the boot the metrics were taken in, see
+ * time_sync_wall_clock_offset_us().
  */
 typedef struct
 {
     metric_type_t metric_type;
-    time_t timestamp;
+    metric_kind_t kind;
+    int64_t timestamp_us;
     union
     {
         float float_value;
         bool bool_value;
         uint16_t uint16_value;
+        metric_accelerometer_sample_t accelerometer_sample;
+        metric_queue_stats_t queue_stats;
+        metric_sampling_stats_t sampling_stats;
+        metric_zone_distance_t zone_distance;
+        metric_summary_t summary;
     };
 } metric_t;
 
-/**
- * @brief Creates all queues used in the application.
- *
- * @return ESP_OK on success, otherwise ESP_FAIL.
- */
-esp_err_t queue_init(void);
-
-/**
- * @brief Deletes all queues and frees resources.
- */
-void queue_deinit(void);
-
 /**
  * @brief Returns a readable name for a message type.
  */
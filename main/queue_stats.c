@@ -0,0 +1,70 @@
+#include "queue_stats.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <string.h>
+
+#include "stats_registry.h"
+
+static const char *TAG = "queue stats";
+
+#define QUEUE_STATS_MAX_QUEUES 16
+
+static void *registered_stats[QUEUE_STATS_MAX_QUEUES];
+static stats_registry_t registry = STATS_REGISTRY_INITIALIZER(registered_stats);
+
+esp_err_t queue_stats_register(queue_stats_t *stats, const char *name, uint32_t capacity)
+{
+    strncpy(stats->name, name, QUEUE_STATS_NAME_LENGTH);
+    stats->name[QUEUE_STATS_NAME_LENGTH] = '\0';
+    stats->capacity = capacity;
+    atomic_init(&stats->enqueued, 0);
+    atomic_init(&stats->dropped, 0);
+    atomic_init(&stats->high_water, 0);
+    log2_histogram_init(stats->latency_histogram);
+
+    const esp_err_t ret = stats_registry_add(&registry, stats);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot register queue \"%s\", %d queues already registered.", stats->name, QUEUE_STATS_MAX_QUEUES);
+    }
+    return ret;
+}
+
+void queue_stats_unregister(queue_stats_t *stats) { stats_registry_remove(&registry, stats); }
+
+void queue_stats_record_enqueue(queue_stats_t *stats, uint32_t depth)
+{
+    atomic_fetch_add_explicit(&stats->enqueued, 1, memory_order_relaxed);
+
+    uint_least32_t high_water = atomic_load_explicit(&stats->high_water, memory_order_relaxed);
+    while (depth > high_water && !atomic_compare_exchange_weak_explicit(&stats->high_water, &high_water, depth, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+void queue_stats_record_drop(queue_stats_t *stats) { atomic_fetch_add_explicit(&stats->dropped, 1, memory_order_relaxed); }
+
+void queue_stats_record_latency(queue_stats_t *stats, int64_t latency_us) { log2_histogram_record(stats->latency_histogram, latency_us); }
+
+size_t queue_stats_snapshot_all(queue_stats_snapshot_t *snapshots, size_t max_snapshot_count)
+{
+    void *entries[QUEUE_STATS_MAX_QUEUES];
+    const size_t stats_count = stats_registry_copy(&registry, entries, max_snapshot_count < QUEUE_STATS_MAX_QUEUES ? max_snapshot_count : QUEUE_STATS_MAX_QUEUES);
+
+    for (size_t i = 0; i < stats_count; i++)
+    {
+        queue_stats_t *stats = entries[i];
+        queue_stats_snapshot_t *snapshot = &snapshots[i];
+        memcpy(snapshot->name, stats->name, sizeof(snapshot->name));
+        snapshot->capacity = stats->capacity;
+        snapshot->enqueued = atomic_load_explicit(&stats->enqueued, memory_order_relaxed);
+        snapshot->dropped = atomic_load_explicit(&stats->dropped, memory_order_relaxed);
+        snapshot->high_water = atomic_load_explicit(&stats->high_water, memory_order_relaxed);
+        log2_histogram_load(stats->latency_histogram, snapshot->latency_histogram);
+    }
+
+    return stats_count;
+}
+
+uint32_t queue_stats_latency_percentile_us(const queue_stats_snapshot_t *snapshot, uint32_t percentile) { return log2_histogram_percentile(snapshot->latency_histogram, percentile); }
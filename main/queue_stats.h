@@ -0,0 +1,110 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log2_histogram.h"
+
+/**
+ * @brief Number of buckets of the latency histograms, see log2_histogram.h.
+ */
+#define QUEUE_STATS_LATENCY_BUCKET_COUNT LOG2_HISTOGRAM_BUCKET_COUNT
+
+/**
+ * @brief Longest queue name kept by the statistics, without the NUL terminator.
+ */
+#define QUEUE_STATS_NAME_LENGTH 11
+
+/**
+ * @brief Live counters of one inter-task queue.
+ *
+ * Counters are updated with relaxed atomics, so producers and the consumer
+ * can record into them from different tasks without locking. All counters
+ * are cumulative since the queue was created.
+ */
+typedef struct
+{
+    char name[QUEUE_STATS_NAME_LENGTH + 1];
+    uint32_t capacity;
+    atomic_uint_least32_t enqueued;
+    atomic_uint_least32_t dropped;
+    atomic_uint_least32_t high_water;
+    atomic_uint_least32_t latency_histogram[QUEUE_STATS_LATENCY_BUCKET_COUNT];
+} queue_stats_t;
+
+/**
+ * @brief Copy of the counters of one queue taken at one point in time.
+ */
+typedef struct
+{
+    char name[QUEUE_STATS_NAME_LENGTH + 1];
+    uint32_t capacity;
+    uint32_t enqueued;
+    uint32_t dropped;
+    uint32_t high_water;
+    uint32_t latency_histogram[QUEUE_STATS_LATENCY_BUCKET_COUNT];
+} queue_stats_snapshot_t;
+
+/**
+ * @brief Resets the counters of a queue and makes them visible to queue_stats_snapshot_all().
+ *
+ * @param stats Counters to register.
+ * @param name Name of the queue, truncated to QUEUE_STATS_NAME_LENGTH characters.
+ * @param capacity Number of items the queue holds.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if too many queues are registered.
+ */
+esp_err_t queue_stats_register(queue_stats_t *stats, const char *name, uint32_t capacity);
+
+/**
+ * @brief Removes the counters of a queue from queue_stats_snapshot_all().
+ *
+ * @param stats Counters to unregister.
+ */
+void queue_stats_unregister(queue_stats_t *stats);
+
+/**
+ * @brief Records an item entering a queue.
+ *
+ * @param stats Counters of the queue.
+ * @param depth Number of items in the queue after the item was added.
+ */
+void queue_stats_record_enqueue(queue_stats_t *stats, uint32_t depth);
+
+/**
+ * @brief Records an item lost because a queue was full.
+ *
+ * @param stats Counters of the queue.
+ */
+void queue_stats_record_drop(queue_stats_t *stats);
+
+/**
+ * @brief Records the time an item spent in a queue.
+ *
+ * @param stats Counters of the queue.
+ * @param latency_us Time from enqueue to dequeue in microseconds.
+ */
+void queue_stats_record_latency(queue_stats_t *stats, int64_t latency_us);
+
+/**
+ * @brief Copies the counters of every registered queue.
+ *
+ * @param snapshots Buffer the snapshots are written into.
+ * @param max_snapshot_count Capacity of the buffer.
+ *
+ * @return Number of snapshots written.
+ */
+size_t queue_stats_snapshot_all(queue_stats_snapshot_t *snapshots, size_t max_snapshot_count);
+
+/**
+ * @brief Estimates a latency percentile from the histogram of a snapshot.
+ *
+ * @param snapshot Snapshot to evaluate.
+ * @param percentile Percentile between 0 and 100.
+ *
+ * @return Upper bound of the histogram bucket holding the percentile in
+ * microseconds, 0 if no latency was recorded.
+ */
+uint32_t queue_stats_latency_percentile_us(const queue_stats_snapshot_t *snapshot, uint32_t percentile);
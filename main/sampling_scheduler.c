@@ -0,0 +1,139 @@
+#include "sampling_scheduler.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+
+#include "stats_registry.h"
+
+static const char *TAG = "sampling scheduler";
+
+#define SAMPLING_SCHEDULER_MAX_SCHEDULERS 8
+
+static void *registered_schedulers[SAMPLING_SCHEDULER_MAX_SCHEDULERS];
+static stats_registry_t registry = STATS_REGISTRY_INITIALIZER(registered_schedulers);
+
+esp_err_t sampling_scheduler_register(sampling_scheduler_t *scheduler, const char *name, uint32_t period_ms)
+{
+    strncpy(scheduler->name, name, SAMPLING_SCHEDULER_NAME_LENGTH);
+    scheduler->name[SAMPLING_SCHEDULER_NAME_LENGTH] = '\0';
+
+    esp_err_t ret = sampling_scheduler_set_period(scheduler, period_ms);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    atomic_init(&scheduler->released, 0);
+    atomic_init(&scheduler->overruns, 0);
+    atomic_init(&scheduler->jitter_max_us, 0);
+    log2_histogram_init(scheduler->jitter_histogram);
+    sampling_scheduler_start(scheduler);
+
+    ret = stats_registry_add(&registry, scheduler);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot register scheduler \"%s\", %d schedulers already registered.", scheduler->name, SAMPLING_SCHEDULER_MAX_SCHEDULERS);
+    }
+    return ret;
+}
+
+void sampling_scheduler_unregister(sampling_scheduler_t *scheduler) { stats_registry_remove(&registry, scheduler); }
+
+esp_err_t sampling_scheduler_set_period(sampling_scheduler_t *scheduler, uint32_t period_ms)
+{
+    const TickType_t period_ticks = pdMS_TO_TICKS(period_ms);
+    if (period_ticks == 0)
+    {
+        ESP_LOGE(TAG, "Period of \"%s\" is %lu ms, shorter than one tick.", scheduler->name, (unsigned long)period_ms);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    scheduler->period_ticks = period_ticks;
+    // The loop is released on tick boundaries, so the period it actually gets is a whole number of ticks.
+    scheduler->period_us = period_ticks * portTICK_PERIOD_MS * 1000;
+    sampling_scheduler_start(scheduler);
+    return ESP_OK;
+}
+
+void sampling_scheduler_start(sampling_scheduler_t *scheduler)
+{
+    scheduler->last_wake = xTaskGetTickCount();
+    scheduler->last_release_us = 0;
+}
+
+/**
+ * @brief Records the jitter of a release against the previous one.
+ */
+static void record_release(sampling_scheduler_t *scheduler, int64_t release_us)
+{
+    const int64_t previous_release_us = scheduler->last_release_us;
+    scheduler->last_release_us = release_us;
+    atomic_fetch_add_explicit(&scheduler->released, 1, memory_order_relaxed);
+    if (previous_release_us == 0)
+    {
+        return;
+    }
+
+    int64_t jitter_us = release_us - previous_release_us - scheduler->period_us;
+    if (jitter_us < 0)
+    {
+        jitter_us = -jitter_us;
+    }
+    const uint32_t jitter = jitter_us > UINT32_MAX ? UINT32_MAX : (uint32_t)jitter_us;
+    log2_histogram_record(scheduler->jitter_histogram, jitter);
+
+    // Only the loop itself records, so a plain load and store cannot lose a maximum.
+    if (jitter > atomic_load_explicit(&scheduler->jitter_max_us, memory_order_relaxed))
+    {
+        atomic_store_explicit(&scheduler->jitter_max_us, jitter, memory_order_relaxed);
+    }
+}
+
+bool sampling_scheduler_wait(sampling_scheduler_t *scheduler)
+{
+    const bool met = xTaskDelayUntil(&scheduler->last_wake, scheduler->period_ticks) == pdTRUE;
+    if (!met)
+    {
+        atomic_fetch_add_explicit(&scheduler->overruns, 1, memory_order_relaxed);
+        scheduler->last_wake = xTaskGetTickCount();
+    }
+
+    record_release(scheduler, esp_timer_get_time());
+    return met;
+}
+
+void sampling_scheduler_record_release(sampling_scheduler_t *scheduler, int64_t release_us)
+{
+    if (scheduler->last_release_us != 0 && release_us - scheduler->last_release_us > scheduler->period_us + scheduler->period_us / 2)
+    {
+        atomic_fetch_add_explicit(&scheduler->overruns, 1, memory_order_relaxed);
+    }
+
+    record_release(scheduler, release_us);
+}
+
+size_t sampling_scheduler_snapshot_all(sampling_scheduler_snapshot_t *snapshots, size_t max_snapshot_count)
+{
+    void *entries[SAMPLING_SCHEDULER_MAX_SCHEDULERS];
+    const size_t scheduler_count = stats_registry_copy(&registry, entries, max_snapshot_count < SAMPLING_SCHEDULER_MAX_SCHEDULERS ? max_snapshot_count : SAMPLING_SCHEDULER_MAX_SCHEDULERS);
+
+    for (size_t i = 0; i < scheduler_count; i++)
+    {
+        sampling_scheduler_t *scheduler = entries[i];
+        sampling_scheduler_snapshot_t *snapshot = &snapshots[i];
+        memcpy(snapshot->name, scheduler->name, sizeof(snapshot->name));
+        snapshot->period_us = scheduler->period_us;
+        snapshot->released = atomic_load_explicit(&scheduler->released, memory_order_relaxed);
+        snapshot->overruns = atomic_load_explicit(&scheduler->overruns, memory_order_relaxed);
+        snapshot->jitter_max_us = atomic_load_explicit(&scheduler->jitter_max_us, memory_order_relaxed);
+        log2_histogram_load(scheduler->jitter_histogram, snapshot->jitter_histogram);
+    }
+
+    return scheduler_count;
+}
+
+uint32_t sampling_scheduler_jitter_percentile_us(const sampling_scheduler_snapshot_t *snapshot, uint32_t percentile) { return log2_histogram_percentile(snapshot->jitter_histogram, percentile); }
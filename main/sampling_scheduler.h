@@ -0,0 +1,145 @@
+#pragma once
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log2_histogram.h"
+
+/**
+ * @brief Number of buckets of the jitter histograms, see log2_histogram.h.
+ */
+#define SAMPLING_SCHEDULER_JITTER_BUCKET_COUNT LOG2_HISTOGRAM_BUCKET_COUNT
+
+/**
+ * @brief Longest sensor name kept by the scheduler, without the NUL terminator.
+ */
+#define SAMPLING_SCHEDULER_NAME_LENGTH 11
+
+/**
+ * @brief Fixed rate release of one sensor loop, with timing statistics.
+ *
+ * Loops that time themselves call sampling_scheduler_wait(), which sleeps
+ * until the next deadline on the FreeRTOS tick instead of a fixed delay
+ * after the work, so the period does not drift with the time the work takes.
+ * Loops clocked by the sensor itself call sampling_scheduler_record_release()
+ * to get the same statistics.
+ *
+ * Jitter is the deviation of the time between two releases from the
+ * period. Statistics are updated with relaxed atomics and are cumulative
+ * since registration, so another task can read them without locking.
+ */
+typedef struct
+{
+    char name[SAMPLING_SCHEDULER_NAME_LENGTH + 1];
+    uint32_t period_us;
+    TickType_t period_ticks;
+    TickType_t last_wake;
+    int64_t last_release_us;
+    atomic_uint_least32_t released;
+    atomic_uint_least32_t overruns;
+    atomic_uint_least32_t jitter_max_us;
+    atomic_uint_least32_t jitter_histogram[SAMPLING_SCHEDULER_JITTER_BUCKET_COUNT];
+} sampling_scheduler_t;
+
+/**
+ * @brief Copy of the statistics of one scheduler taken at one point in time.
+ */
+typedef struct
+{
+    char name[SAMPLING_SCHEDULER_NAME_LENGTH + 1];
+    uint32_t period_us;
+    uint32_t released;
+    uint32_t overruns;
+    uint32_t jitter_max_us;
+    uint32_t jitter_histogram[SAMPLING_SCHEDULER_JITTER_BUCKET_COUNT];
+} sampling_scheduler_snapshot_t;
+
+/**
+ * @brief Sets up a scheduler and makes its statistics visible to sampling_scheduler_snapshot_all().
+ *
+ * @param scheduler Scheduler to register.
+ * @param name Name of the sensor loop, truncated to SAMPLING_SCHEDULER_NAME_LENGTH characters.
+ * @param period_ms Sampling period, rounded down to whole FreeRTOS ticks.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the period is shorter
+ * than one tick, ESP_ERR_NO_MEM if too many schedulers are registered.
+ */
+esp_err_t sampling_scheduler_register(sampling_scheduler_t *scheduler, const char *name, uint32_t period_ms);
+
+/**
+ * @brief Removes the statistics of a scheduler from sampling_scheduler_snapshot_all().
+ *
+ * @param scheduler Scheduler to unregister.
+ */
+void sampling_scheduler_unregister(sampling_scheduler_t *scheduler);
+
+/**
+ * @brief Changes the sampling period of a registered scheduler and starts its deadlines from now.
+ *
+ * Statistics are kept. Jitter is measured against the new period from the
+ * next release on.
+ *
+ * @param scheduler Scheduler to change.
+ * @param period_ms New sampling period, rounded down to whole FreeRTOS ticks.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the period is shorter
+ * than one tick, in which case the old period is kept.
+ */
+esp_err_t sampling_scheduler_set_period(sampling_scheduler_t *scheduler, uint32_t period_ms);
+
+/**
+ * @brief Starts the deadlines from now, after the loop was created or paused.
+ *
+ * The gap since the last release is not counted as jitter.
+ *
+ * @param scheduler Scheduler to start.
+ */
+void sampling_scheduler_start(sampling_scheduler_t *scheduler);
+
+/**
+ * @brief Sleeps until the next deadline and records the release.
+ *
+ * A missed deadline counts as an overrun, and the deadlines restart from
+ * now instead of releasing the loop repeatedly to catch up.
+ *
+ * @param scheduler Scheduler of the calling loop.
+ *
+ * @return false if the deadline was already missed.
+ */
+bool sampling_scheduler_wait(sampling_scheduler_t *scheduler);
+
+/**
+ * @brief Records a release of a loop that is clocked by the sensor.
+ *
+ * A release later than one and a half periods after the previous one counts
+ * as an overrun.
+ *
+ * @param scheduler Scheduler of the calling loop.
+ * @param release_us Time of the release in microseconds since boot.
+ */
+void sampling_scheduler_record_release(sampling_scheduler_t *scheduler, int64_t release_us);
+
+/**
+ * @brief Copies the statistics of every registered scheduler.
+ *
+ * @param snapshots Buffer the snapshots are written into.
+ * @param max_snapshot_count Capacity of the buffer.
+ *
+ * @return Number of snapshots written.
+ */
+size_t sampling_scheduler_snapshot_all(sampling_scheduler_snapshot_t *snapshots, size_t max_snapshot_count);
+
+/**
+ * @brief Estimates a jitter percentile from the histogram of a snapshot.
+ *
+ * @param snapshot Snapshot to evaluate.
+ * @param percentile Percentile between 0 and 100.
+ *
+ * @return Upper bound of the histogram bucket holding the percentile in
+ * microseconds, 0 if no jitter was recorded.
+ */
+uint32_t sampling_scheduler_jitter_percentile_us(const sampling_scheduler_snapshot_t *snapshot, uint32_t percentile);
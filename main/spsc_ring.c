@@ -0,0 +1,91 @@
+#include "spsc_ring.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+
+static const char *TAG = "spsc ring";
+
+esp_err_t spsc_ring_init(spsc_ring_t *ring, metric_t *buffer, size_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        ESP_LOGE(TAG, "Capacity %zu is not a power of two.", capacity);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->items = buffer;
+    ring->mask = capacity - 1;
+    return ESP_OK;
+}
+
+size_t spsc_ring_reserve(spsc_ring_t *ring, metric_t **slots, size_t count)
+{
+    // Indices run freely and are only masked on access, so head - tail is always the fill level.
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    const size_t capacity = ring->mask + 1;
+
+    const size_t free_count = capacity - (head - tail);
+    const size_t contiguous_count = capacity - (head & ring->mask);
+    size_t reserved = count;
+    if (reserved > free_count)
+    {
+        reserved = free_count;
+    }
+    if (reserved > contiguous_count)
+    {
+        reserved = contiguous_count;
+    }
+
+    if (reserved == 0 && count > 0)
+    {
+        queue_stats_record_drop(&ring->stats);
+    }
+
+    *slots = &ring->items[head & ring->mask];
+    return reserved;
+}
+
+void spsc_ring_commit(spsc_ring_t *ring, size_t count)
+{
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+
+    const size_t depth = head + count - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (size_t i = 0; i < count; i++)
+    {
+        queue_stats_record_enqueue(&ring->stats, depth);
+    }
+}
+
+size_t spsc_ring_peek(spsc_ring_t *ring, const metric_t **items, size_t max_count)
+{
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const size_t capacity = ring->mask + 1;
+
+    const size_t used_count = head - tail;
+    const size_t contiguous_count = capacity - (tail & ring->mask);
+    size_t available = max_count;
+    if (available > used_count)
+    {
+        available = used_count;
+    }
+    if (available > contiguous_count)
+    {
+        available = contiguous_count;
+    }
+
+    *items = &ring->items[tail & ring->mask];
+    return available;
+}
+
+void spsc_ring_release(spsc_ring_t *ring, size_t count)
+{
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+}
+
+size_t spsc_ring_count(spsc_ring_t *ring) { return atomic_load_explicit(&ring->head, memory_order_acquire) - atomic_load_explicit(&ring->tail, memory_order_acquire); }
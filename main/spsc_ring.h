@@ -0,0 +1,99 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "queue.h"
+#include "queue_stats.h"
+
+/**
+ * @brief Size the producer and consumer indices are padded to, so they never
+ * share a cache line.
+ */
+#define SPSC_RING_CACHE_LINE_SIZE 32
+
+/**
+ * @brief Lock free ring buffer of metrics with a single producer and a single consumer.
+ *
+ * The producer reserves slots, fills them in place and commits them. The
+ * consumer peeks at committed slots, reads them in place and releases them.
+ * Neither side takes a lock or copies a metric through an intermediate
+ * buffer. The producer only writes head and the consumer only writes tail,
+ * and acquire/release ordering on those indices publishes the slot contents.
+ *
+ * Each ring must be used by exactly one producer task and one consumer task.
+ *
+ * The ring counts committed metrics, its fill level and reserves that found it
+ * full in stats. Latencies are recorded by the consumer, which knows when a
+ * metric was taken.
+ */
+typedef struct
+{
+    _Alignas(SPSC_RING_CACHE_LINE_SIZE) atomic_size_t head;
+    _Alignas(SPSC_RING_CACHE_LINE_SIZE) atomic_size_t tail;
+    _Alignas(SPSC_RING_CACHE_LINE_SIZE) metric_t *items;
+    size_t mask;
+    queue_stats_t stats;
+} spsc_ring_t;
+
+/**
+ * @brief Binds a ring to a caller owned buffer.
+ *
+ * @param ring Ring to initialize.
+ * @param buffer Storage for the metrics.
+ * @param capacity Number of metrics the buffer holds, must be a power of two.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the capacity is not a power of two.
+ */
+esp_err_t spsc_ring_init(spsc_ring_t *ring, metric_t *buffer, size_t capacity);
+
+/**
+ * @brief Reserves free slots for the producer to fill.
+ *
+ * Only contiguous slots are returned, so fewer than requested may be
+ * reserved when the free space wraps around the end of the buffer.
+ *
+ * @param ring Ring to reserve in.
+ * @param slots Set to the first reserved slot.
+ * @param count Number of slots wanted.
+ *
+ * @return Number of slots reserved, 0 if the ring is full. A full ring is
+ * counted as a dropped metric.
+ */
+size_t spsc_ring_reserve(spsc_ring_t *ring, metric_t **slots, size_t count);
+
+/**
+ * @brief Makes filled slots visible to the consumer.
+ *
+ * @param ring Ring to commit to.
+ * @param count Number of reserved slots that were filled.
+ */
+void spsc_ring_commit(spsc_ring_t *ring, size_t count);
+
+/**
+ * @brief Returns committed metrics for the consumer to read in place.
+ *
+ * Only contiguous metrics are returned, call again after releasing them to
+ * get the ones that wrapped around the end of the buffer.
+ *
+ * @param ring Ring to read from.
+ * @param items Set to the oldest committed metric.
+ * @param max_count Maximum number of metrics wanted.
+ *
+ * @return Number of metrics available at items, 0 if the ring is empty.
+ */
+size_t spsc_ring_peek(spsc_ring_t *ring, const metric_t **items, size_t max_count);
+
+/**
+ * @brief Frees metrics the consumer has finished reading.
+ *
+ * @param ring Ring to release from.
+ * @param count Number of peeked metrics to free.
+ */
+void spsc_ring_release(spsc_ring_t *ring, size_t count);
+
+/**
+ * @brief Returns the number of committed metrics waiting for the consumer.
+ */
+size_t spsc_ring_count(spsc_ring_t *ring);
@@ -0,0 +1,42 @@
+#include "stats_registry.h"
+
+#include <string.h>
+
+esp_err_t stats_registry_add(stats_registry_t *registry, void *entry)
+{
+    esp_err_t ret = ESP_OK;
+    taskENTER_CRITICAL(&registry->lock);
+    if (registry->count < registry->capacity)
+    {
+        registry->entries[registry->count++] = entry;
+    }
+    else
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+    taskEXIT_CRITICAL(&registry->lock);
+    return ret;
+}
+
+void stats_registry_remove(stats_registry_t *registry, const void *entry)
+{
+    taskENTER_CRITICAL(&registry->lock);
+    for (size_t i = 0; i < registry->count; i++)
+    {
+        if (registry->entries[i] == entry)
+        {
+            registry->entries[i] = registry->entries[--registry->count];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&registry->lock);
+}
+
+size_t stats_registry_copy(stats_registry_t *registry, void **entries, size_t max_entry_count)
+{
+    taskENTER_CRITICAL(&registry->lock);
+    const size_t entry_count = registry->count < max_entry_count ? registry->count : max_entry_count;
+    memcpy(entries, registry->entries, entry_count * sizeof(entries[0]));
+    taskEXIT_CRITICAL(&registry->lock);
+    return entry_count;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+
+/**
+ * @brief Fixed size list of live statistics that another task can snapshot.
+ *
+ * Entries are plain pointers owned by the caller. Adding, removing and
+ * copying the list are guarded by a critical section, reading the
+ * statistics behind the pointers is up to the caller.
+ */
+typedef struct
+{
+    void **entries;
+    size_t capacity;
+    size_t count;
+    portMUX_TYPE lock;
+} stats_registry_t;
+
+/**
+ * @brief Static initializer of a registry on an array of entry pointers.
+ */
+#define STATS_REGISTRY_INITIALIZER(storage)                 \
+    {                                                       \
+        .entries = (storage),                               \
+        .capacity = sizeof(storage) / sizeof((storage)[0]), \
+        .count = 0,                                         \
+        .lock = portMUX_INITIALIZER_UNLOCKED,               \
+    }
+
+/**
+ * @brief Adds an entry to a registry.
+ *
+ * @param registry Registry to add to.
+ * @param entry Entry to add.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the registry is full.
+ */
+esp_err_t stats_registry_add(stats_registry_t *registry, void *entry);
+
+/**
+ * @brief Removes an entry from a registry, does nothing if it is not registered.
+ *
+ * The order of the remaining entries is not kept.
+ *
+ * @param registry Registry to remove from.
+ * @param entry Entry to remove.
+ */
+void stats_registry_remove(stats_registry_t *registry, const void *entry);
+
+/**
+ * @brief Copies the entries of a registry.
+ *
+ * @param registry Registry to copy.
+ * @param entries Buffer the entries are written into.
+ * @param max_entry_count Capacity of the buffer.
+ *
+ * @return Number of entries written.
+ */
+size_t stats_registry_copy(stats_registry_t *registry, void **entries, size_t max_entry_count);
@@ -2,14 +2,16 @@
 
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
 #include "accelerometer.h"
-#include "app_config.h"
+#include "app_resources.h"
 #include "app_wifi.h"
 #include "buzzer.h"
 #include "card_reader.h"
+#include "event_bus.h"
 #include "metrics_publisher.h"
 #include "queue.h"
 #include "time_of_flight.h"
@@ -19,102 +21,124 @@ static const char *TAG = "task orchastrator";
 
 TaskHandle_t task_handle;
 
+static event_bus_subscription_t *security_events_subscription;
+
 static bool system_armed = true;
 static bool system_trigerred = false;
 
+/**
+ * @brief Publishes an alarm state change on the critical metrics lane.
+ *
+ * @param triggered Whether the alarm has been triggered or stopped.
+ */
+static void publish_alarm_metric(bool triggered)
+{
+    const metric_t metric_alarm_triggered = {
+        .metric_type = METRIC_TYPE_ALARM_TRIGGERED,
+        .timestamp_us = esp_timer_get_time(),
+        .bool_value = triggered,
+    };
+    const esp_err_t ret = event_bus_publish(EVENT_BUS_TOPIC_METRICS_CRITICAL, &metric_alarm_triggered);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to publish alarm metric: %s", esp_err_to_name(ret));
+    }
+}
+
 static void task_orchastrator_handler(void *)
 {
     for (;;)
     {
         message_t incoming_message;
-        BaseType_t ret = xQueueReceive(queue_handle_task_orchastrator, &incoming_message, portMAX_DELAY);
+        event_bus_receive(security_events_subscription, &incoming_message, portMAX_DELAY);
         ESP_LOGD(TAG, "Received message type \"%s\" from component \"%s\"", queue_message_type_to_name(incoming_message.type), queue_component_to_name(incoming_message.component));
 
+        esp_err_t ret;
         message_t outgoing_message = {
             .component = COMPONENT_TASK_ORCHASTRATOR,
+            .timestamp_us = esp_timer_get_time(),
         };
         switch (incoming_message.type)
         {
         case MESSAGE_TYPE_SENSOR_TRIGGERED:
             ESP_LOGD(TAG, "Starting alarm...");
             outgoing_message.type = MESSAGE_TYPE_BUZZER_ALARM_START;
-            ret = xQueueSendToBack(queue_handle_buzzer, &outgoing_message, portMAX_DELAY);
-            if (ret != pdTRUE)
+            ret = event_bus_publish(EVENT_BUS_TOPIC_BUZZER, &outgoing_message);
+            if (ret != ESP_OK)
             {
-                ESP_LOGE(TAG, "Failed to send message \"%s\" to buzzer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                ESP_LOGE(TAG, "Failed to publish message \"%s\" to buzzer: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
+            }
+            if (!system_trigerred)
+            {
+                publish_alarm_metric(true);
+                ESP_LOGI(TAG, "Alarm raised %lld us after %s triggered.", esp_timer_get_time() - incoming_message.timestamp_us, queue_component_to_name(incoming_message.component));
             }
             system_trigerred = true;
             break;
 
         case MESSAGE_TYPE_CARD_READER_CARD_VALID:
             outgoing_message.type = MESSAGE_TYPE_BUZZER_CARD_VALID;
-            ret = xQueueSendToBack(queue_handle_buzzer, &outgoing_message, portMAX_DELAY);
-            if (ret != pdTRUE)
+            ret = event_bus_publish(EVENT_BUS_TOPIC_BUZZER, &outgoing_message);
+            if (ret != ESP_OK)
             {
-                ESP_LOGE(TAG, "Failed to send message \"%s\" to buzzer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                ESP_LOGE(TAG, "Failed to publish message \"%s\" to buzzer: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
             }
 
             if (system_trigerred)
             {
                 // stop alarm
                 outgoing_message.type = MESSAGE_TYPE_BUZZER_ALARM_STOP;
-                ret = xQueueSendToBack(queue_handle_buzzer, &outgoing_message, portMAX_DELAY);
-                if (ret != pdTRUE)
+                ret = event_bus_publish(EVENT_BUS_TOPIC_BUZZER, &outgoing_message);
+                if (ret != ESP_OK)
                 {
-                    ESP_LOGE(TAG, "Failed to send message \"%s\" to buzzer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                    ESP_LOGE(TAG, "Failed to publish message \"%s\" to buzzer: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
                 }
 
                 // disable sensors
                 outgoing_message.type = MESSAGE_TYPE_DISABLE;
-                ret = xQueueSendToBack(queue_handle_accelerometer, &outgoing_message, portMAX_DELAY);
-                if (ret != pdTRUE)
-                {
-                    ESP_LOGE(TAG, "Failed to send message \"%s\" to accelerometer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
-                }
-                ret = xQueueSendToBack(queue_handle_time_of_flight, &outgoing_message, portMAX_DELAY);
-                if (ret != pdTRUE)
+                ret = event_bus_publish(EVENT_BUS_TOPIC_SENSOR_CONTROL, &outgoing_message);
+                if (ret != ESP_OK)
                 {
-                    ESP_LOGE(TAG, "Failed to send message \"%s\" to time of flight sensor queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                    ESP_LOGE(TAG, "Failed to publish message \"%s\" to sensors: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
                 }
 
                 system_armed = false;
                 system_trigerred = false;
+                publish_alarm_metric(false);
             }
             else
             {
                 // toggle system arm state
                 system_armed = !system_armed;
                 outgoing_message.type = system_armed ? MESSAGE_TYPE_ENABLE : MESSAGE_TYPE_DISABLE;
-                ret = xQueueSendToBack(queue_handle_accelerometer, &outgoing_message, portMAX_DELAY);
-                if (ret != pdTRUE)
+                ret = event_bus_publish(EVENT_BUS_TOPIC_SENSOR_CONTROL, &outgoing_message);
+                if (ret != ESP_OK)
                 {
-                    ESP_LOGE(TAG, "Failed to send message \"%s\" to accelerometer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
-                }
-                ret = xQueueSendToBack(queue_handle_time_of_flight, &outgoing_message, portMAX_DELAY);
-                if (ret != pdTRUE)
-                {
-                    ESP_LOGE(TAG, "Failed to send message \"%s\" to time of flight sensor queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                    ESP_LOGE(TAG, "Failed to publish message \"%s\" to sensors: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
                 }
             }
             break;
 
         case MESSAGE_TYPE_CARD_READER_CARD_INVALID:
             outgoing_message.type = MESSAGE_TYPE_BUZZER_CARD_INVALID;
-            ret = xQueueSendToBack(queue_handle_buzzer, &outgoing_message, portMAX_DELAY);
-            if (ret != pdTRUE)
+            ret = event_bus_publish(EVENT_BUS_TOPIC_BUZZER, &outgoing_message);
+            if (ret != ESP_OK)
             {
-                ESP_LOGE(TAG, "Failed to send message \"%s\" to card buzzer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                ESP_LOGE(TAG, "Failed to publish message \"%s\" to buzzer: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
             }
 
             if (system_armed && !system_trigerred)
             {
                 // start alarm
                 outgoing_message.type = MESSAGE_TYPE_BUZZER_ALARM_START;
-                ret = xQueueSendToBack(queue_handle_buzzer, &outgoing_message, portMAX_DELAY);
-                if (ret != pdTRUE)
+                ret = event_bus_publish(EVENT_BUS_TOPIC_BUZZER, &outgoing_message);
+                if (ret != ESP_OK)
                 {
-                    ESP_LOGE(TAG, "Failed to send message \"%s\" to buzzer queue with error code %d", queue_message_type_to_name(outgoing_message.type), ret);
+                    ESP_LOGE(TAG, "Failed to publish message \"%s\" to buzzer: %s", queue_message_type_to_name(outgoing_message.type), esp_err_to_name(ret));
                 }
+                publish_alarm_metric(true);
+                ESP_LOGI(TAG, "Alarm raised by an invalid card.");
+                system_trigerred = true;
             }
             break;
 
@@ -128,15 +152,31 @@ static void task_orchastrator_handler(void *)
 esp_err_t task_orchastrator_init(void)
 {
     esp_err_t esp_ret;
-    BaseType_t rtos_ret;
     esp_err_t cleanup_ret;
 
+    // Subscribe and start the metrics publisher first, so events and metrics are not lost while the sensors start up.
+    ESP_LOGD(TAG, "Subscribing to security events...");
+    esp_ret = event_bus_subscribe(EVENT_BUS_TOPIC_SECURITY_EVENTS, APP_RESOURCES_QUEUE_SECURITY_EVENTS, EVENT_BUS_POLICY_COALESCE, &security_events_subscription);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to subscribe to security events: %s", esp_err_to_name(esp_ret));
+        goto cleanup_nothing;
+    }
+
+    ESP_LOGD(TAG, "Initializing metrics publisher...");
+    esp_ret = metrics_publisher_init();
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to initialize metrics publisher: %s", esp_err_to_name(esp_ret));
+        goto cleanup_security_events_subscription;
+    }
+
     ESP_LOGD(TAG, "Initializing accelerometer...");
     esp_ret = accelerometer_init();
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to initialize accelerometer: %s", esp_err_to_name(esp_ret));
-        goto cleanup_nothing;
+        goto cleanup_metrics_publisher;
     }
 
     ESP_LOGD(TAG, "Initializing buzzer...");
@@ -163,32 +203,17 @@ esp_err_t task_orchastrator_init(void)
         goto cleanup_card_reader;
     }
 
-    esp_ret = metrics_publisher_init();
-    if (esp_ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to initialize metrics publisher: %s", esp_err_to_name(esp_ret));
-        goto cleanup_time_of_flight;
-    }
-
     ESP_LOGD(TAG, "creating task orchastrator freertos task...");
-    rtos_ret = xTaskCreate(task_orchastrator_handler, "Task Orchastrator", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &task_handle);
-    if (rtos_ret != pdPASS)
+    task_handle = app_resources_create_task(APP_RESOURCES_TASK_TASK_ORCHASTRATOR, task_orchastrator_handler);
+    if (task_handle == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create task with error code: %d", rtos_ret);
+        ESP_LOGE(TAG, "Failed to create task.");
         esp_ret = ESP_FAIL;
-        goto cleanup_metrics_publisher;
+        goto cleanup_time_of_flight;
     }
 
     return ESP_OK;
 
-cleanup_metrics_publisher:
-    ESP_LOGI(TAG, "Deinitializing metrics publisher...");
-    cleanup_ret = metrics_publisher_deinit();
-    if (cleanup_ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to deinitialize metrics publisher: %s .aborting program.", esp_err_to_name(cleanup_ret));
-        abort();
-    }
 cleanup_time_of_flight:
     ESP_LOGI(TAG, "Deinitializing time of flight...");
     cleanup_ret = time_of_flight_deinit();
@@ -221,6 +246,18 @@ cleanup_accelerometer:
         ESP_LOGE(TAG, "Failed to deinitialize accelerometer: %s. Aborting program.", esp_err_to_name(cleanup_ret));
         abort();
     }
+cleanup_metrics_publisher:
+    ESP_LOGI(TAG, "Deinitializing metrics publisher...");
+    cleanup_ret = metrics_publisher_deinit();
+    if (cleanup_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to deinitialize metrics publisher: %s .aborting program.", esp_err_to_name(cleanup_ret));
+        abort();
+    }
+cleanup_security_events_subscription:
+    ESP_LOGI(TAG, "Unsubscribing from security events...");
+    event_bus_unsubscribe(security_events_subscription);
+    security_events_subscription = NULL;
 cleanup_nothing:
     return esp_ret;
 }
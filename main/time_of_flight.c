@@ -2,12 +2,24 @@
 
 #include <driver/gpio.h>
 #include <driver/i2c_master.h>
+#include <esp_attr.h>
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <vl53l1x.h>
 
-#include "app_config.h"
+#include "app_resources.h"
+#include "background_model.h"
+#include "deadband_filter.h"
+#include "event_bus.h"
+#include "gpio_interrupt.h"
+#include "metrics_publisher.h"
 #include "queue.h"
+#include "sampling_scheduler.h"
+#include "spsc_ring.h"
+#include "trigger_detector.h"
 
 static const char *TAG = "time of flight";
 
@@ -15,35 +27,473 @@ static const char *TAG = "time of flight";
 #define TIME_OF_FLIGHT_I2C_GPIO_SDA GPIO_NUM_21
 #define TIME_OF_FLIGHT_I2C_GPIO_SCL GPIO_NUM_22
 #define TIME_OF_FLIGHT_I2C_ADDR 0x29
-#define TIME_OF_FLIGHT_MACRO_TIMING 16
-#define TIME_OF_FLIGHT_INTERMEASUREMENT_MS 100
-#define TIME_OF_FLIGHT_DISTANCE_THREASHOLD_MM 200
+#define TIME_OF_FLIGHT_TRIGGER_RELEASE_RATIO 0.9f
+#define TIME_OF_FLIGHT_TRIGGER_DEBOUNCE_MS 100
+#define TIME_OF_FLIGHT_TRIGGER_HOLD_OFF_MS 2000
+#define TIME_OF_FLIGHT_METRICS_RING_SIZE 16
+/* A zone distance is only published once it moved this far from the last published one, or the noise of the background if larger. */
+#define TIME_OF_FLIGHT_METRIC_DEADBAND_MM 20
+#define TIME_OF_FLIGHT_METRIC_DEADBAND_STDDEVS 3.0f
+#define TIME_OF_FLIGHT_METRIC_HEARTBEAT_MS 10000
+#define TIME_OF_FLIGHT_I2C_SPEED_HZ 400000
+#define TIME_OF_FLIGHT_I2C_TIMEOUT_MS 50
+
+#define TIME_OF_FLIGHT_INTERRUPT_ENABLED true
+#define TIME_OF_FLIGHT_GPIO_INT GPIO_NUM_35 /* GPIO1 of the sensor, open drain and pulled up on the board. */
+#define TIME_OF_FLIGHT_INTERRUPT_TIMEOUT_PERIODS 2
+
+/* Fast ranging is kept for this long after the last deviating measurement. */
+#define TIME_OF_FLIGHT_FAST_HOLD_MS 5000
+/* Background deviation at which a measurement counts as activity, half of the trigger threshold. */
+#define TIME_OF_FLIGHT_ACTIVITY_DEVIATION 0.5f
+
+#define TIME_OF_FLIGHT_SCAN_ENABLED true
+
+/* Background model of every zone, in measurements of that zone. The alphas hold at the accurate profile and are scaled with the period of the others. */
+#define TIME_OF_FLIGHT_BACKGROUND_LEARNING_SAMPLES 20
+#define TIME_OF_FLIGHT_BACKGROUND_ALPHA 0.01f
+#define TIME_OF_FLIGHT_BACKGROUND_FOREGROUND_ALPHA 0.0005f
+#define TIME_OF_FLIGHT_BACKGROUND_REFERENCE_MS 100
+#define TIME_OF_FLIGHT_BACKGROUND_SENSITIVITY 4.0f /* Standard deviations a distance must deviate by to trigger. */
+#define TIME_OF_FLIGHT_MAX_ZONES 4
+
+/* VL53L1X registers used by the interrupt mode, 16 bit big endian addresses. */
+#define VL53L1X_REG_GPIO_HV_MUX_CTRL 0x0030
+#define VL53L1X_REG_SYSTEM_INTERRUPT_CLEAR 0x0086
+#define VL53L1X_REG_ROI_CENTRE_SPAD 0x007F
+#define VL53L1X_REG_ROI_XY_SIZE 0x0080
+#define VL53L1X_GPIO_HV_MUX_CTRL_ACTIVE_LOW 0x10
+
+/**
+ * @brief Region of interest of the sensor watched as one zone.
+ *
+ * The zone triggers once its distance deviates significantly from the
+ * background learned after arming, and by at least min_deviation_mm.
+ */
+typedef struct
+{
+    const char *name;
+    uint8_t centre_spad; /* SPAD at the centre of the region, see the ROI centre table of the VL53L1X user manual. */
+    uint8_t width;       /* In SPADs, from 4 to 16. */
+    uint8_t height;      /* In SPADs, from 4 to 16. */
+    uint16_t min_deviation_mm;
+} zone_config_t;
+
+typedef struct
+{
+    background_model_t background_model;
+    trigger_detector_t trigger_detector;
+    deadband_filter_t deadband_filter;
+} zone_state_t;
+
+/* Left and right halves of the field of view, for example a door and a window next to it. */
+static const zone_config_t scan_zones[] = {
+    {.name = "left", .centre_spad = 167, .width = 8, .height = 16, .min_deviation_mm = 50},
+    {.name = "right", .centre_spad = 231, .width = 8, .height = 16, .min_deviation_mm = 50},
+};
+
+/* The full field of view, used when scanning is disabled. */
+static const zone_config_t full_zone = {.name = "full", .centre_spad = 199, .width = 16, .height = 16, .min_deviation_mm = 50};
+
+typedef enum
+{
+    TIME_OF_FLIGHT_PROFILE_FAST,
+    TIME_OF_FLIGHT_PROFILE_ACCURATE,
+    TIME_OF_FLIGHT_PROFILE_LOW_POWER,
+    TIME_OF_FLIGHT_PROFILE_COUNT,
+} time_of_flight_profile_t;
+
+/**
+ * @brief Timing of the sensor in one ranging profile.
+ *
+ * The timing budget set by macro_timing must fit into the intermeasurement
+ * period, and a longer budget ranges further with less noise.
+ */
+typedef struct
+{
+    uint16_t macro_timing;
+    uint32_t intermeasurement_ms;
+} profile_config_t;
+
+/* Fast right after activity, accurate while armed and quiet, low power while disarmed. */
+static const profile_config_t profile_configs[TIME_OF_FLIGHT_PROFILE_COUNT] = {
+    [TIME_OF_FLIGHT_PROFILE_FAST] = {.macro_timing = 4, .intermeasurement_ms = 20},
+    [TIME_OF_FLIGHT_PROFILE_ACCURATE] = {.macro_timing = 16, .intermeasurement_ms = 100},
+    [TIME_OF_FLIGHT_PROFILE_LOW_POWER] = {.macro_timing = 16, .intermeasurement_ms = 1000},
+};
+
+_Static_assert(sizeof(scan_zones) / sizeof(scan_zones[0]) <= TIME_OF_FLIGHT_MAX_ZONES, "Too many scan zones");
 
 static TaskHandle_t task_handle;
 
+static event_bus_subscription_t *control_subscription;
+
+static metric_t metrics_ring_buffer[TIME_OF_FLIGHT_METRICS_RING_SIZE];
+static spsc_ring_t metrics_ring;
+
 i2c_master_bus_handle_t i2c_master_bus_handle;
 static vl53l1x_t device_descriptor;
 
+/* Second handle on the sensor for registers the driver has no API for. */
+static i2c_master_dev_handle_t register_handle;
+
+/* Written by the data ready interrupt, the time the latest measurement became ready. */
+static portMUX_TYPE data_ready_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t last_data_ready_us;
+
+static sampling_scheduler_t sampling_scheduler;
+/* Released once per full pass over the zones, reports the achieved scan rate. */
+static sampling_scheduler_t scan_scheduler;
+
+static const zone_config_t *zones;
+static size_t zone_count;
+static zone_state_t zone_states[TIME_OF_FLIGHT_MAX_ZONES];
+
+static time_of_flight_profile_t current_profile = TIME_OF_FLIGHT_PROFILE_ACCURATE;
+static int64_t profile_since_us;
+static uint32_t profile_measurements;
+
+static esp_err_t write_register(uint16_t reg, uint8_t value)
+{
+    const uint8_t data[] = {reg >> 8, reg & 0xFF, value};
+    return i2c_master_transmit(register_handle, data, sizeof(data), TIME_OF_FLIGHT_I2C_TIMEOUT_MS);
+}
+
+static esp_err_t read_register(uint16_t reg, uint8_t *value)
+{
+    const uint8_t address[] = {reg >> 8, reg & 0xFF};
+    return i2c_master_transmit_receive(register_handle, address, sizeof(address), value, 1, TIME_OF_FLIGHT_I2C_TIMEOUT_MS);
+}
+
+/**
+ * @brief Records when a measurement became ready and wakes the task to read it.
+ */
+static void IRAM_ATTR data_ready_isr_handler(void *)
+{
+    const int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL_ISR(&data_ready_lock);
+    last_data_ready_us = now_us;
+    taskEXIT_CRITICAL_ISR(&data_ready_lock);
+
+    if (task_handle != NULL)
+    {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task_handle, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+}
+
+/**
+ * @brief Makes GPIO1 of the sensor active low and attaches the data ready handler to it.
+ */
+static esp_err_t interrupt_init(void)
+{
+    uint8_t mux_ctrl;
+    esp_err_t ret = read_register(VL53L1X_REG_GPIO_HV_MUX_CTRL, &mux_ctrl);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    ret = write_register(VL53L1X_REG_GPIO_HV_MUX_CTRL, mux_ctrl | VL53L1X_GPIO_HV_MUX_CTRL_ACTIVE_LOW);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    ret = gpio_interrupt_attach(TIME_OF_FLIGHT_GPIO_INT, GPIO_INTR_NEGEDGE, data_ready_isr_handler, NULL);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    // A measurement that completed before the handler was attached would hold the line low for good.
+    ret = write_register(VL53L1X_REG_SYSTEM_INTERRUPT_CLEAR, 0x01);
+    if (ret != ESP_OK)
+    {
+        gpio_interrupt_detach(TIME_OF_FLIGHT_GPIO_INT);
+    }
+    return ret;
+}
+
+/**
+ * @brief Waits until the next measurement is ready.
+ *
+ * @return Time the measurement became ready.
+ */
+static int64_t wait_for_measurement(void)
+{
+    if (!TIME_OF_FLIGHT_INTERRUPT_ENABLED)
+    {
+        sampling_scheduler_wait(&sampling_scheduler);
+        return esp_timer_get_time();
+    }
+
+    // Without a notification the read below still polls the sensor, so a lost edge only delays one measurement.
+    const uint32_t timeout_ms = TIME_OF_FLIGHT_INTERRUPT_TIMEOUT_PERIODS * profile_configs[current_profile].intermeasurement_ms;
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) == 0)
+    {
+        ESP_LOGW(TAG, "No data ready interrupt for %lu ms.", (unsigned long)timeout_ms);
+        return esp_timer_get_time();
+    }
+
+    taskENTER_CRITICAL(&data_ready_lock);
+    const int64_t data_ready_us = last_data_ready_us;
+    taskEXIT_CRITICAL(&data_ready_lock);
+
+    sampling_scheduler_record_release(&sampling_scheduler, data_ready_us);
+    return data_ready_us;
+}
+
+/**
+ * @brief Points the region of interest of the sensor at a zone.
+ *
+ * The sensor picks the new region up at the start of its next measurement,
+ * so this has to be written in the gap between two measurements.
+ */
+static esp_err_t select_zone(const zone_config_t *zone)
+{
+    esp_err_t ret = write_register(VL53L1X_REG_ROI_CENTRE_SPAD, zone->centre_spad);
+    if (ret == ESP_OK)
+    {
+        ret = write_register(VL53L1X_REG_ROI_XY_SIZE, ((zone->height - 1) << 4) | (zone->width - 1));
+    }
+    return ret;
+}
+
+/**
+ * @brief Forgets the backgrounds and running episodes of every zone.
+ */
+static void reset_zones(void)
+{
+    for (size_t i = 0; i < zone_count; i++)
+    {
+        zone_state_t *state = &zone_states[i];
+        const float time_scale = (float)profile_configs[current_profile].intermeasurement_ms / TIME_OF_FLIGHT_BACKGROUND_REFERENCE_MS;
+        const background_model_config_t background_config = {
+            .learning_samples = TIME_OF_FLIGHT_BACKGROUND_LEARNING_SAMPLES,
+            .alpha = TIME_OF_FLIGHT_BACKGROUND_ALPHA * time_scale,
+            .foreground_alpha = TIME_OF_FLIGHT_BACKGROUND_FOREGROUND_ALPHA * time_scale,
+            .sensitivity = TIME_OF_FLIGHT_BACKGROUND_SENSITIVITY,
+            .min_deviation = zones[i].min_deviation_mm,
+        };
+        background_model_init(&state->background_model, &background_config);
+
+        // The background model scores deviations relative to the allowed deviation, so 1.0 is the threshold.
+        const trigger_detector_config_t trigger_config = {
+            .trigger_threshold = 1.0f,
+            .release_threshold = TIME_OF_FLIGHT_TRIGGER_RELEASE_RATIO,
+            .debounce_us = TIME_OF_FLIGHT_TRIGGER_DEBOUNCE_MS * 1000LL,
+            .hold_off_us = TIME_OF_FLIGHT_TRIGGER_HOLD_OFF_MS * 1000LL,
+        };
+        trigger_detector_init(&state->trigger_detector, &trigger_config);
+
+        const deadband_filter_config_t deadband_config = {
+            .min_deadband = TIME_OF_FLIGHT_METRIC_DEADBAND_MM,
+            .noise_stddevs = TIME_OF_FLIGHT_METRIC_DEADBAND_STDDEVS,
+            .heartbeat_us = TIME_OF_FLIGHT_METRIC_HEARTBEAT_MS * 1000LL,
+        };
+        deadband_filter_init(&state->deadband_filter, &deadband_config);
+    }
+    sampling_scheduler_start(&scan_scheduler);
+}
+
+/**
+ * @brief Runs trigger detection on the measurement of one zone and hands it to the metrics publisher.
+ *
+ * A single zone publishes every distance, which the metrics publisher
+ * aggregates, so the summaries are not biased towards the changes. The
+ * distances of several zones are published raw, and only once they leave
+ * the deadband around the last published one, once the zone was silent for
+ * TIME_OF_FLIGHT_METRIC_HEARTBEAT_MS, or when the measurement triggered. The
+ * deadband is at least as wide as the noise of the learned background, so a
+ * static scene stays silent, and narrower than its trigger deviation, so
+ * every movement is published.
+ *
+ * @param zone_index Zone the measurement was taken in.
+ * @param distance_mm Measured distance.
+ * @param timestamp_us Time the measurement became ready.
+ *
+ * @return Deviation of the measurement from the background of the zone, see background_model_update().
+ */
+static float process_measurement(size_t zone_index, uint16_t distance_mm, int64_t timestamp_us)
+{
+    const zone_config_t *zone = &zones[zone_index];
+    zone_state_t *state = &zone_states[zone_index];
+
+    const bool learning = !background_model_learned(&state->background_model);
+    const float deviation = background_model_update(&state->background_model, distance_mm);
+    if (learning && background_model_learned(&state->background_model))
+    {
+        ESP_LOGI(TAG, "Zone \"%s\" learned a background of %.0f mm, standard deviation %.1f mm.", zone->name, state->background_model.mean, background_model_stddev(&state->background_model));
+    }
+
+    const bool triggered = trigger_detector_update(&state->trigger_detector, deviation, timestamp_us);
+    if (triggered)
+    {
+        ESP_LOGI(TAG, "Zone \"%s\" triggered at %u mm against a background of %.0f mm, %lld us after the measurement was ready.", zone->name, distance_mm, state->background_model.mean, esp_timer_get_time() - timestamp_us);
+        const message_t tof_message = {
+            .component = COMPONENT_TIME_OF_FLIGHT,
+            .type = MESSAGE_TYPE_SENSOR_TRIGGERED,
+            .timestamp_us = timestamp_us,
+        };
+        event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &tof_message);
+    }
+
+    if (zone_count > 1 && !triggered && !deadband_filter_check(&state->deadband_filter, distance_mm, background_model_stddev(&state->background_model), timestamp_us))
+    {
+        return deviation;
+    }
+
+    metric_t *metric_tof_distance;
+    if (spsc_ring_reserve(&metrics_ring, &metric_tof_distance, 1) == 0)
+    {
+        ESP_LOGD(TAG, "Metrics ring is full, dropping distance.");
+        return deviation;
+    }
+
+    if (zone_count > 1)
+    {
+        *metric_tof_distance = (metric_t){
+            .metric_type = METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE,
+            .timestamp_us = timestamp_us,
+            .zone_distance = {
+                .zone = zone_index,
+                .distance_mm = distance_mm,
+            },
+        };
+    }
+    else
+    {
+        *metric_tof_distance = (metric_t){
+            .metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE,
+            .timestamp_us = timestamp_us,
+            .uint16_value = distance_mm,
+        };
+    }
+    spsc_ring_commit(&metrics_ring, 1);
+    deadband_filter_passed(&state->deadband_filter, distance_mm, timestamp_us);
+    return deviation;
+}
+
+static const char *profile_to_name(time_of_flight_profile_t profile)
+{
+    switch (profile)
+    {
+    case TIME_OF_FLIGHT_PROFILE_FAST:
+        return "TIME_OF_FLIGHT_PROFILE_FAST";
+    case TIME_OF_FLIGHT_PROFILE_ACCURATE:
+        return "TIME_OF_FLIGHT_PROFILE_ACCURATE";
+    case TIME_OF_FLIGHT_PROFILE_LOW_POWER:
+        return "TIME_OF_FLIGHT_PROFILE_LOW_POWER";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+/**
+ * @brief Writes the timing of a profile to the sensor.
+ *
+ * The timing can only change while the sensor is stopped. The sensor is
+ * started again even if the timing could not be written, so it keeps
+ * ranging with whatever timing it has.
+ */
+static esp_err_t apply_profile(time_of_flight_profile_t new_profile)
+{
+    const profile_config_t *config = &profile_configs[new_profile];
+
+    esp_err_t ret = vl53l1x_stop(&device_descriptor);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    ret = vl53l1x_set_macro_timing(&device_descriptor, config->macro_timing);
+    if (ret == ESP_OK)
+    {
+        ret = vl53l1x_set_intermeasurement_ms(&device_descriptor, config->intermeasurement_ms);
+    }
+
+    const esp_err_t start_ret = vl53l1x_start(&device_descriptor);
+    return ret != ESP_OK ? ret : start_ret;
+}
+
+/**
+ * @brief Switches the sensor and the loop to another ranging profile.
+ *
+ * The time spent and measurements taken in the previous profile are logged,
+ * so detection latency and I2C load can be compared per profile.
+ */
+static void switch_profile(time_of_flight_profile_t new_profile, int64_t now_us)
+{
+    const esp_err_t ret = apply_profile(new_profile);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to switch to %s: %s", profile_to_name(new_profile), esp_err_to_name(ret));
+        return;
+    }
+
+    ESP_LOGI(TAG, "Switched from %s to %s after %lld ms and %lu measurements.", profile_to_name(current_profile), profile_to_name(new_profile), (now_us - profile_since_us) / 1000, (unsigned long)profile_measurements);
+    current_profile = new_profile;
+    profile_since_us = now_us;
+    profile_measurements = 0;
+
+    const uint32_t period_ms = profile_configs[current_profile].intermeasurement_ms;
+    sampling_scheduler_set_period(&sampling_scheduler, period_ms);
+    sampling_scheduler_set_period(&scan_scheduler, zone_count * period_ms);
+
+    // Keep the time constants of the backgrounds, the learned scene stays valid.
+    const float time_scale = (float)period_ms / TIME_OF_FLIGHT_BACKGROUND_REFERENCE_MS;
+    for (size_t i = 0; i < zone_count; i++)
+    {
+        zone_states[i].background_model.config.alpha = TIME_OF_FLIGHT_BACKGROUND_ALPHA * time_scale;
+        zone_states[i].background_model.config.foreground_alpha = TIME_OF_FLIGHT_BACKGROUND_FOREGROUND_ALPHA * time_scale;
+    }
+
+    // A data ready notification from before the restart belongs to the old timing.
+    ulTaskNotifyTake(pdTRUE, 0);
+}
+
 /**
  * @brief Task handler for time of flight sensor.
- * Monitors distance and sends alerts if threshold exceeded.
+ * Monitors distance and sends one alert per episode beyond the threshold.
+ * With TIME_OF_FLIGHT_SCAN_ENABLED the region of interest moves to the next
+ * zone after every measurement, so each zone is measured once every
+ * zone_count intermeasurement periods.
+ * With TIME_OF_FLIGHT_INTERRUPT_ENABLED the task sleeps until GPIO1 of the
+ * sensor signals a finished measurement and reads it right away, so it
+ * runs exactly at the ranging period of the sensor. Otherwise the loop is
+ * released every intermeasurement period and the read waits for the
+ * measurement.
+ * The ranging profile follows the arm state: fast for
+ * TIME_OF_FLIGHT_FAST_HOLD_MS after a deviating measurement, accurate while
+ * armed and quiet, and low power while disarmed.
  *
  * @param pvParameters Unused.
  */
 static void time_of_flight_handler(void *)
 {
     bool enabled = true;
+    size_t zone_index = 0;
+    int64_t last_activity_us = 0;
+    profile_since_us = esp_timer_get_time();
+    sampling_scheduler_start(&sampling_scheduler);
+    reset_zones();
     for (;;)
     {
+        const int64_t timestamp_us = wait_for_measurement();
+
         message_t message;
-        BaseType_t esp_ret = xQueueReceive(queue_handle_time_of_flight, &message, 0);
-        if (esp_ret == pdTRUE)
+        if (event_bus_receive(control_subscription, &message, 0))
         {
             ESP_LOGD(TAG, "Received message type \"%s\" from component \"%s\"", queue_metric_type_to_name(message.type), queue_metric_type_to_name(message.component));
             switch (message.type)
             {
             case MESSAGE_TYPE_ENABLE:
                 enabled = true;
+                last_activity_us = 0;
+                // The scene may have changed while disarmed.
+                reset_zones();
                 ESP_LOGD(TAG, "Set enabled flag to true.");
                 break;
             case MESSAGE_TYPE_DISABLE:
@@ -55,49 +505,70 @@ static void time_of_flight_handler(void *)
                 break;
             }
         }
+        time_of_flight_profile_t wanted_profile = TIME_OF_FLIGHT_PROFILE_LOW_POWER;
         if (enabled)
         {
-            vl53l1x_result_t read = {0};
-            esp_err_t ret = vl53l1x_read(&device_descriptor, &read, 200);
-            if (ret == ESP_OK)
-            {
-                if (read.status != 0)
-                {
-                    ESP_LOGE(TAG, "Failed to read measurements with result status: %d", read.status);
-                    continue;
-                }
-
-                if (read.distance_mm > TIME_OF_FLIGHT_DISTANCE_THREASHOLD_MM)
-                {
-                    const message_t tof_message = {
-                        .component = COMPONENT_TIME_OF_FLIGHT,
-                        .type = MESSAGE_TYPE_SENSOR_TRIGGERED,
-                    };
-                    xQueueSendToBack(queue_handle_task_orchastrator, &tof_message, portMAX_DELAY);
-                }
-
-                const metric_t metric_tof_distance = {
-                    .metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE,
-                    .timestamp = time(NULL),
-                    .uint16_value = read.distance_mm,
-                };
-                xQueueSendToBack(queue_handle_metrics, &metric_tof_distance, 0);
-            }
-            else
+            const bool active = last_activity_us != 0 && timestamp_us - last_activity_us < TIME_OF_FLIGHT_FAST_HOLD_MS * 1000LL;
+            wanted_profile = active ? TIME_OF_FLIGHT_PROFILE_FAST : TIME_OF_FLIGHT_PROFILE_ACCURATE;
+        }
+        if (wanted_profile != current_profile)
+        {
+            switch_profile(wanted_profile, timestamp_us);
+            continue;
+        }
+
+        if (!enabled)
+        {
+            // Nobody reads while disarmed, so the interrupt is cleared to keep the sensor signalling.
+            write_register(VL53L1X_REG_SYSTEM_INTERRUPT_CLEAR, 0x01);
+            continue;
+        }
+
+        vl53l1x_result_t read = {0};
+        const esp_err_t ret = vl53l1x_read(&device_descriptor, &read, profile_configs[current_profile].intermeasurement_ms);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read measurement: %s", esp_err_to_name(ret));
+            continue;
+        }
+
+        // The next measurement may already run, so the region is switched before anything else.
+        const size_t measured_zone = zone_index;
+        if (zone_count > 1)
+        {
+            zone_index = (zone_index + 1) % zone_count;
+            const esp_err_t zone_ret = select_zone(&zones[zone_index]);
+            if (zone_ret != ESP_OK)
             {
-                ESP_LOGE(TAG, "Failed to read measurement: %s", esp_err_to_name(ret));
+                ESP_LOGE(TAG, "Failed to select zone \"%s\": %s", zones[zone_index].name, esp_err_to_name(zone_ret));
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
+        if (zone_index == 0)
+        {
+            sampling_scheduler_record_release(&scan_scheduler, timestamp_us);
+        }
+        profile_measurements++;
+
+        if (read.status != 0)
+        {
+            ESP_LOGE(TAG, "Failed to read measurements with result status: %d", read.status);
+            continue;
+        }
+
+        if (process_measurement(measured_zone, read.distance_mm, timestamp_us) >= TIME_OF_FLIGHT_ACTIVITY_DEVIATION)
+        {
+            last_activity_us = timestamp_us;
+        }
     }
 }
 
 esp_err_t time_of_flight_init(void)
 {
     esp_err_t esp_ret;
-    BaseType_t rtos_ret;
     esp_err_t cleanup_ret;
 
+    current_profile = TIME_OF_FLIGHT_PROFILE_ACCURATE;
+
     ESP_LOGD(TAG, "Creating new I2C master bus...");
     i2c_master_bus_config_t i2c_master_bus_config = {
         .i2c_port = TIME_OF_FLIGHT_I2C_PORT_NUM,
@@ -122,12 +593,25 @@ esp_err_t time_of_flight_init(void)
         goto cleanup_none;
     }
 
+    ESP_LOGD(TAG, "Adding register handle...");
+    const i2c_device_config_t register_handle_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = TIME_OF_FLIGHT_I2C_ADDR,
+        .scl_speed_hz = TIME_OF_FLIGHT_I2C_SPEED_HZ,
+    };
+    esp_ret = i2c_master_bus_add_device(i2c_master_bus_handle, &register_handle_config, &register_handle);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to add register handle: %s", esp_err_to_name(esp_ret));
+        goto cleanup_device_descriptor;
+    }
+
     ESP_LOGD(TAG, "Initializing sensor...");
     esp_ret = vl53l1x_sensor_init(&device_descriptor);
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to initialize sensor: %s", esp_err_to_name(esp_ret));
-        goto cleanup_device_descriptor;
+        goto cleanup_register_handle;
     }
 
     ESP_LOGD(TAG, "Configuring sensor for long range...");
@@ -135,7 +619,7 @@ esp_err_t time_of_flight_init(void)
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to configure sensor for long range: %s", esp_err_to_name(esp_ret));
-        goto cleanup_device_descriptor;
+        goto cleanup_register_handle;
     }
 
     ESP_LOGD(TAG, "Starting sensor...");
@@ -143,11 +627,11 @@ esp_err_t time_of_flight_init(void)
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to start sensor: %s", esp_err_to_name(esp_ret));
-        goto cleanup_device_descriptor;
+        goto cleanup_register_handle;
     }
 
     ESP_LOGD(TAG, "Setting macro timing...");
-    esp_ret = vl53l1x_set_macro_timing(&device_descriptor, TIME_OF_FLIGHT_MACRO_TIMING);
+    esp_ret = vl53l1x_set_macro_timing(&device_descriptor, profile_configs[current_profile].macro_timing);
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to set macro timing: %s", esp_err_to_name(esp_ret));
@@ -155,32 +639,104 @@ esp_err_t time_of_flight_init(void)
     }
 
     ESP_LOGD(TAG, "setting intermeasurement period...");
-    esp_ret = vl53l1x_set_intermeasurement_ms(&device_descriptor, TIME_OF_FLIGHT_INTERMEASUREMENT_MS);
+    esp_ret = vl53l1x_set_intermeasurement_ms(&device_descriptor, profile_configs[current_profile].intermeasurement_ms);
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to set intermeasurement period: %s", esp_err_to_name(esp_ret));
         goto cleanup_start;
     }
 
+    zones = TIME_OF_FLIGHT_SCAN_ENABLED ? scan_zones : &full_zone;
+    zone_count = TIME_OF_FLIGHT_SCAN_ENABLED ? sizeof(scan_zones) / sizeof(scan_zones[0]) : 1;
+
+    ESP_LOGD(TAG, "Selecting first zone...");
+    esp_ret = select_zone(&zones[0]);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to select first zone: %s", esp_err_to_name(esp_ret));
+        goto cleanup_start;
+    }
+
+    if (TIME_OF_FLIGHT_INTERRUPT_ENABLED)
+    {
+        ESP_LOGD(TAG, "Setting up data ready interrupt...");
+        esp_ret = interrupt_init();
+        if (esp_ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to set up data ready interrupt: %s", esp_err_to_name(esp_ret));
+            goto cleanup_start;
+        }
+    }
+
     ESP_LOGD(TAG, "starting sensor");
     esp_ret = vl53l1x_start(&device_descriptor);
     if (esp_ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to start sensor: %s", esp_err_to_name(esp_ret));
-        goto cleanup_start;
+        goto cleanup_interrupt;
+    }
+
+    ESP_LOGD(TAG, "Subscribing to sensor control...");
+    esp_ret = event_bus_subscribe(EVENT_BUS_TOPIC_SENSOR_CONTROL, APP_RESOURCES_QUEUE_TIME_OF_FLIGHT_CONTROL, EVENT_BUS_POLICY_BLOCK, &control_subscription);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to subscribe to sensor control: %s", esp_err_to_name(esp_ret));
+        goto cleanup_interrupt;
+    }
+
+    ESP_LOGD(TAG, "Registering metrics ring...");
+    spsc_ring_init(&metrics_ring, metrics_ring_buffer, TIME_OF_FLIGHT_METRICS_RING_SIZE);
+    esp_ret = metrics_publisher_register_ring(&metrics_ring, "ring/tof");
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register metrics ring: %s", esp_err_to_name(esp_ret));
+        goto cleanup_control_subscription;
+    }
+
+    ESP_LOGD(TAG, "Registering sampling scheduler...");
+    esp_ret = sampling_scheduler_register(&sampling_scheduler, "tof", profile_configs[current_profile].intermeasurement_ms);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register sampling scheduler: %s", esp_err_to_name(esp_ret));
+        goto cleanup_metrics_ring;
+    }
+
+    esp_ret = sampling_scheduler_register(&scan_scheduler, "tof/scan", zone_count * profile_configs[current_profile].intermeasurement_ms);
+    if (esp_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register scan scheduler: %s", esp_err_to_name(esp_ret));
+        goto cleanup_sampling_scheduler;
     }
 
     ESP_LOGD(TAG, "creating freertos task...");
-    rtos_ret = xTaskCreate(time_of_flight_handler, "Time of Flight", APP_CONFIG_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, &task_handle);
-    if (rtos_ret != pdPASS)
+    task_handle = app_resources_create_task(APP_RESOURCES_TASK_TIME_OF_FLIGHT, time_of_flight_handler);
+    if (task_handle == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create task with error code: %d", rtos_ret);
-        esp_ret = ESP_OK;
-        goto cleanup_start;
+        ESP_LOGE(TAG, "Failed to create task.");
+        esp_ret = ESP_FAIL;
+        goto cleanup_scan_scheduler;
     }
 
     return ESP_OK;
 
+cleanup_scan_scheduler:
+    sampling_scheduler_unregister(&scan_scheduler);
+cleanup_sampling_scheduler:
+    ESP_LOGD(TAG, "Unregistering sampling scheduler...");
+    sampling_scheduler_unregister(&sampling_scheduler);
+cleanup_metrics_ring:
+    ESP_LOGD(TAG, "Unregistering metrics ring...");
+    metrics_publisher_unregister_ring(&metrics_ring);
+cleanup_control_subscription:
+    ESP_LOGD(TAG, "Unsubscribing from sensor control...");
+    event_bus_unsubscribe(control_subscription);
+    control_subscription = NULL;
+cleanup_interrupt:
+    if (TIME_OF_FLIGHT_INTERRUPT_ENABLED)
+    {
+        ESP_LOGD(TAG, "Removing data ready interrupt...");
+        gpio_interrupt_detach(TIME_OF_FLIGHT_GPIO_INT);
+    }
 cleanup_start:
     ESP_LOGD(TAG, "Stopping sensor...");
     cleanup_ret = vl53l1x_stop(&device_descriptor);
@@ -189,6 +745,14 @@ cleanup_start:
         ESP_LOGE(TAG, "Failed to stop sensor: %s. aborting program.", esp_err_to_name(cleanup_ret));
         abort();
     }
+cleanup_register_handle:
+    ESP_LOGD(TAG, "Removing register handle...");
+    cleanup_ret = i2c_master_bus_rm_device(register_handle);
+    if (cleanup_ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to remove register handle: %s. aborting program.", esp_err_to_name(cleanup_ret));
+        abort();
+    }
 cleanup_device_descriptor:
     ESP_LOGD(TAG, "Deinitializing device...");
     cleanup_ret = vl53l1x_deinit(&device_descriptor);
@@ -209,6 +773,23 @@ esp_err_t time_of_flight_deinit(void)
     vTaskDelete(task_handle);
     task_handle = NULL;
 
+    ESP_LOGI(TAG, "Unregistering sampling schedulers...");
+    sampling_scheduler_unregister(&scan_scheduler);
+    sampling_scheduler_unregister(&sampling_scheduler);
+
+    ESP_LOGI(TAG, "Unregistering metrics ring...");
+    metrics_publisher_unregister_ring(&metrics_ring);
+
+    ESP_LOGI(TAG, "Unsubscribing from sensor control...");
+    event_bus_unsubscribe(control_subscription);
+    control_subscription = NULL;
+
+    if (TIME_OF_FLIGHT_INTERRUPT_ENABLED)
+    {
+        ESP_LOGI(TAG, "Removing data ready interrupt...");
+        gpio_interrupt_detach(TIME_OF_FLIGHT_GPIO_INT);
+    }
+
     ESP_LOGI(TAG, "Stopping sensor...");
     ret = vl53l1x_stop(&device_descriptor);
     if (ret != ESP_OK)
@@ -217,6 +798,14 @@ esp_err_t time_of_flight_deinit(void)
         return ret;
     }
 
+    ESP_LOGI(TAG, "Removing register handle...");
+    ret = i2c_master_bus_rm_device(register_handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to remove register handle: %s.", esp_err_to_name(ret));
+        return ret;
+    }
+
     ESP_LOGI(TAG, "Deinitializing device...");
     ret = vl53l1x_deinit(&device_descriptor);
     if (ret != ESP_OK)
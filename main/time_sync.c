@@ -3,6 +3,7 @@
 #include <esp_err.h>
 #include <esp_log.h>
 #include <esp_sntp.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <sys/time.h>
@@ -14,10 +15,23 @@ static const char *TAG = "time sync";
 
 SemaphoreHandle_t time_sync_status = NULL;
 
-static void sntp_callback(struct timeval *)
+/* Written by the SNTP callback and read by the metrics publisher, a 64 bit access is not atomic on the ESP32. */
+static int64_t wall_clock_offset_us;
+static portMUX_TYPE wall_clock_offset_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void sntp_callback(struct timeval *time_value)
 {
-    ESP_LOGD(TAG, "Received time synchronnization event, giving semaphore...");
-    xSemaphoreGive(time_sync_status);
+    const int64_t offset_us = (int64_t)time_value->tv_sec * 1000000 + time_value->tv_usec - esp_timer_get_time();
+    taskENTER_CRITICAL(&wall_clock_offset_lock);
+    wall_clock_offset_us = offset_us;
+    taskEXIT_CRITICAL(&wall_clock_offset_lock);
+    ESP_LOGD(TAG, "Wall clock offset is now %lld us.", offset_us);
+
+    if (time_sync_status != NULL)
+    {
+        ESP_LOGD(TAG, "Received time synchronnization event, giving semaphore...");
+        xSemaphoreGive(time_sync_status);
+    }
 }
 
 esp_err_t time_sync_init(void)
@@ -47,8 +61,18 @@ esp_err_t time_sync_init(void)
     xSemaphoreTake(time_sync_status, portMAX_DELAY);
 
     ESP_LOGI(TAG, "Deleting time sync semaphore...");
-    vSemaphoreDelete(time_sync_status);
+    // Later synchronizations only refresh the wall clock offset, so detach the semaphore from the callback first.
+    const SemaphoreHandle_t semaphore = time_sync_status;
     time_sync_status = NULL;
+    vSemaphoreDelete(semaphore);
 
     return ESP_OK;
 }
+
+int64_t time_sync_wall_clock_offset_us(void)
+{
+    taskENTER_CRITICAL(&wall_clock_offset_lock);
+    const int64_t offset_us = wall_clock_offset_us;
+    taskEXIT_CRITICAL(&wall_clock_offset_lock);
+    return offset_us;
+}
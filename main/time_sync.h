@@ -2,6 +2,7 @@
 
 #include <esp_err.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @brief Synchronizes system time using SNTP.
@@ -13,3 +14,14 @@
  * @return ESP_OK on success, or an error code on failure.
  */
 esp_err_t time_sync_init(void);
+
+/**
+ * @brief Returns the wall clock time at boot, in microseconds since the epoch.
+ *
+ * Adding a monotonic timestamp from esp_timer_get_time() to this offset
+ * gives the wall clock time of that timestamp. The offset is refreshed on
+ * every SNTP synchronization.
+ *
+ * @return The wall clock offset in microseconds.
+ */
+int64_t time_sync_wall_clock_offset_us(void);
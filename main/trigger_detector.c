@@ -0,0 +1,63 @@
+#include "trigger_detector.h"
+
+void trigger_detector_init(trigger_detector_t *detector, const trigger_detector_config_t *config)
+{
+    detector->config = *config;
+    trigger_detector_reset(detector);
+}
+
+void trigger_detector_reset(trigger_detector_t *detector)
+{
+    detector->state = TRIGGER_DETECTOR_STATE_IDLE;
+    detector->state_since_us = 0;
+}
+
+bool trigger_detector_update(trigger_detector_t *detector, float value, int64_t timestamp_us)
+{
+    const trigger_detector_config_t *config = &detector->config;
+
+    // Hold-off is left first, so a sample arriving right after it can start the next episode.
+    if (detector->state == TRIGGER_DETECTOR_STATE_HOLD_OFF && timestamp_us - detector->state_since_us >= config->hold_off_us)
+    {
+        detector->state = TRIGGER_DETECTOR_STATE_IDLE;
+    }
+
+    switch (detector->state)
+    {
+    case TRIGGER_DETECTOR_STATE_IDLE:
+        if (value <= config->trigger_threshold)
+        {
+            return false;
+        }
+        detector->state = TRIGGER_DETECTOR_STATE_DEBOUNCING;
+        detector->state_since_us = timestamp_us;
+        // A zero debounce triggers on this very sample.
+        /* fall through */
+
+    case TRIGGER_DETECTOR_STATE_DEBOUNCING:
+        if (value <= config->trigger_threshold)
+        {
+            detector->state = TRIGGER_DETECTOR_STATE_IDLE;
+            return false;
+        }
+        if (timestamp_us - detector->state_since_us < config->debounce_us)
+        {
+            return false;
+        }
+        detector->state = TRIGGER_DETECTOR_STATE_ACTIVE;
+        detector->state_since_us = timestamp_us;
+        return true;
+
+    case TRIGGER_DETECTOR_STATE_ACTIVE:
+        if (value < config->release_threshold)
+        {
+            detector->state = TRIGGER_DETECTOR_STATE_HOLD_OFF;
+            detector->state_since_us = timestamp_us;
+        }
+        return false;
+
+    case TRIGGER_DETECTOR_STATE_HOLD_OFF:
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Tuning of a trigger detector.
+ *
+ * A trigger episode starts once the value has stayed above
+ * trigger_threshold for debounce_us, and ends once the value falls below
+ * release_threshold. The gap between the two thresholds is the hysteresis
+ * band that keeps a value hovering around the threshold from starting new
+ * episodes. After an episode ends, no new episode starts for hold_off_us.
+ */
+typedef struct
+{
+    float trigger_threshold;
+    float release_threshold;
+    int64_t debounce_us;
+    int64_t hold_off_us;
+} trigger_detector_config_t;
+
+typedef enum
+{
+    TRIGGER_DETECTOR_STATE_IDLE,
+    TRIGGER_DETECTOR_STATE_DEBOUNCING,
+    TRIGGER_DETECTOR_STATE_ACTIVE,
+    TRIGGER_DETECTOR_STATE_HOLD_OFF,
+} trigger_detector_state_t;
+
+/**
+ * @brief Turns a stream of sensor values into one trigger per episode.
+ */
+typedef struct
+{
+    trigger_detector_config_t config;
+    trigger_detector_state_t state;
+    int64_t state_since_us;
+} trigger_detector_t;
+
+/**
+ * @brief Sets up a detector in the idle state.
+ *
+ * @param detector Detector to initialize.
+ * @param config Thresholds and timings, release_threshold must not exceed trigger_threshold.
+ */
+void trigger_detector_init(trigger_detector_t *detector, const trigger_detector_config_t *config);
+
+/**
+ * @brief Forgets any running episode, for example when the sensor is disabled.
+ *
+ * @param detector Detector to reset.
+ */
+void trigger_detector_reset(trigger_detector_t *detector);
+
+/**
+ * @brief Feeds one sample into the detector.
+ *
+ * @param detector Detector to update.
+ * @param value Sampled value.
+ * @param timestamp_us Time of the sample in microseconds since boot.
+ *
+ * @return true exactly once per episode, for the sample that starts it.
+ */
+bool trigger_detector_update(trigger_detector_t *detector, float value, int64_t timestamp_us);
@@ -0,0 +1,227 @@
+#include "vibration_detector.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define VIBRATION_DETECTOR_SLOT_MASK (VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES - 1)
+
+_Static_assert((VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES & VIBRATION_DETECTOR_SLOT_MASK) == 0, "The window must be a power of two");
+
+static void extremes_reset(vibration_detector_extremes_t *extremes)
+{
+    extremes->head = 0;
+    extremes->count = 0;
+}
+
+static uint16_t extremes_front(const vibration_detector_extremes_t *extremes) { return extremes->slots[extremes->head]; }
+
+/**
+ * @brief Drops the front if it is the slot about to be overwritten.
+ */
+static void extremes_evict(vibration_detector_extremes_t *extremes, uint16_t slot)
+{
+    if (extremes->count > 0 && extremes_front(extremes) == slot)
+    {
+        extremes->head = (extremes->head + 1) & VIBRATION_DETECTOR_SLOT_MASK;
+        extremes->count--;
+    }
+}
+
+/**
+ * @brief Appends a slot, dropping every older slot it dominates.
+ *
+ * @param extremes Extremes to append to.
+ * @param values Window the slots point into.
+ * @param slot Slot of the new value.
+ * @param sign 1 to track the maximum, -1 to track the minimum.
+ */
+static void extremes_push(vibration_detector_extremes_t *extremes, const float *values, uint16_t slot, float sign)
+{
+    const float value = sign * values[slot];
+    while (extremes->count > 0)
+    {
+        const uint16_t back = extremes->slots[(extremes->head + extremes->count - 1) & VIBRATION_DETECTOR_SLOT_MASK];
+        if (sign * values[back] > value)
+        {
+            break;
+        }
+        extremes->count--;
+    }
+    extremes->slots[(extremes->head + extremes->count) & VIBRATION_DETECTOR_SLOT_MASK] = slot;
+    extremes->count++;
+}
+
+void vibration_detector_init(vibration_detector_t *detector, const vibration_detector_config_t *config)
+{
+    detector->config = *config;
+    if (detector->config.window_samples > VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES)
+    {
+        detector->config.window_samples = VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES;
+    }
+    if (detector->config.window_samples == 0)
+    {
+        detector->config.window_samples = 1;
+    }
+    vibration_detector_reset(detector);
+}
+
+void vibration_detector_reset(vibration_detector_t *detector)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        extremes_reset(&detector->maxima[axis]);
+        extremes_reset(&detector->minima[axis]);
+        detector->crossing_counts[axis] = 0;
+        detector->crossing_signs[axis] = 0;
+        detector->previous[axis] = 0;
+    }
+    extremes_reset(&detector->jerk_maxima);
+    detector->squared_magnitude_sum = 0;
+    detector->next_slot = 0;
+    detector->sample_count = 0;
+    memset(&detector->features, 0, sizeof(detector->features));
+    detector->classification = VIBRATION_DETECTOR_CLASS_QUIET;
+}
+
+/**
+ * @brief Tracks which side of the deadband an axis is on.
+ *
+ * @return true if the axis crossed from one side to the other.
+ */
+static bool update_crossing(int8_t *sign, float value, float deadband)
+{
+    int8_t side = 0;
+    if (value > deadband)
+    {
+        side = 1;
+    }
+    else if (value < -deadband)
+    {
+        side = -1;
+    }
+
+    if (side == 0 || side == *sign)
+    {
+        return false;
+    }
+
+    const bool crossed = *sign != 0;
+    *sign = side;
+    return crossed;
+}
+
+float vibration_detector_update(vibration_detector_t *detector, float x, float y, float z)
+{
+    const vibration_detector_config_t *config = &detector->config;
+    const float sample[3] = {x, y, z};
+    const uint16_t slot = detector->next_slot;
+
+    // Once the window is full, the slot being written holds the sample leaving it.
+    if (detector->sample_count >= config->window_samples)
+    {
+        detector->squared_magnitude_sum -= detector->squared_magnitudes[slot];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            detector->crossing_counts[axis] -= (detector->crossings[slot] >> axis) & 1;
+            extremes_evict(&detector->maxima[axis], slot);
+            extremes_evict(&detector->minima[axis], slot);
+        }
+        extremes_evict(&detector->jerk_maxima, slot);
+    }
+
+    float squared_magnitude = 0;
+    float squared_difference = 0;
+    uint8_t crossings = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float difference = sample[axis] - detector->previous[axis];
+        squared_magnitude += sample[axis] * sample[axis];
+        squared_difference += difference * difference;
+        detector->previous[axis] = sample[axis];
+
+        if (update_crossing(&detector->crossing_signs[axis], sample[axis], config->crossing_deadband_g))
+        {
+            crossings |= 1 << axis;
+            detector->crossing_counts[axis]++;
+        }
+
+        detector->samples[axis][slot] = sample[axis];
+        extremes_push(&detector->maxima[axis], detector->samples[axis], slot, 1.0f);
+        extremes_push(&detector->minima[axis], detector->samples[axis], slot, -1.0f);
+    }
+
+    detector->squared_magnitudes[slot] = squared_magnitude;
+    detector->squared_magnitude_sum += squared_magnitude;
+    // The first sample has no predecessor to differentiate against.
+    detector->squared_jerks[slot] = detector->sample_count > 0 ? squared_difference * config->sample_rate_hz * config->sample_rate_hz : 0;
+    extremes_push(&detector->jerk_maxima, detector->squared_jerks, slot, 1.0f);
+    detector->crossings[slot] = crossings;
+
+    detector->sample_count++;
+    detector->next_slot = slot + 1;
+    if (detector->next_slot == config->window_samples)
+    {
+        detector->next_slot = 0;
+
+        // Recomputing the running sum once per window keeps float rounding from piling up.
+        float sum = 0;
+        for (uint16_t i = 0; i < config->window_samples; i++)
+        {
+            sum += detector->squared_magnitudes[i];
+        }
+        detector->squared_magnitude_sum = sum;
+    }
+
+    const uint16_t window_count = detector->sample_count < config->window_samples ? detector->sample_count : config->window_samples;
+    vibration_detector_features_t *features = &detector->features;
+    features->rms_g = sqrtf(fmaxf(detector->squared_magnitude_sum, 0) / window_count);
+    features->jerk_g_per_s = sqrtf(detector->squared_jerks[extremes_front(&detector->jerk_maxima)]);
+    features->peak_to_peak_g = 0;
+    uint16_t crossing_count = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float peak_to_peak = detector->samples[axis][extremes_front(&detector->maxima[axis])] - detector->samples[axis][extremes_front(&detector->minima[axis])];
+        features->peak_to_peak_g = fmaxf(features->peak_to_peak_g, peak_to_peak);
+        if (detector->crossing_counts[axis] > crossing_count)
+        {
+            crossing_count = detector->crossing_counts[axis];
+        }
+    }
+    features->crossing_rate_hz = crossing_count * config->sample_rate_hz / window_count;
+
+    // The ringing of a knock crosses zero too, so an impulsive window is never sustained motion.
+    const bool impulsive = features->peak_to_peak_g >= config->knock_crest_factor * features->rms_g;
+    const float knock_level = impulsive && features->jerk_g_per_s >= config->knock_jerk_g_per_s ? features->peak_to_peak_g / config->knock_peak_to_peak_g : 0;
+    const float sustained_level = !impulsive && features->crossing_rate_hz >= config->sustained_crossing_rate_hz ? features->rms_g / config->sustained_rms_g : 0;
+
+    if (knock_level >= 1.0f)
+    {
+        detector->classification = VIBRATION_DETECTOR_CLASS_KNOCK;
+    }
+    else if (sustained_level >= 1.0f)
+    {
+        detector->classification = VIBRATION_DETECTOR_CLASS_SUSTAINED;
+    }
+    else
+    {
+        detector->classification = VIBRATION_DETECTOR_CLASS_QUIET;
+    }
+
+    return fmaxf(sustained_level, knock_level);
+}
+
+const char *vibration_detector_class_to_name(vibration_detector_class_t classification)
+{
+    switch (classification)
+    {
+    case VIBRATION_DETECTOR_CLASS_QUIET:
+        return "VIBRATION_DETECTOR_CLASS_QUIET";
+    case VIBRATION_DETECTOR_CLASS_KNOCK:
+        return "VIBRATION_DETECTOR_CLASS_KNOCK";
+    case VIBRATION_DETECTOR_CLASS_SUSTAINED:
+        return "VIBRATION_DETECTOR_CLASS_SUSTAINED";
+    default:
+        return "INVALID_VIBRATION_DETECTOR_CLASS";
+    }
+}
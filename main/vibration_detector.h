@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Longest window a detector can hold, a power of two. */
+#define VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES 256
+
+/**
+ * @brief Tuning of a vibration detector.
+ *
+ * All features are taken over the last window_samples samples. A knock is a
+ * short impulse: a large peak-to-peak swing with a steep edge that towers
+ * over the RMS of the window, by at least knock_crest_factor. Sustained
+ * motion is oscillation that keeps the RMS up and keeps crossing zero, which
+ * a slow tilt leaking through the gravity filter does not. Zero crossings
+ * only count once the signal leaves the deadband around zero, so sensor
+ * noise at rest does not cross.
+ */
+typedef struct
+{
+    float sample_rate_hz;
+    uint16_t window_samples;
+    float crossing_deadband_g;
+    float knock_peak_to_peak_g;
+    float knock_jerk_g_per_s;
+    float knock_crest_factor;
+    float sustained_rms_g;
+    float sustained_crossing_rate_hz;
+} vibration_detector_config_t;
+
+typedef enum
+{
+    VIBRATION_DETECTOR_CLASS_QUIET,
+    VIBRATION_DETECTOR_CLASS_KNOCK,
+    VIBRATION_DETECTOR_CLASS_SUSTAINED,
+} vibration_detector_class_t;
+
+/**
+ * @brief Features of the current window.
+ */
+typedef struct
+{
+    float rms_g;
+    float peak_to_peak_g;   /* Largest of the three axes. */
+    float jerk_g_per_s;     /* Steepest change between two samples. */
+    float crossing_rate_hz; /* Largest of the three axes. */
+} vibration_detector_features_t;
+
+/**
+ * @brief Slots of the window holding the running maximum or minimum, oldest first.
+ *
+ * The values behind the slots are monotonic, so the front always holds the
+ * extreme of the window.
+ */
+typedef struct
+{
+    uint16_t slots[VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES];
+    uint16_t head;
+    uint16_t count;
+} vibration_detector_extremes_t;
+
+/**
+ * @brief Classifies gravity free acceleration by sliding window features.
+ *
+ * Every feature is updated in constant amortized time per sample.
+ */
+typedef struct
+{
+    vibration_detector_config_t config;
+    vibration_detector_features_t features;
+    vibration_detector_class_t classification;
+
+    float samples[3][VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES];
+    float squared_magnitudes[VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES];
+    float squared_jerks[VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES];
+    uint8_t crossings[VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES]; /* Bit per axis. */
+
+    vibration_detector_extremes_t maxima[3];
+    vibration_detector_extremes_t minima[3];
+    vibration_detector_extremes_t jerk_maxima;
+
+    float squared_magnitude_sum;
+    uint16_t crossing_counts[3];
+    int8_t crossing_signs[3];
+    float previous[3];
+    uint16_t next_slot;
+    uint32_t sample_count;
+} vibration_detector_t;
+
+/**
+ * @brief Sets up a detector with an empty window.
+ *
+ * @param detector Detector to initialize.
+ * @param config Tuning, window_samples is limited to VIBRATION_DETECTOR_MAX_WINDOW_SAMPLES.
+ */
+void vibration_detector_init(vibration_detector_t *detector, const vibration_detector_config_t *config);
+
+/**
+ * @brief Empties the window, for example when the sensor is disabled.
+ *
+ * @param detector Detector to reset.
+ */
+void vibration_detector_reset(vibration_detector_t *detector);
+
+/**
+ * @brief Feeds one sample into the window and classifies the window.
+ *
+ * The features and classification of the detector are updated as well.
+ *
+ * @param detector Detector to update.
+ * @param x X component of the gravity free acceleration in g.
+ * @param y Y component.
+ * @param z Z component.
+ *
+ * @return Trigger level of the window, relative to the knock or sustained
+ * thresholds whichever is closer, so 1.0 is where the window stops being quiet.
+ */
+float vibration_detector_update(vibration_detector_t *detector, float x, float y, float z);
+
+/**
+ * @brief Returns the name of a classification for logging.
+ */
+const char *vibration_detector_class_to_name(vibration_detector_class_t classification);
@@ -0,0 +1,96 @@
+/*
+ * Time per reading of the magnitude and threshold math, the per sample
+ * sqrt(pow()) code against the block kernels that replaced it.
+ *
+ * Usage: bench_accelerometer_dsp [block count]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "accelerometer_dsp.h"
+
+#define BENCH_BLOCK_SIZE 32
+#define BENCH_THRESHOLD 1.7f
+
+static float vec3_sum(float x, float y, float z) { return sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2)); }
+
+static double now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t block_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+
+    static int16_t raw[3][BENCH_BLOCK_SIZE];
+    static float x[BENCH_BLOCK_SIZE];
+    static float y[BENCH_BLOCK_SIZE];
+    static float z[BENCH_BLOCK_SIZE];
+    srand(1);
+    for (size_t i = 0; i < BENCH_BLOCK_SIZE; i++)
+    {
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            raw[axis][i] = (int16_t)(rand() % 65536 - 32768);
+        }
+        x[i] = raw[0][i] / 16384.0f;
+        y[i] = raw[1][i] / 16384.0f;
+        z[i] = raw[2][i] / 16384.0f;
+    }
+
+    /* Every result feeds the checksum so the compiler keeps all the work, z is rotated by one reading per block so no block repeats. */
+    volatile size_t sink = 0;
+
+    double start_ns = now_ns();
+    for (size_t block = 0; block < block_count; block++)
+    {
+        size_t above = 0;
+        for (size_t i = 0; i < BENCH_BLOCK_SIZE; i++)
+        {
+            above += vec3_sum(x[i], y[i], z[(i + block) % BENCH_BLOCK_SIZE]) > BENCH_THRESHOLD;
+        }
+        sink += above;
+    }
+    const double per_sample_ns = (now_ns() - start_ns) / (double)(block_count * BENCH_BLOCK_SIZE);
+    const size_t per_sample_checksum = sink;
+
+    float squared[BENCH_BLOCK_SIZE];
+    sink = 0;
+    start_ns = now_ns();
+    for (size_t block = 0; block < block_count; block++)
+    {
+        const size_t shift = block % BENCH_BLOCK_SIZE;
+        accelerometer_dsp_squared_magnitude_f32(x, y, z + shift, squared, BENCH_BLOCK_SIZE - shift);
+        accelerometer_dsp_squared_magnitude_f32(x + BENCH_BLOCK_SIZE - shift, y + BENCH_BLOCK_SIZE - shift, z, squared + BENCH_BLOCK_SIZE - shift, shift);
+        sink += accelerometer_dsp_count_above_f32(squared, BENCH_BLOCK_SIZE, BENCH_THRESHOLD * BENCH_THRESHOLD);
+    }
+    const double block_f32_ns = (now_ns() - start_ns) / (double)(block_count * BENCH_BLOCK_SIZE);
+    const size_t block_f32_checksum = sink;
+
+    uint32_t squared_raw[BENCH_BLOCK_SIZE];
+    sink = 0;
+    start_ns = now_ns();
+    for (size_t block = 0; block < block_count; block++)
+    {
+        accelerometer_dsp_squared_magnitude_s16(raw[0], raw[1], raw[2], squared_raw, BENCH_BLOCK_SIZE);
+        const float scale = (1.0f / 16384.0f) * (1.0f / 16384.0f);
+        for (size_t i = 0; i < BENCH_BLOCK_SIZE; i++)
+        {
+            squared[i] = squared_raw[i] * scale;
+        }
+        sink += accelerometer_dsp_count_above_f32(squared, BENCH_BLOCK_SIZE, BENCH_THRESHOLD * BENCH_THRESHOLD + (float)(block & 1) * 1e-3f);
+    }
+    const double block_s16_ns = (now_ns() - start_ns) / (double)(block_count * BENCH_BLOCK_SIZE);
+
+    printf("%zu blocks of %d readings\n", block_count, BENCH_BLOCK_SIZE);
+    printf("sqrt(pow()) per sample %8.2f ns/reading\n", per_sample_ns);
+    printf("block f32 kernels      %8.2f ns/reading, %.1fx\n", block_f32_ns, per_sample_ns / block_f32_ns);
+    printf("block s16 kernels      %8.2f ns/reading, %.1fx\n", block_s16_ns, per_sample_ns / block_s16_ns);
+    return per_sample_checksum == block_f32_checksum ? 0 : 1;
+}
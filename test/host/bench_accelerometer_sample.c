@@ -0,0 +1,172 @@
+/*
+ * Cost per accelerometer reading of the handoff to the metrics publisher,
+ * before and after the reading became a single METRIC_TYPE_ACCELEROMETER_SAMPLE.
+ *
+ * Before, every reading was queued as eight metric_t values with their own
+ * timestamp, and the publisher received and serialized each of them. After,
+ * one sample metric is queued, received and serialized per reading. Both
+ * paths run through the same queue of the FreeRTOS host shim and the same
+ * serializer, in both wire formats, so the ratio of the two is the
+ * interesting number.
+ *
+ * Usage: bench_accelerometer_sample [reading count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "metrics_serializer.h"
+#include "queue.h"
+
+#define BENCH_QUEUE_DEPTH 128
+#define BENCH_PAYLOAD_SIZE 8192
+
+typedef struct
+{
+    const char *name;
+    double cpu_ns_per_reading;
+    double queue_operations_per_reading;
+    double bytes_per_reading;
+} result_t;
+
+static QueueHandle_t queue;
+static size_t queue_operations;
+static char payload[BENCH_PAYLOAD_SIZE];
+static metrics_serializer_t serializer;
+static size_t serialized_bytes;
+
+static double cpu_time_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static void read_sensor(size_t reading, float values[8])
+{
+    for (size_t i = 0; i < 8; i++)
+    {
+        values[i] = (float)((reading + i) % 200) * 0.01f - 1.0f;
+    }
+}
+
+static void send(const metric_t *metric)
+{
+    xQueueSendToBack(queue, metric, 0);
+    queue_operations++;
+}
+
+/* Publisher side, receives everything queued and serializes it into batches. */
+static void drain(void)
+{
+    metric_t metric;
+    while (xQueueReceive(queue, &metric, 0) == pdTRUE)
+    {
+        queue_operations++;
+        if (metrics_serializer_append(&serializer, &metric) != ESP_OK)
+        {
+            metrics_serializer_end(&serializer);
+            serialized_bytes += serializer.length;
+            metrics_serializer_begin(&serializer, 0);
+            metrics_serializer_append(&serializer, &metric);
+        }
+    }
+}
+
+static void produce_per_axis(size_t reading)
+{
+    static const metric_type_t axes[8] = {
+        METRIC_TYPE_ACCELEROMETER_ACCELERATION_X, METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y, METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z, METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL,
+        METRIC_TYPE_ACCELEROMETER_ROTATION_X,     METRIC_TYPE_ACCELEROMETER_ROTATION_Y,     METRIC_TYPE_ACCELEROMETER_ROTATION_Z,     METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL,
+    };
+
+    float values[8];
+    read_sensor(reading, values);
+    for (size_t i = 0; i < 8; i++)
+    {
+        const metric_t metric = {
+            .metric_type = axes[i],
+            .kind = METRIC_KIND_SAMPLE,
+            .timestamp_us = esp_timer_get_time(),
+            .float_value = values[i],
+        };
+        send(&metric);
+    }
+}
+
+static void produce_sample(size_t reading)
+{
+    float values[8];
+    read_sensor(reading, values);
+    const metric_t metric = {
+        .metric_type = METRIC_TYPE_ACCELEROMETER_SAMPLE,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = esp_timer_get_time(),
+        .accelerometer_sample = {values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7]},
+    };
+    send(&metric);
+}
+
+static result_t run(const char *name, void (*produce)(size_t), size_t reading_count)
+{
+    queue_operations = 0;
+    serialized_bytes = 0;
+    metrics_serializer_begin(&serializer, 0);
+
+    const double start_ns = cpu_time_ns();
+    for (size_t reading = 0; reading < reading_count; reading++)
+    {
+        produce(reading);
+        drain();
+    }
+    metrics_serializer_end(&serializer);
+    serialized_bytes += serializer.length;
+    const double elapsed_ns = cpu_time_ns() - start_ns;
+
+    return (result_t){
+        .name = name,
+        .cpu_ns_per_reading = elapsed_ns / (double)reading_count,
+        .queue_operations_per_reading = (double)queue_operations / (double)reading_count,
+        .bytes_per_reading = (double)serialized_bytes / (double)reading_count,
+    };
+}
+
+int main(int argc, char **argv)
+{
+    const size_t reading_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+
+    queue = xQueueCreate(BENCH_QUEUE_DEPTH, sizeof(metric_t));
+    printf("%zu readings, queue of %d metric_t (%zu bytes each)\n", reading_count, BENCH_QUEUE_DEPTH, sizeof(metric_t));
+    printf("%-7s %-10s %14s %18s %16s\n", "format", "path", "cpu ns/reading", "queue ops/reading", "bytes/reading");
+
+    int ret = 0;
+    static const metrics_serializer_format_t formats[] = {METRICS_SERIALIZER_FORMAT_JSON, METRICS_SERIALIZER_FORMAT_BINARY};
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        const char *format_name = formats[f] == METRICS_SERIALIZER_FORMAT_JSON ? "json" : "binary";
+        metrics_serializer_init(&serializer, formats[f], payload, sizeof(payload));
+
+        const result_t results[] = {
+            run("8 metrics", produce_per_axis, reading_count),
+            run("1 sample", produce_sample, reading_count),
+        };
+        for (size_t i = 0; i < sizeof(results) / sizeof(results[0]); i++)
+        {
+            printf("%-7s %-10s %14.1f %18.1f %16.1f\n", format_name, results[i].name, results[i].cpu_ns_per_reading, results[i].queue_operations_per_reading, results[i].bytes_per_reading);
+        }
+        printf("%-7s cpu time per reading reduced %.1fx\n", format_name, results[0].cpu_ns_per_reading / results[1].cpu_ns_per_reading);
+
+        if (results[1].queue_operations_per_reading >= results[0].queue_operations_per_reading)
+        {
+            ret = 1;
+        }
+    }
+
+    vQueueDelete(queue);
+    return ret;
+}
@@ -0,0 +1,225 @@
+/*
+ * Publish to delivery latency and throughput of the event bus, compared with
+ * the direct queue sends it replaced.
+ *
+ * Two cases of the application are measured:
+ *  - control: one message fanned out to the accelerometer and time of flight
+ *    control queues, blocking when a queue is full. Directly this took one
+ *    xQueueSendToBack per queue, on the bus it is one event_bus_publish().
+ *  - metrics: a stream of metric_t into the 128 deep metrics queue of the
+ *    publisher.
+ *
+ * Every subscriber runs in its own thread. Queues are those of the FreeRTOS
+ * host shim, so the numbers compare the overhead of the bus with the queue
+ * operations underneath it, not timings on the ESP32.
+ *
+ * Usage: bench_event_bus [message count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "app_resources.h"
+#include "event_bus.h"
+#include "queue.h"
+
+#define BENCH_MAX_CONSUMERS 2
+
+typedef struct
+{
+    const char *name;
+    size_t consumer_count;
+    size_t event_size;
+    /* Direct path. */
+    QueueHandle_t queues[BENCH_MAX_CONSUMERS];
+    /* Event bus path. */
+    event_bus_topic_t topic;
+    event_bus_subscription_t *subscriptions[BENCH_MAX_CONSUMERS];
+    bool use_bus;
+    size_t message_count;
+} scenario_t;
+
+typedef struct
+{
+    scenario_t *scenario;
+    size_t index;
+    int64_t *latencies_ns;
+} consumer_t;
+
+static int64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* The timestamp field of the event carries the publish time in ns, for a finer latency than the us of esp_timer. */
+static int64_t event_timestamp(const scenario_t *scenario, const void *event)
+{
+    return scenario->event_size == sizeof(message_t) ? ((const message_t *)event)->timestamp_us : ((const metric_t *)event)->timestamp_us;
+}
+
+static void *consume(void *argument)
+{
+    consumer_t *consumer = argument;
+    scenario_t *scenario = consumer->scenario;
+    union
+    {
+        message_t message;
+        metric_t metric;
+    } event;
+
+    for (size_t i = 0; i < scenario->message_count; i++)
+    {
+        if (scenario->use_bus)
+        {
+            event_bus_receive(scenario->subscriptions[consumer->index], &event, portMAX_DELAY);
+        }
+        else
+        {
+            xQueueReceive(scenario->queues[consumer->index], &event, portMAX_DELAY);
+        }
+        consumer->latencies_ns[i] = now_ns() - event_timestamp(scenario, &event);
+    }
+    return NULL;
+}
+
+static void publish(scenario_t *scenario, size_t sequence)
+{
+    union
+    {
+        message_t message;
+        metric_t metric;
+    } event;
+    memset(&event, 0, sizeof(event));
+
+    if (scenario->event_size == sizeof(message_t))
+    {
+        event.message = (message_t){
+            .component = COMPONENT_TASK_ORCHASTRATOR,
+            .type = sequence % 2 == 0 ? MESSAGE_TYPE_ENABLE : MESSAGE_TYPE_DISABLE,
+            .timestamp_us = now_ns(),
+        };
+    }
+    else
+    {
+        event.metric = (metric_t){
+            .metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE,
+            .kind = METRIC_KIND_SAMPLE,
+            .timestamp_us = now_ns(),
+            .uint16_value = (uint16_t)sequence,
+        };
+    }
+
+    if (scenario->use_bus)
+    {
+        event_bus_publish(scenario->topic, &event);
+        return;
+    }
+    for (size_t i = 0; i < scenario->consumer_count; i++)
+    {
+        xQueueSendToBack(scenario->queues[i], &event, portMAX_DELAY);
+    }
+}
+
+static int compare_latency(const void *left, const void *right)
+{
+    const int64_t a = *(const int64_t *)left;
+    const int64_t b = *(const int64_t *)right;
+    return (a > b) - (a < b);
+}
+
+static void run(scenario_t *scenario, bool use_bus)
+{
+    scenario->use_bus = use_bus;
+
+    pthread_t threads[BENCH_MAX_CONSUMERS];
+    consumer_t consumers[BENCH_MAX_CONSUMERS];
+    for (size_t i = 0; i < scenario->consumer_count; i++)
+    {
+        consumers[i] = (consumer_t){
+            .scenario = scenario,
+            .index = i,
+            .latencies_ns = malloc(scenario->message_count * sizeof(int64_t)),
+        };
+        pthread_create(&threads[i], NULL, consume, &consumers[i]);
+    }
+
+    const int64_t start_ns = now_ns();
+    for (size_t i = 0; i < scenario->message_count; i++)
+    {
+        publish(scenario, i);
+    }
+    for (size_t i = 0; i < scenario->consumer_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    const int64_t elapsed_ns = now_ns() - start_ns;
+
+    /* Latencies of every consumer together. */
+    const size_t sample_count = scenario->message_count * scenario->consumer_count;
+    int64_t *latencies_ns = malloc(sample_count * sizeof(int64_t));
+    for (size_t i = 0; i < scenario->consumer_count; i++)
+    {
+        memcpy(&latencies_ns[i * scenario->message_count], consumers[i].latencies_ns, scenario->message_count * sizeof(int64_t));
+        free(consumers[i].latencies_ns);
+    }
+    qsort(latencies_ns, sample_count, sizeof(int64_t), compare_latency);
+
+    printf("%-8s %-7s %14.0f %12.2f %12.2f %12.2f\n", scenario->name, use_bus ? "bus" : "direct", (double)scenario->message_count * 1e9 / (double)elapsed_ns,
+           (double)latencies_ns[sample_count / 2] / 1000.0, (double)latencies_ns[sample_count * 99 / 100] / 1000.0, (double)latencies_ns[sample_count - 1] / 1000.0);
+    free(latencies_ns);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t message_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+
+    scenario_t control = {
+        .name = "control",
+        .consumer_count = 2,
+        .event_size = sizeof(message_t),
+        .topic = EVENT_BUS_TOPIC_SENSOR_CONTROL,
+        .message_count = message_count,
+    };
+    scenario_t metrics = {
+        .name = "metrics",
+        .consumer_count = 1,
+        .event_size = sizeof(metric_t),
+        .topic = EVENT_BUS_TOPIC_METRICS,
+        .message_count = message_count,
+    };
+
+    /* Direct queues as deep as the ones the bus subscriptions get from the resource table. */
+    const size_t control_depth = app_resources_queue_depth(APP_RESOURCES_QUEUE_ACCELEROMETER_CONTROL);
+    control.queues[0] = xQueueCreate(control_depth, sizeof(message_t));
+    control.queues[1] = xQueueCreate(control_depth, sizeof(message_t));
+    metrics.queues[0] = xQueueCreate(app_resources_queue_depth(APP_RESOURCES_QUEUE_METRICS), sizeof(metric_t));
+
+    if (event_bus_init() != ESP_OK ||
+        event_bus_subscribe(EVENT_BUS_TOPIC_SENSOR_CONTROL, APP_RESOURCES_QUEUE_ACCELEROMETER_CONTROL, EVENT_BUS_POLICY_BLOCK, &control.subscriptions[0]) != ESP_OK ||
+        event_bus_subscribe(EVENT_BUS_TOPIC_SENSOR_CONTROL, APP_RESOURCES_QUEUE_TIME_OF_FLIGHT_CONTROL, EVENT_BUS_POLICY_BLOCK, &control.subscriptions[1]) != ESP_OK ||
+        event_bus_subscribe(EVENT_BUS_TOPIC_METRICS, APP_RESOURCES_QUEUE_METRICS, EVENT_BUS_POLICY_BLOCK, &metrics.subscriptions[0]) != ESP_OK)
+    {
+        fprintf(stderr, "failed to set up the event bus\n");
+        return 1;
+    }
+
+    printf("%zu messages per case, latency in us from publish to receive\n", message_count);
+    printf("%-8s %-7s %14s %12s %12s %12s\n", "case", "path", "messages/s", "p50", "p99", "max");
+    run(&control, false);
+    run(&control, true);
+    run(&metrics, false);
+    run(&metrics, true);
+
+    event_bus_deinit();
+    vQueueDelete(control.queues[0]);
+    vQueueDelete(control.queues[1]);
+    vQueueDelete(metrics.queues[0]);
+    return 0;
+}
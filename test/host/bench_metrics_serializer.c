@@ -0,0 +1,181 @@
+/*
+ * Serialization throughput and heap use of the streaming metrics serializer,
+ * compared with the per metric cJSON path it replaced when cJSON is available
+ * on the host.
+ *
+ * Usage: bench_metrics_serializer [metric count]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "metrics_serializer.h"
+#include "queue.h"
+
+#ifdef HAVE_CJSON
+#include <cJSON.h>
+#endif
+
+/* Every heap call goes through these counters, glibc keeps the real allocator behind __libc_*. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void __libc_free(void *pointer);
+
+static size_t heap_operations;
+
+void *malloc(size_t size)
+{
+    heap_operations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    heap_operations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    heap_operations++;
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer)
+{
+    if (pointer != NULL)
+    {
+        heap_operations++;
+    }
+    __libc_free(pointer);
+}
+
+#define BENCH_PAYLOAD_SIZE 8192
+
+static const metric_type_t metric_mix[] = {
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_X,
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y,
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z,
+    METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_X,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_Y,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_Z,
+    METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL,
+    METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE,
+};
+
+static metric_t make_metric(size_t index)
+{
+    metric_t metric = {
+        .metric_type = metric_mix[index % (sizeof(metric_mix) / sizeof(metric_mix[0]))],
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = (int64_t)index * 10000,
+    };
+    if (metric.metric_type == METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE)
+    {
+        metric.uint16_value = 1000 + index % 500;
+    }
+    else
+    {
+        metric.float_value = 0.001f * (float)(index % 2000) - 1.0f;
+    }
+    return metric;
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(const char *name, size_t metric_count, size_t bytes, size_t operations, double seconds)
+{
+    printf("%-22s %10.0f metrics/s %12.0f bytes/s %7.1f bytes/metric %6.2f heap ops/metric\n", name, metric_count / seconds, bytes / seconds, (double)bytes / metric_count, (double)operations / metric_count);
+}
+
+static void bench_streaming(const char *name, metrics_serializer_format_t format, size_t metric_count)
+{
+    static char payload[BENCH_PAYLOAD_SIZE];
+    metrics_serializer_t serializer;
+    metrics_serializer_init(&serializer, format, payload, sizeof(payload));
+
+    size_t bytes = 0;
+    heap_operations = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    metrics_serializer_begin(&serializer, 0);
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        const metric_t metric = make_metric(i);
+        if (metrics_serializer_append(&serializer, &metric) != ESP_OK)
+        {
+            metrics_serializer_end(&serializer);
+            bytes += serializer.length;
+            metrics_serializer_begin(&serializer, 0);
+            metrics_serializer_append(&serializer, &metric);
+        }
+    }
+    metrics_serializer_end(&serializer);
+    bytes += serializer.length;
+
+    report(name, metric_count, bytes, heap_operations, seconds_since(&start));
+}
+
+#ifdef HAVE_CJSON
+/* The serialization of the publisher before the streaming serializer, one pretty printed object per metric. */
+static cJSON *metric_to_cjson(const metric_t *metric)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "timestamp", (double)metric->timestamp_us);
+    cJSON_AddStringToObject(json, "metric_type", queue_metric_type_to_name(metric->metric_type));
+    if (metric->metric_type == METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE)
+    {
+        cJSON_AddNumberToObject(json, "uint16_value", metric->uint16_value);
+    }
+    else
+    {
+        cJSON_AddNumberToObject(json, "float_value", metric->float_value);
+    }
+    return json;
+}
+
+static void bench_cjson(size_t metric_count)
+{
+    size_t bytes = 0;
+    heap_operations = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        const metric_t metric = make_metric(i);
+        cJSON *json = metric_to_cjson(&metric);
+        char *text = cJSON_Print(json);
+        bytes += strlen(text);
+        free(text);
+        cJSON_Delete(json);
+    }
+
+    report("cJSON per metric", metric_count, bytes, heap_operations, seconds_since(&start));
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    const size_t metric_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+
+#ifdef HAVE_CJSON
+    bench_cjson(metric_count);
+#else
+    printf("%-22s skipped, cJSON was not found on the host\n", "cJSON per metric");
+#endif
+    bench_streaming("streaming JSON", METRICS_SERIALIZER_FORMAT_JSON, metric_count);
+    bench_streaming("streaming binary", METRICS_SERIALIZER_FORMAT_BINARY, metric_count);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Throughput of the SPSC ring against a queue of the FreeRTOS host shim,
+ * one producer and one consumer thread moving metric_t values.
+ *
+ * The queue path is xQueueSendToBack()/xQueueReceive() per metric, as the
+ * sensor tasks did before the ring. The ring is measured with single metric
+ * and with batched reserve/commit and peek/release. The shim queue copies
+ * items under a mutex like the kernel does under its critical section, but
+ * it is not the ESP32 port, so compare the ratios, not the absolute rates.
+ *
+ * Usage: bench_spsc_ring [metric count]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "spsc_ring.h"
+
+#define BENCH_CAPACITY 128
+
+static size_t metric_count;
+static size_t batch_size;
+static spsc_ring_t ring;
+static metric_t ring_buffer[BENCH_CAPACITY];
+static QueueHandle_t queue;
+
+static double now_s(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *produce_queue(void *argument)
+{
+    (void)argument;
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        const metric_t metric = {.metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE, .timestamp_us = (int64_t)i};
+        xQueueSendToBack(queue, &metric, portMAX_DELAY);
+    }
+    return NULL;
+}
+
+static int64_t consume_queue(void)
+{
+    int64_t checksum = 0;
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        metric_t metric;
+        xQueueReceive(queue, &metric, portMAX_DELAY);
+        checksum += metric.timestamp_us;
+    }
+    return checksum;
+}
+
+static void *produce_ring(void *argument)
+{
+    (void)argument;
+    for (size_t produced = 0; produced < metric_count;)
+    {
+        metric_t *slots;
+        const size_t wanted = metric_count - produced < batch_size ? metric_count - produced : batch_size;
+        const size_t reserved = spsc_ring_reserve(&ring, &slots, wanted);
+        for (size_t i = 0; i < reserved; i++)
+        {
+            slots[i].metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE;
+            slots[i].timestamp_us = (int64_t)(produced + i);
+        }
+        spsc_ring_commit(&ring, reserved);
+        produced += reserved;
+        if (reserved == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int64_t consume_ring(void)
+{
+    int64_t checksum = 0;
+    for (size_t consumed = 0; consumed < metric_count;)
+    {
+        const metric_t *items;
+        const size_t available = spsc_ring_peek(&ring, &items, batch_size);
+        for (size_t i = 0; i < available; i++)
+        {
+            checksum += items[i].timestamp_us;
+        }
+        spsc_ring_release(&ring, available);
+        consumed += available;
+        if (available == 0)
+        {
+            sched_yield();
+        }
+    }
+    return checksum;
+}
+
+static int run(const char *name, void *(*produce)(void *), int64_t (*consume)(void))
+{
+    pthread_t producer;
+    const double start_s = now_s();
+    pthread_create(&producer, NULL, produce, NULL);
+    const int64_t checksum = consume();
+    pthread_join(producer, NULL);
+    const double elapsed_s = now_s() - start_s;
+
+    const int64_t expected = (int64_t)metric_count * ((int64_t)metric_count - 1) / 2;
+    printf("%-16s %12.2f M metrics/s %10.1f ns/metric\n", name, (double)metric_count / elapsed_s / 1e6, elapsed_s * 1e9 / (double)metric_count);
+    return checksum == expected ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    metric_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000000;
+
+    queue = xQueueCreate(BENCH_CAPACITY, sizeof(metric_t));
+    if (queue == NULL || spsc_ring_init(&ring, ring_buffer, BENCH_CAPACITY) != ESP_OK)
+    {
+        return 1;
+    }
+
+    printf("%zu metrics of %zu bytes, capacity %d\n", metric_count, sizeof(metric_t), BENCH_CAPACITY);
+    int ret = run("queue", produce_queue, consume_queue);
+    batch_size = 1;
+    ret |= run("ring, batch 1", produce_ring, consume_ring);
+    batch_size = 16;
+    ret |= run("ring, batch 16", produce_ring, consume_ring);
+
+    vQueueDelete(queue);
+    return ret;
+}
@@ -0,0 +1,131 @@
+/*
+ * Serializes one batch holding every metric type and kind in both wire
+ * formats, for the round trip check of tools/decode_metrics.py.
+ *
+ * Usage: dump_metrics <json output> <binary output>
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics_serializer.h"
+#include "queue.h"
+
+#define DUMP_PAYLOAD_SIZE 8192
+#define DUMP_WALL_CLOCK_OFFSET_US 1760000000123456LL
+#define DUMP_BASE_TIMESTAMP_US 123456789LL
+
+static size_t build_batch(metric_t *metrics)
+{
+    size_t count = 0;
+    int64_t timestamp_us = DUMP_BASE_TIMESTAMP_US;
+
+    for (metric_type_t type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_X; type <= METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL; type++)
+    {
+        metrics[count++] = (metric_t){.metric_type = type, .kind = METRIC_KIND_SAMPLE, .timestamp_us = timestamp_us, .float_value = -1.2345678f + (float)type * 0.3f};
+        timestamp_us += 997;
+    }
+    metrics[count++] = (metric_t){.metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE, .kind = METRIC_KIND_SAMPLE, .timestamp_us = timestamp_us, .uint16_value = 1234};
+    metrics[count++] = (metric_t){.metric_type = METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE, .kind = METRIC_KIND_SAMPLE, .timestamp_us = timestamp_us + 1, .zone_distance = {.zone = 2, .distance_mm = 3999}};
+    metrics[count++] = (metric_t){.metric_type = METRIC_TYPE_CARD_READER_VALID, .kind = METRIC_KIND_SAMPLE, .timestamp_us = timestamp_us + 2, .bool_value = true};
+    metrics[count++] = (metric_t){.metric_type = METRIC_TYPE_ALARM_TRIGGERED, .kind = METRIC_KIND_SAMPLE, .timestamp_us = timestamp_us + 3, .bool_value = false};
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_ACCELEROMETER_SAMPLE,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = timestamp_us + 4,
+        .accelerometer_sample = {0.01f, -0.02f, 1.0f, 1.00025f, 12.5f, -3.25f, 0.125f, 12.9f},
+    };
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_QUEUE_STATS,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = timestamp_us + 5,
+        .queue_stats = {.name = "metrics", .capacity = 64, .high_water = 17, .enqueued = 100000, .dropped = 3, .latency_p50_us = 128, .latency_p99_us = 4096},
+    };
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_QUEUE_STATS,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = timestamp_us + 6,
+        .queue_stats = {.name = "twelve_chars", .capacity = 8, .high_water = 8, .enqueued = 4000000000u, .dropped = 0, .latency_p50_us = 1, .latency_p99_us = 2},
+    };
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_SAMPLING_STATS,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = timestamp_us + 7,
+        .sampling_stats = {.name = "tof/scan", .period_us = 100000, .released = 4711, .overruns = 2, .jitter_p99_us = 512, .jitter_max_us = 2222},
+    };
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL,
+        .kind = METRIC_KIND_SUMMARY,
+        .timestamp_us = timestamp_us - 1000000,
+        .summary = {.count = 100, .min = 0.98f, .max = 1.7f, .mean = 1.0125f, .stddev = 0.0625f},
+    };
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE,
+        .kind = METRIC_KIND_SUMMARY,
+        .timestamp_us = timestamp_us + 8,
+        .summary = {.count = 10, .min = 1200.0f, .max = 1300.0f, .mean = 1250.5f, .stddev = 31.75f},
+    };
+
+    // NaN and infinity have no JSON number, both formats carry them as null.
+    metrics[count++] = (metric_t){.metric_type = METRIC_TYPE_ACCELEROMETER_ROTATION_X, .kind = METRIC_KIND_SAMPLE, .timestamp_us = timestamp_us + 9, .float_value = NAN};
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_ACCELEROMETER_SAMPLE,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = timestamp_us + 10,
+        .accelerometer_sample = {INFINITY, -INFINITY, NAN, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+    };
+    metrics[count++] = (metric_t){
+        .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y,
+        .kind = METRIC_KIND_SUMMARY,
+        .timestamp_us = timestamp_us + 11,
+        .summary = {.count = 0, .min = INFINITY, .max = -INFINITY, .mean = NAN, .stddev = NAN},
+    };
+    return count;
+}
+
+static int dump(metrics_serializer_format_t format, const metric_t *metrics, size_t count, const char *path)
+{
+    static char buffer[DUMP_PAYLOAD_SIZE];
+    metrics_serializer_t serializer;
+
+    metrics_serializer_init(&serializer, format, buffer, sizeof(buffer));
+    metrics_serializer_begin(&serializer, DUMP_WALL_CLOCK_OFFSET_US);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (metrics_serializer_append(&serializer, &metrics[i]) != ESP_OK)
+        {
+            fprintf(stderr, "metric %zu does not fit\n", i);
+            return 1;
+        }
+    }
+    metrics_serializer_end(&serializer);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    size_t written = fwrite(serializer.buffer, 1, serializer.length, file);
+    fclose(file);
+    return written == serializer.length ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <json output> <binary output>\n", argv[0]);
+        return 2;
+    }
+
+    metric_t metrics[32];
+    size_t count = build_batch(metrics);
+
+    if (dump(METRICS_SERIALIZER_FORMAT_JSON, metrics, count, argv[1]) != 0)
+    {
+        return 1;
+    }
+    return dump(METRICS_SERIALIZER_FORMAT_BINARY, metrics, count, argv[2]);
+}
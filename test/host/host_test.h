@@ -0,0 +1,19 @@
+#pragma once
+
+/* Minimal assertions for the host tests, a failed check is reported and makes the test exit with 1. */
+
+#include <stdio.h>
+
+static int host_test_failures;
+
+#define CHECK(condition)                                                         \
+    do                                                                           \
+    {                                                                            \
+        if (!(condition))                                                        \
+        {                                                                        \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            host_test_failures++;                                                \
+        }                                                                        \
+    } while (0)
+
+#define HOST_TEST_RESULT() (host_test_failures == 0 ? 0 : 1)
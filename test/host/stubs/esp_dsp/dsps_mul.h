@@ -0,0 +1,7 @@
+#pragma once
+
+/* Host build shim of the esp-dsp multiply kernel with the semantics of its ANSI C reference. */
+
+#include "esp_err.h"
+
+esp_err_t dsps_mul_f32(const float *input1, const float *input2, float *output, int len, int step1, int step2, int step_out);
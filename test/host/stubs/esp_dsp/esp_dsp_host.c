@@ -0,0 +1,30 @@
+#include "dsps_add.h"
+#include "dsps_mul.h"
+
+#include <stddef.h>
+
+esp_err_t dsps_mul_f32(const float *input1, const float *input2, float *output, int len, int step1, int step2, int step_out)
+{
+    if (input1 == NULL || input2 == NULL || output == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < len; i++)
+    {
+        output[i * step_out] = input1[i * step1] * input2[i * step2];
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_add_f32(const float *input1, const float *input2, float *output, int len, int step1, int step2, int step_out)
+{
+    if (input1 == NULL || input2 == NULL || output == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < len; i++)
+    {
+        output[i * step_out] = input1[i * step1] + input2[i * step2];
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+/*
+ * Host build shim of the ESP-IDF log macros. Errors and warnings go to stderr, the rest is dropped
+ * unevaluated, but still checked against its format and counted as a use of its arguments.
+ */
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOG_DROPPED(tag, format, ...) ((void)(tag), (void)sizeof(printf(format, ##__VA_ARGS__)))
+#define ESP_LOGI(tag, format, ...) ESP_LOG_DROPPED(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_DROPPED(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_DROPPED(tag, format, ##__VA_ARGS__)
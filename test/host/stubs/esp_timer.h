@@ -0,0 +1,7 @@
+#pragma once
+
+/* Host build shim of esp_timer, backed by CLOCK_MONOTONIC. */
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
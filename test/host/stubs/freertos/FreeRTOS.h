@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * Host build shim of the FreeRTOS kernel on top of pthreads.
+ *
+ * Critical sections are a recursive mutex, so nested sections of one thread
+ * work as on the ESP32. Ticks are milliseconds of CLOCK_MONOTONIC. The cost
+ * of these primitives differs from the ESP32 port, benchmarks built on the
+ * shim compare designs, not absolute timings on the device.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portNUM_PROCESSORS 2
+
+typedef pthread_mutex_t portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+#define taskENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define taskEXIT_CRITICAL(mux) pthread_mutex_unlock(mux)
+#define taskENTER_CRITICAL_ISR(mux) pthread_mutex_lock(mux)
+#define taskEXIT_CRITICAL_ISR(mux) pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(mux)
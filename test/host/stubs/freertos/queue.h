@@ -0,0 +1,36 @@
+#pragma once
+
+/* Host build shim of FreeRTOS queues, a mutex protected ring of item copies like the kernel's. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint8_t *storage;
+    size_t length;
+    size_t item_size;
+    size_t head;
+    size_t count;
+    bool allocated;
+} StaticQueue_t;
+
+typedef struct host_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t timeout);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t timeout);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t timeout);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+#define xQueueSend(queue, item, timeout) xQueueSendToBack(queue, item, timeout)
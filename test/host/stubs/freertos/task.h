@@ -0,0 +1,25 @@
+#pragma once
+
+/* Host build shim of FreeRTOS tasks, every task is a detached pthread. */
+
+#include <sched.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef pthread_t *TaskHandle_t;
+
+typedef struct
+{
+    pthread_t thread;
+} StaticTask_t;
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t handler, const char *name, uint32_t stack_size, void *parameter, UBaseType_t priority, StackType_t *stack, StaticTask_t *buffer,
+                                           BaseType_t core_id);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake_time, TickType_t period);
+
+#define taskYIELD() sched_yield()
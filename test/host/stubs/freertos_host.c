@@ -0,0 +1,249 @@
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+/* Waits until the condition holds or the timeout passes, with the queue locked. */
+static bool queue_wait(QueueHandle_t queue, bool (*ready)(QueueHandle_t), TickType_t timeout)
+{
+    const struct timespec deadline = deadline_after(timeout);
+    while (!ready(queue))
+    {
+        if (timeout == 0)
+        {
+            return false;
+        }
+        if (timeout == portMAX_DELAY)
+        {
+            pthread_cond_wait(&queue->changed, &queue->lock);
+        }
+        else if (pthread_cond_timedwait(&queue->changed, &queue->lock, &deadline) == ETIMEDOUT)
+        {
+            return ready(queue);
+        }
+    }
+    return true;
+}
+
+static bool queue_has_space(QueueHandle_t queue) { return queue->count < queue->length; }
+
+static bool queue_has_items(QueueHandle_t queue) { return queue->count > 0; }
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer)
+{
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_mutex_init(&buffer->lock, NULL);
+    pthread_cond_init(&buffer->changed, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    buffer->storage = storage;
+    buffer->length = length;
+    buffer->item_size = item_size;
+    buffer->head = 0;
+    buffer->count = 0;
+    buffer->allocated = false;
+    return buffer;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    StaticQueue_t *buffer = malloc(sizeof(*buffer));
+    uint8_t *storage = malloc((size_t)length * item_size);
+    if (buffer == NULL || storage == NULL)
+    {
+        free(buffer);
+        free(storage);
+        return NULL;
+    }
+
+    QueueHandle_t queue = xQueueCreateStatic(length, item_size, storage, buffer);
+    queue->allocated = true;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    pthread_cond_destroy(&queue->changed);
+    pthread_mutex_destroy(&queue->lock);
+    if (queue->allocated)
+    {
+        free(queue->storage);
+        free(queue);
+    }
+}
+
+static BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t timeout, bool front)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (!queue_wait(queue, queue_has_space, timeout))
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return pdFALSE;
+    }
+
+    size_t slot;
+    if (front)
+    {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    }
+    else
+    {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    memcpy(&queue->storage[slot * queue->item_size], item, queue->item_size);
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t timeout) { return queue_send(queue, item, timeout, false); }
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t timeout) { return queue_send(queue, item, timeout, true); }
+
+static BaseType_t queue_receive(QueueHandle_t queue, void *item, TickType_t timeout, bool remove)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (!queue_wait(queue, queue_has_items, timeout))
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return pdFALSE;
+    }
+
+    memcpy(item, &queue->storage[queue->head * queue->item_size], queue->item_size);
+    if (remove)
+    {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout) { return queue_receive(queue, item, timeout, true); }
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t timeout) { return queue_receive(queue, item, timeout, false); }
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    const size_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return (UBaseType_t)count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    const size_t spaces = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return (UBaseType_t)spaces;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+typedef struct
+{
+    TaskFunction_t handler;
+    void *parameter;
+} task_start_t;
+
+static void *task_entry(void *argument)
+{
+    task_start_t start = *(task_start_t *)argument;
+    free(argument);
+    start.handler(start.parameter);
+    return NULL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t handler, const char *name, uint32_t stack_size, void *parameter, UBaseType_t priority, StackType_t *stack, StaticTask_t *buffer,
+                                           BaseType_t core_id)
+{
+    (void)name;
+    (void)stack_size;
+    (void)priority;
+    (void)stack;
+    (void)core_id;
+
+    task_start_t *start = malloc(sizeof(*start));
+    if (start == NULL)
+    {
+        return NULL;
+    }
+    start->handler = handler;
+    start->parameter = parameter;
+    if (pthread_create(&buffer->thread, NULL, task_entry, start) != 0)
+    {
+        free(start);
+        return NULL;
+    }
+    pthread_detach(buffer->thread);
+    return &buffer->thread;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    // A pthread stack is not watermarked.
+    (void)task;
+    return 0;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)((uint64_t)now.tv_sec * 1000u + (uint64_t)now.tv_nsec / 1000000u);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    const struct timespec duration = {
+        .tv_sec = ticks / 1000,
+        .tv_nsec = (long)(ticks % 1000) * 1000000L,
+    };
+    nanosleep(&duration, NULL);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake_time, TickType_t period)
+{
+    const TickType_t wake_time = *previous_wake_time + period;
+    const TickType_t now = xTaskGetTickCount();
+    *previous_wake_time = wake_time;
+    if ((int32_t)(wake_time - now) <= 0)
+    {
+        return pdFALSE;
+    }
+    vTaskDelay(wake_time - now);
+    return pdTRUE;
+}
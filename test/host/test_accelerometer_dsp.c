@@ -0,0 +1,163 @@
+/*
+ * Numerical equivalence of the accelerometer DSP kernels with the per sample
+ * sqrt(pow()) math they replaced.
+ *
+ * The old code computed the magnitude of every reading as
+ * sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2)) on the scaled readings and
+ * compared it against the trigger thresholds. The kernels square in integer
+ * or float arithmetic and compare squared values, which must give the same
+ * magnitudes to float precision and the same threshold decisions.
+ *
+ * The test is built twice, with the portable kernels and with the esp-dsp
+ * path on top of host versions of dsps_mul_f32() and dsps_add_f32().
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "accelerometer_dsp.h"
+#include "host_test.h"
+
+#define TEST_SAMPLE_COUNT 100003
+#define TEST_ACCELERATION_LSB_PER_G 16384.0f
+#define TEST_ROTATION_LSB_PER_DPS 131.0f
+#define TEST_MAX_RELATIVE_ERROR 4e-7
+
+static int16_t raw[6][TEST_SAMPLE_COUNT];
+static float scaled[6][TEST_SAMPLE_COUNT];
+static float squared_f32[TEST_SAMPLE_COUNT];
+static uint32_t squared_s16[TEST_SAMPLE_COUNT];
+
+static float vec3_sum(float x, float y, float z) { return sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2)); }
+
+static void generate_readings(void)
+{
+    srand(1);
+    for (size_t i = 0; i < TEST_SAMPLE_COUNT; i++)
+    {
+        for (size_t axis = 0; axis < 6; axis++)
+        {
+            raw[axis][i] = (int16_t)(rand() % 65536 - 32768);
+        }
+    }
+    /* The extremes of the sensor range. */
+    for (size_t axis = 0; axis < 6; axis++)
+    {
+        raw[axis][0] = INT16_MIN;
+        raw[axis][1] = INT16_MAX;
+        raw[axis][2] = 0;
+    }
+
+    for (size_t i = 0; i < TEST_SAMPLE_COUNT; i++)
+    {
+        for (size_t axis = 0; axis < 6; axis++)
+        {
+            scaled[axis][i] = raw[axis][i] * (1.0f / (axis < 3 ? TEST_ACCELERATION_LSB_PER_G : TEST_ROTATION_LSB_PER_DPS));
+        }
+    }
+}
+
+/* Compares the magnitudes of one sensor against sqrt(pow()) and returns the worst relative error. */
+static double check_magnitudes(size_t first_axis, float scale_per_lsb, const float *thresholds, size_t threshold_count)
+{
+    accelerometer_dsp_squared_magnitude_f32(scaled[first_axis], scaled[first_axis + 1], scaled[first_axis + 2], squared_f32, TEST_SAMPLE_COUNT);
+    accelerometer_dsp_squared_magnitude_s16(raw[first_axis], raw[first_axis + 1], raw[first_axis + 2], squared_s16, TEST_SAMPLE_COUNT);
+
+    double max_relative_error = 0;
+    size_t decision_mismatches = 0;
+    for (size_t i = 0; i < TEST_SAMPLE_COUNT; i++)
+    {
+        const int64_t x = raw[first_axis][i];
+        const int64_t y = raw[first_axis + 1][i];
+        const int64_t z = raw[first_axis + 2][i];
+        CHECK(squared_s16[i] == (uint64_t)(x * x + y * y + z * z));
+
+        const float reference = vec3_sum(scaled[first_axis][i], scaled[first_axis + 1][i], scaled[first_axis + 2][i]);
+        const float from_f32 = sqrtf(squared_f32[i]);
+        const float from_s16 = sqrtf(squared_s16[i] * (scale_per_lsb * scale_per_lsb));
+        if (reference > 0)
+        {
+            max_relative_error = fmax(max_relative_error, fabs(from_f32 - reference) / reference);
+            max_relative_error = fmax(max_relative_error, fabs(from_s16 - reference) / reference);
+        }
+        else
+        {
+            CHECK(from_f32 == 0 && from_s16 == 0);
+        }
+
+        for (size_t t = 0; t < threshold_count; t++)
+        {
+            const float threshold_squared = thresholds[t] * thresholds[t];
+            decision_mismatches += (reference > thresholds[t]) != (squared_f32[i] > threshold_squared);
+            decision_mismatches += (reference > thresholds[t]) != (squared_s16[i] * (scale_per_lsb * scale_per_lsb) > threshold_squared);
+        }
+    }
+
+    CHECK(max_relative_error <= TEST_MAX_RELATIVE_ERROR);
+    CHECK(decision_mismatches == 0);
+    return max_relative_error;
+}
+
+static void test_gravity_filter(void)
+{
+    /* Gravity on z with a small vibration on x, filtered in blocks of different sizes. */
+    static float x[2][4096];
+    static float y[2][4096];
+    static float z[2][4096];
+    for (size_t i = 0; i < 4096; i++)
+    {
+        for (size_t copy = 0; copy < 2; copy++)
+        {
+            x[copy][i] = 0.01f * sinf((float)i * 0.5f);
+            y[copy][i] = 0;
+            z[copy][i] = 1.0f;
+        }
+    }
+
+    accelerometer_dsp_gravity_filter_t filters[2];
+    accelerometer_dsp_gravity_filter_init(&filters[0], 0.02f);
+    accelerometer_dsp_gravity_filter_init(&filters[1], 0.02f);
+    for (size_t offset = 0; offset < 4096; offset += 32)
+    {
+        accelerometer_dsp_remove_gravity_f32(&filters[0], &x[0][offset], &y[0][offset], &z[0][offset], 32);
+    }
+    for (size_t offset = 0; offset < 4096; offset += 7)
+    {
+        const size_t count = 4096 - offset < 7 ? 4096 - offset : 7;
+        accelerometer_dsp_remove_gravity_f32(&filters[1], &x[1][offset], &y[1][offset], &z[1][offset], count);
+    }
+
+    /* The output starts at zero, keeps the vibration and does not depend on the block size. */
+    CHECK(x[0][0] == 0 && z[0][0] == 0);
+    CHECK(fabsf(z[0][4095]) < 1e-6f);
+    float peak = 0;
+    for (size_t i = 2048; i < 4096; i++)
+    {
+        peak = fmaxf(peak, fabsf(x[0][i]));
+        CHECK(x[0][i] == x[1][i] && z[0][i] == z[1][i]);
+    }
+    CHECK(peak > 0.009f && peak < 0.011f);
+}
+
+static void test_count_above(void)
+{
+    const float values[] = {0.0f, 1.0f, 1.0000001f, 2.0f, -3.0f};
+    CHECK(accelerometer_dsp_count_above_f32(values, 5, 1.0f) == 2);
+    CHECK(accelerometer_dsp_count_above_f32(values, 0, 1.0f) == 0);
+}
+
+int main(void)
+{
+    generate_readings();
+
+    /* Trigger thresholds of the old per sample code, 1.7 g and 80 dps, and a few around them. */
+    const float acceleration_thresholds[] = {0.04f, 1.0f, 1.7f, 2.5f};
+    const float rotation_thresholds[] = {10.0f, 80.0f, 200.0f};
+    const double acceleration_error = check_magnitudes(0, 1.0f / TEST_ACCELERATION_LSB_PER_G, acceleration_thresholds, 4);
+    const double rotation_error = check_magnitudes(3, 1.0f / TEST_ROTATION_LSB_PER_DPS, rotation_thresholds, 3);
+    test_gravity_filter();
+    test_count_above();
+
+    printf("%d readings, worst relative error against sqrt(pow()): acceleration %.3g, rotation %.3g\n", TEST_SAMPLE_COUNT, acceleration_error, rotation_error);
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,165 @@
+/*
+ * Replays a knock and a rotation through the accelerometer monitor with the
+ * tuning of accelerometer.c, the way the accelerometer task feeds it from the
+ * FIFO, and checks that putting the gyro on standby while quiet changes no
+ * trigger.
+ *
+ * The trace is 1 kHz acceleration in g with gravity on z and +-8 mg of
+ * uniform noise. The simulated gyro reports garbage while on standby and
+ * until it has settled after waking, like the FIFO does.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "accelerometer_monitor.h"
+#include "host_test.h"
+
+#define TEST_SAMPLE_RATE_HZ 1000
+#define TEST_BLOCK_SAMPLES 10 /* FIFO watermark of accelerometer.c. */
+#define TEST_TRACE_MS 20000
+#define TEST_KNOCK_MS 8000
+#define TEST_ROTATION_MS 11000
+#define TEST_ROTATION_DURATION_MS 100
+#define TEST_ROTATION_DPS 200.0f
+#define TEST_GARBAGE_DPS 500.0f
+#define TEST_QUIET_MS 5000
+#define TEST_MAX_TRIGGERS 8
+#define TEST_MAX_STANDBYS 8
+
+static const accelerometer_monitor_config_t base_config = {
+    .gravity_filter_alpha = 0.02f,
+    .rotation_threshold_dps = 80.0f,
+    .quiet_level = 0.25f,
+    .quiet_us = TEST_QUIET_MS * 1000LL,
+    .gyro_settle_us = 35 * 1000LL,
+    .vibration = {
+        .sample_rate_hz = TEST_SAMPLE_RATE_HZ,
+        .window_samples = 256,
+        .crossing_deadband_g = 0.02f,
+        .knock_peak_to_peak_g = 0.5f,
+        .knock_jerk_g_per_s = 50.0f,
+        .knock_crest_factor = 6.0f,
+        .sustained_rms_g = 0.05f,
+        .sustained_crossing_rate_hz = 5.0f,
+    },
+    .trigger = {
+        .trigger_threshold = 1.0f,
+        .release_threshold = 0.8f * 0.8f,
+        .debounce_us = 30 * 1000LL,
+        .hold_off_us = 2000 * 1000LL,
+    },
+};
+
+typedef struct
+{
+    int64_t triggers_us[TEST_MAX_TRIGGERS];
+    size_t trigger_count;
+    int64_t standbys_us[TEST_MAX_STANDBYS];
+    size_t standby_count;
+    int64_t first_wakeup_us;
+} replay_t;
+
+static float noise(void) { return (float)(rand() % 2001 - 1000) / 1000.0f * 0.008f; }
+
+/* A knuckle on the enclosure: a 1.5 g swing on x ringing down within 10 ms. */
+static float knock(int ms)
+{
+    const int since_ms = ms - TEST_KNOCK_MS;
+    return since_ms >= 0 && since_ms < 10 ? 1.5f * expf(-(float)since_ms / 3.0f) * cosf((float)since_ms * 1.5f) : 0;
+}
+
+static replay_t replay(bool standby_enabled)
+{
+    accelerometer_monitor_config_t config = base_config;
+    config.quiet_us = standby_enabled ? base_config.quiet_us : 0;
+    accelerometer_monitor_t monitor;
+    accelerometer_monitor_init(&monitor, &config, 0);
+
+    // What the sensor does, the monitor only learns it from the task.
+    bool gyro_standby = false;
+    int64_t gyro_settled_us = 0;
+
+    replay_t result = {.first_wakeup_us = -1};
+    float x[TEST_BLOCK_SAMPLES], y[TEST_BLOCK_SAMPLES], z[TEST_BLOCK_SAMPLES], rotation_squared[TEST_BLOCK_SAMPLES];
+    int64_t timestamps_us[TEST_BLOCK_SAMPLES];
+    int64_t triggers_us[TEST_BLOCK_SAMPLES];
+    srand(18);
+    for (int block_start = 0; block_start < TEST_TRACE_MS; block_start += TEST_BLOCK_SAMPLES)
+    {
+        for (int i = 0; i < TEST_BLOCK_SAMPLES; i++)
+        {
+            const int ms = block_start + i;
+            timestamps_us[i] = (int64_t)ms * 1000;
+            x[i] = noise() + knock(ms);
+            y[i] = noise();
+            z[i] = 1.0f + noise();
+
+            float rotation = noise() * 100;
+            if (ms >= TEST_ROTATION_MS && ms < TEST_ROTATION_MS + TEST_ROTATION_DURATION_MS)
+            {
+                rotation += TEST_ROTATION_DPS;
+            }
+            if (gyro_standby || timestamps_us[i] < gyro_settled_us)
+            {
+                rotation = TEST_GARBAGE_DPS;
+            }
+            rotation_squared[i] = rotation * rotation;
+        }
+
+        const size_t trigger_count = accelerometer_monitor_process(&monitor, x, y, z, rotation_squared, timestamps_us, TEST_BLOCK_SAMPLES, triggers_us);
+        for (size_t i = 0; i < trigger_count && result.trigger_count < TEST_MAX_TRIGGERS; i++)
+        {
+            result.triggers_us[result.trigger_count++] = triggers_us[i];
+        }
+
+        // The task decides on the gyro after every burst.
+        const int64_t now_us = timestamps_us[TEST_BLOCK_SAMPLES - 1];
+        const bool standby = !accelerometer_monitor_gyro_needed(&monitor, now_us);
+        if (standby != monitor.gyro_standby)
+        {
+            gyro_standby = standby;
+            gyro_settled_us = now_us + config.gyro_settle_us;
+            accelerometer_monitor_set_gyro_standby(&monitor, standby, now_us);
+            if (standby && result.standby_count < TEST_MAX_STANDBYS)
+            {
+                result.standbys_us[result.standby_count++] = now_us;
+            }
+            if (!standby && result.first_wakeup_us < 0)
+            {
+                result.first_wakeup_us = now_us;
+            }
+        }
+    }
+    return result;
+}
+
+int main(void)
+{
+    const replay_t reference = replay(false);
+    const replay_t result = replay(true);
+    printf("gyro always on: %zu triggers, first at %lld us\n", reference.trigger_count, reference.trigger_count > 0 ? (long long)reference.triggers_us[0] : -1LL);
+    printf("gyro standby:   %zu triggers, first at %lld us, %zu standbys, first at %lld us, woken at %lld us\n", result.trigger_count, result.trigger_count > 0 ? (long long)result.triggers_us[0] : -1LL,
+           result.standby_count, result.standby_count > 0 ? (long long)result.standbys_us[0] : -1LL, (long long)result.first_wakeup_us);
+
+    // The knock and the rotation trigger once each, and the garbage of the gyro on standby never does.
+    CHECK(reference.standby_count == 0);
+    CHECK(reference.trigger_count == 2);
+    CHECK(result.trigger_count == reference.trigger_count);
+    for (size_t i = 0; i < result.trigger_count && i < reference.trigger_count; i++)
+    {
+        CHECK(result.triggers_us[i] == reference.triggers_us[i]);
+    }
+
+    // Caught within the debounce and a burst of the start of the knock.
+    const int64_t knock_us = TEST_KNOCK_MS * 1000LL;
+    CHECK(result.trigger_count > 0 && result.triggers_us[0] >= knock_us && result.triggers_us[0] - knock_us <= base_config.trigger.debounce_us + TEST_BLOCK_SAMPLES * 1000);
+
+    // On standby after the quiet time, woken by the knock itself, and back on standby after the rotation.
+    CHECK(result.standby_count == 2);
+    CHECK(result.standbys_us[0] >= base_config.quiet_us && result.standbys_us[0] <= base_config.quiet_us + TEST_BLOCK_SAMPLES * 1000);
+    CHECK(result.first_wakeup_us >= knock_us && result.first_wakeup_us <= knock_us + TEST_BLOCK_SAMPLES * 1000);
+    CHECK(result.standbys_us[1] > (TEST_ROTATION_MS + TEST_QUIET_MS) * 1000LL);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,198 @@
+/*
+ * Frames of the RFID reader fed to the card frame parser in every chunking,
+ * cut off part way, and buried in line noise.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "card_frame_parser.h"
+#include "host_test.h"
+
+#define TEST_STREAM_SIZE 8192
+#define TEST_MAX_FRAMES 512
+#define TEST_NOISY_ROUNDS 100
+
+static const char *const ids[] = {"01004B1DA2", "0A1B2C3D4E", "FFFFFFFFFF", "abcdef0123"};
+#define TEST_ID_COUNT (sizeof(ids) / sizeof(ids[0]))
+
+typedef struct
+{
+    uint8_t bytes[TEST_STREAM_SIZE];
+    size_t length;
+    size_t expected[TEST_MAX_FRAMES]; /* Index into ids of every valid frame, in order. */
+    size_t expected_count;
+} stream_t;
+
+static stream_t stream;
+
+static void append(const void *bytes, size_t length)
+{
+    if (stream.length + length <= TEST_STREAM_SIZE)
+    {
+        memcpy(&stream.bytes[stream.length], bytes, length);
+        stream.length += length;
+    }
+}
+
+static void append_byte(uint8_t byte) { append(&byte, 1); }
+
+static void append_frame(size_t id)
+{
+    append_byte(CARD_FRAME_PARSER_START);
+    append(ids[id], CARD_FRAME_PARSER_ID_LENGTH);
+    append_byte(CARD_FRAME_PARSER_END);
+    stream.expected[stream.expected_count++] = id;
+}
+
+/**
+ * @brief Feeds the stream in chunks of the given size and checks the frames decoded.
+ *
+ * @param chunk_size Bytes per chunk, 0 for random chunks of 1 to 64 bytes.
+ *
+ * @return Number of frames that were not decoded as expected.
+ */
+static size_t feed(size_t chunk_size)
+{
+    card_frame_parser_t parser;
+    card_frame_parser_init(&parser);
+
+    size_t decoded = 0;
+    size_t errors = 0;
+    size_t offset = 0;
+    while (offset < stream.length)
+    {
+        size_t chunk = chunk_size != 0 ? chunk_size : 1 + (size_t)rand() % 64;
+        if (chunk > stream.length - offset)
+        {
+            chunk = stream.length - offset;
+        }
+        for (size_t i = 0; i < chunk; i++)
+        {
+            if (card_frame_parser_push(&parser, stream.bytes[offset + i]))
+            {
+                errors += decoded >= stream.expected_count || strcmp(parser.id, ids[stream.expected[decoded]]) != 0;
+                decoded++;
+            }
+        }
+        offset += chunk;
+    }
+
+    errors += decoded > stream.expected_count ? decoded - stream.expected_count : stream.expected_count - decoded;
+    errors += parser.frames != decoded;
+    return errors;
+}
+
+static void test_chunked(void)
+{
+    memset(&stream, 0, sizeof(stream));
+    for (size_t i = 0; i < 64; i++)
+    {
+        append_frame(i % TEST_ID_COUNT);
+    }
+
+    // Every chunk size up to the whole stream, a frame is split at every possible byte on the way.
+    size_t errors = 0;
+    for (size_t chunk_size = 1; chunk_size <= stream.length; chunk_size++)
+    {
+        errors += feed(chunk_size);
+    }
+    for (size_t round = 0; round < 100; round++)
+    {
+        errors += feed(0);
+    }
+    CHECK(errors == 0);
+}
+
+static void test_partial(void)
+{
+    card_frame_parser_t parser;
+    card_frame_parser_init(&parser);
+
+    // A frame cut off by the next start byte is dropped, the next frame still counts.
+    const char cut_off[] = "\n01004\n0A1B2C3D4E\r";
+    size_t decoded = 0;
+    for (size_t i = 0; i < sizeof(cut_off) - 1; i++)
+    {
+        decoded += card_frame_parser_push(&parser, (uint8_t)cut_off[i]);
+    }
+    CHECK(decoded == 1 && strcmp(parser.id, "0A1B2C3D4E") == 0);
+    CHECK(parser.rejected == 1);
+
+    // Too few or too many digits, and an end byte outside a frame.
+    const char *const invalid[] = {"\n01004B1DA\r", "\n01004B1DA2F\r", "\r01004B1DA2\r", "\n\r"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        for (const char *byte = invalid[i]; *byte != '\0'; byte++)
+        {
+            CHECK(!card_frame_parser_push(&parser, (uint8_t)*byte));
+        }
+    }
+    CHECK(parser.frames == 1);
+    CHECK(strcmp(parser.id, "0A1B2C3D4E") == 0);
+
+    // A reset after lost UART data drops the frame in progress, and the rest of it is ignored.
+    const char before_overflow[] = "\n01004B";
+    const char after_overflow[] = "1DA2\r";
+    for (size_t i = 0; i < sizeof(before_overflow) - 1; i++)
+    {
+        card_frame_parser_push(&parser, (uint8_t)before_overflow[i]);
+    }
+    const uint32_t rejected = parser.rejected;
+    card_frame_parser_reset(&parser);
+    CHECK(parser.rejected == rejected + 1);
+    for (size_t i = 0; i < sizeof(after_overflow) - 1; i++)
+    {
+        CHECK(!card_frame_parser_push(&parser, (uint8_t)after_overflow[i]));
+    }
+    CHECK(parser.frames == 1);
+}
+
+static void test_noisy(void)
+{
+    size_t errors = 0;
+    size_t frames = 0;
+    for (size_t round = 0; round < TEST_NOISY_ROUNDS; round++)
+    {
+        memset(&stream, 0, sizeof(stream));
+        while (stream.length < TEST_STREAM_SIZE - 64 && stream.expected_count < TEST_MAX_FRAMES)
+        {
+            switch (rand() % 4)
+            {
+            case 0:
+                // Line noise, start bytes in it only open frames that the next start byte drops.
+                for (int i = rand() % 16; i > 0; i--)
+                {
+                    append_byte((uint8_t)rand());
+                }
+                break;
+            case 1:
+            {
+                // A frame with one digit hit by noise that is not a hex digit any more.
+                uint8_t frame[CARD_FRAME_PARSER_ID_LENGTH + 2] = {CARD_FRAME_PARSER_START};
+                memcpy(&frame[1], ids[rand() % TEST_ID_COUNT], CARD_FRAME_PARSER_ID_LENGTH);
+                frame[1 + rand() % CARD_FRAME_PARSER_ID_LENGTH] = 'G' + rand() % 20;
+                frame[CARD_FRAME_PARSER_ID_LENGTH + 1] = CARD_FRAME_PARSER_END;
+                append(frame, sizeof(frame));
+                break;
+            }
+            default:
+                append_frame((size_t)rand() % TEST_ID_COUNT);
+                break;
+            }
+        }
+        errors += feed(0);
+        frames += stream.expected_count;
+    }
+    printf("%zu frames in %d noisy streams, %zu decoding errors\n", frames, TEST_NOISY_ROUNDS, errors);
+    CHECK(errors == 0);
+}
+
+int main(void)
+{
+    srand(25);
+    test_chunked();
+    test_partial();
+    test_noisy();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,120 @@
+/*
+ * Replays the time of flight traces of test/host/traces through the
+ * background model, trigger detector and deadband filter the way
+ * time_of_flight.c publishes the distances of several zones, and checks that
+ * an empty scene stays mostly silent but for the heartbeat, while every walk
+ * through is published from its first sample on.
+ *
+ * Usage: test_deadband_filter <trace directory>
+ */
+
+#include "background_model.h"
+#include "deadband_filter.h"
+#include "host_test.h"
+#include "tof_trace.h"
+#include "trigger_detector.h"
+
+#define TEST_WALKER_MAX_MM 1000.0f /* Walkers of tof_walkthroughs are closer, its wall is further. */
+
+/* Deadband of time_of_flight.c. */
+static const deadband_filter_config_t deadband_config = {
+    .min_deadband = 20,
+    .noise_stddevs = 3.0f,
+    .heartbeat_us = 10000 * 1000LL,
+};
+
+static tof_trace_t trace;
+static bool published[TOF_TRACE_MAX_SAMPLES];
+
+typedef struct
+{
+    size_t published_count;
+    int64_t max_gap_us; /* Longest time between two published samples. */
+} replay_t;
+
+static replay_t replay(void)
+{
+    background_model_t model;
+    trigger_detector_t detector;
+    deadband_filter_t filter;
+    background_model_init(&model, &tof_trace_background_config);
+    trigger_detector_init(&detector, &tof_trace_trigger_config);
+    deadband_filter_init(&filter, &deadband_config);
+
+    replay_t result = {.published_count = 0, .max_gap_us = 0};
+    int64_t last_published_us = 0;
+    for (size_t i = 0; i < trace.sample_count; i++)
+    {
+        const int64_t timestamp_us = (int64_t)i * trace.period_ms * 1000;
+        const float deviation = background_model_update(&model, trace.distances[i]);
+        const bool triggered = trigger_detector_update(&detector, deviation, timestamp_us);
+        published[i] = triggered || deadband_filter_check(&filter, trace.distances[i], background_model_stddev(&model), timestamp_us);
+        if (published[i])
+        {
+            deadband_filter_passed(&filter, trace.distances[i], timestamp_us);
+            if (result.published_count++ > 0 && timestamp_us - last_published_us > result.max_gap_us)
+            {
+                result.max_gap_us = timestamp_us - last_published_us;
+            }
+            last_published_us = timestamp_us;
+        }
+    }
+    return result;
+}
+
+static void test_empty(const char *directory, const char *name)
+{
+    if (!tof_trace_load(&trace, directory, name))
+    {
+        CHECK(false);
+        return;
+    }
+
+    const replay_t result = replay();
+    const double reduction = 1.0 - (double)result.published_count / (double)trace.sample_count;
+    printf("%-24s %6zu of %6zu samples published, %.1f %% fewer, longest silence %.1f s\n", name, result.published_count, trace.sample_count, reduction * 100, (double)result.max_gap_us / 1e6);
+    CHECK(reduction > 0.9);
+    // The heartbeat fires on time, a sample period never misses it.
+    CHECK(result.max_gap_us == deadband_config.heartbeat_us);
+}
+
+static void test_walkthroughs(const char *directory)
+{
+    if (!tof_trace_load(&trace, directory, "tof_walkthroughs"))
+    {
+        CHECK(false);
+        return;
+    }
+
+    const replay_t result = replay();
+    unsigned walkthroughs = 0;
+    unsigned missed = 0;
+    for (size_t i = 1; i < trace.sample_count; i++)
+    {
+        if (trace.distances[i] < TEST_WALKER_MAX_MM && trace.distances[i - 1] >= TEST_WALKER_MAX_MM)
+        {
+            walkthroughs++;
+            missed += !published[i];
+        }
+    }
+    printf("%-24s %6zu of %6zu samples published, %u of %u walk throughs published from their first sample\n", "tof_walkthroughs", result.published_count, trace.sample_count, walkthroughs - missed, walkthroughs);
+    CHECK(walkthroughs == trace.events);
+    CHECK(missed == 0);
+    CHECK(result.max_gap_us <= deadband_config.heartbeat_us);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <trace directory>\n", argv[0]);
+        return 2;
+    }
+
+    test_empty(argv[1], "tof_empty_noise5");
+    test_empty(argv[1], "tof_empty_noise10");
+    test_empty(argv[1], "tof_empty_noise20");
+    test_empty(argv[1], "tof_empty_glitches");
+    test_walkthroughs(argv[1]);
+    return HOST_TEST_RESULT();
+}
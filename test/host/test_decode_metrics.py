@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Round trip of tools/decode_metrics.py against the firmware serializer.
+
+Runs dump_metrics to serialize one batch holding every metric type in both
+wire formats, decodes both payloads and checks they carry the same document.
+Floats go through %.7g in JSON and through IEEE 754 single precision in the
+binary format, so they are compared with a relative tolerance.
+
+Usage: test_decode_metrics.py <dump_metrics executable>
+"""
+
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools"))
+
+import decode_metrics  # noqa: E402
+
+FLOAT_TOLERANCE = 1e-6
+
+
+def compare(path, expected, actual, failures):
+    if isinstance(expected, dict) and isinstance(actual, dict):
+        if expected.keys() != actual.keys():
+            failures.append("%s: keys %s != %s" % (path, sorted(expected), sorted(actual)))
+            return
+        for key in expected:
+            compare("%s.%s" % (path, key), expected[key], actual[key], failures)
+    elif isinstance(expected, list) and isinstance(actual, list):
+        if len(expected) != len(actual):
+            failures.append("%s: %d != %d entries" % (path, len(expected), len(actual)))
+            return
+        for index, (left, right) in enumerate(zip(expected, actual)):
+            compare("%s[%d]" % (path, index), left, right, failures)
+    elif isinstance(expected, float) or isinstance(actual, float):
+        if not math.isclose(expected, actual, rel_tol=FLOAT_TOLERANCE, abs_tol=FLOAT_TOLERANCE):
+            failures.append("%s: %r != %r" % (path, expected, actual))
+    elif type(expected) is not type(actual) or expected != actual:
+        failures.append("%s: %r != %r" % (path, expected, actual))
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__.splitlines()[-1], file=sys.stderr)
+        return 2
+
+    with tempfile.TemporaryDirectory() as directory:
+        json_path = os.path.join(directory, "metrics.json")
+        binary_path = os.path.join(directory, "metrics.bin")
+        subprocess.run([sys.argv[1], json_path, binary_path], check=True)
+        with open(json_path, "rb") as file:
+            json_payload = file.read()
+        with open(binary_path, "rb") as file:
+            binary_payload = file.read()
+
+    json_document = decode_metrics.decode("application/json", json_payload)
+    binary_document = decode_metrics.decode("application/octet-stream", binary_payload)
+
+    failures = []
+    compare("payload", json_document, binary_document, failures)
+
+    decoded_types = {metric["metric_type"] for metric in binary_document["metrics"]}
+    for metric_type in decode_metrics.METRIC_TYPES:
+        if metric_type not in decoded_types:
+            failures.append("%s is not covered by dump_metrics" % metric_type)
+
+    for truncated in (binary_payload[:10], binary_payload[:-1]):
+        try:
+            decode_metrics.decode_binary(truncated)
+            failures.append("truncated payload of %d bytes decoded" % len(truncated))
+        except decode_metrics.DecodeError:
+            pass
+
+    count = len(binary_document["metrics"])
+    print("%d metrics: JSON %d bytes (%.1f B/metric), binary %d bytes (%.1f B/metric), %.1fx smaller"
+          % (count, len(json_payload), len(json_payload) / count, len(binary_payload), len(binary_payload) / count,
+             len(json_payload) / len(binary_payload)))
+    for failure in failures:
+        print(failure, file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,86 @@
+/*
+ * Delivery policies of the event bus, on the queues of the FreeRTOS host shim.
+ *
+ * The orchestrator subscribes to security events with
+ * EVENT_BUS_POLICY_COALESCE, which must merge repeated sensor triggers
+ * while every card read, and so every arm and disarm, gets through.
+ */
+
+#include <string.h>
+
+#include "event_bus.h"
+#include "host_test.h"
+#include "queue.h"
+
+static message_t make_message(component_t component, message_type_t type)
+{
+    return (message_t){
+        .component = component,
+        .type = type,
+    };
+}
+
+static size_t drain(event_bus_subscription_t *subscription, message_t *messages, size_t max_count)
+{
+    size_t count = 0;
+    while (count < max_count && event_bus_receive(subscription, &messages[count], 0))
+    {
+        count++;
+    }
+    return count;
+}
+
+static void test_coalesce_only_triggers(void)
+{
+    event_bus_subscription_t *subscription;
+    CHECK(event_bus_init() == ESP_OK);
+    CHECK(event_bus_subscribe(EVENT_BUS_TOPIC_SECURITY_EVENTS, APP_RESOURCES_QUEUE_SECURITY_EVENTS, EVENT_BUS_POLICY_COALESCE, &subscription) == ESP_OK);
+
+    /* A burst of triggers from two sensors and arm, disarm, arm from the card reader. */
+    const message_t trigger_accelerometer = make_message(COMPONENT_ACCELEROMETER, MESSAGE_TYPE_SENSOR_TRIGGERED);
+    const message_t trigger_time_of_flight = make_message(COMPONENT_TIME_OF_FLIGHT, MESSAGE_TYPE_SENSOR_TRIGGERED);
+    const message_t card_valid = make_message(COMPONENT_CARD_READER, MESSAGE_TYPE_CARD_READER_CARD_VALID);
+    for (size_t i = 0; i < 10; i++)
+    {
+        CHECK(event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &trigger_accelerometer) == ESP_OK);
+        CHECK(event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &trigger_time_of_flight) == ESP_OK);
+        if (i % 4 == 0)
+        {
+            CHECK(event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &card_valid) == ESP_OK);
+        }
+    }
+
+    message_t messages[16];
+    size_t count = drain(subscription, messages, 16);
+    size_t triggers = 0;
+    size_t card_reads = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        triggers += messages[i].type == MESSAGE_TYPE_SENSOR_TRIGGERED;
+        card_reads += messages[i].type == MESSAGE_TYPE_CARD_READER_CARD_VALID;
+    }
+    CHECK(triggers == 2);
+    CHECK(card_reads == 3);
+
+    /* Once received, a trigger is delivered again. */
+    CHECK(event_bus_publish(EVENT_BUS_TOPIC_SECURITY_EVENTS, &trigger_accelerometer) == ESP_OK);
+    count = drain(subscription, messages, 16);
+    CHECK(count == 1 && messages[0].type == MESSAGE_TYPE_SENSOR_TRIGGERED && messages[0].component == COMPONENT_ACCELEROMETER);
+
+    event_bus_deinit();
+}
+
+static void test_invalid_topic(void)
+{
+    const message_t message = make_message(COMPONENT_CARD_READER, MESSAGE_TYPE_CARD_READER_CARD_VALID);
+    CHECK(event_bus_init() == ESP_OK);
+    CHECK(event_bus_publish(EVENT_BUS_TOPIC_COUNT, &message) == ESP_ERR_INVALID_ARG);
+    event_bus_deinit();
+}
+
+int main(void)
+{
+    test_coalesce_only_triggers();
+    test_invalid_topic();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,59 @@
+/*
+ * Bucket boundaries and percentiles of the log2 histogram shared by the
+ * queue latency and sampling jitter statistics.
+ */
+
+#include "host_test.h"
+#include "log2_histogram.h"
+
+static void test_buckets(void)
+{
+    static atomic_uint_least32_t buckets[LOG2_HISTOGRAM_BUCKET_COUNT];
+    uint32_t counts[LOG2_HISTOGRAM_BUCKET_COUNT];
+
+    // Values below 2 and negative values land in bucket 0, 2^i starts bucket i.
+    const int64_t values[] = {-5, 0, 1, 2, 3, 4, 1023, 1024, (INT64_C(1) << 19) - 1, INT64_C(1) << 19, INT64_MAX};
+    const size_t expected[] = {0, 0, 0, 1, 1, 2, 9, 10, 18, 19, 19};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        log2_histogram_init(buckets);
+        log2_histogram_record(buckets, values[i]);
+        log2_histogram_load(buckets, counts);
+        CHECK(counts[expected[i]] == 1);
+    }
+}
+
+static void test_percentiles(void)
+{
+    static atomic_uint_least32_t buckets[LOG2_HISTOGRAM_BUCKET_COUNT];
+    uint32_t counts[LOG2_HISTOGRAM_BUCKET_COUNT];
+
+    log2_histogram_init(buckets);
+    log2_histogram_load(buckets, counts);
+    CHECK(log2_histogram_percentile(counts, 50) == 0);
+
+    // 90 values of 10, 9 of 100 and one of 10000.
+    for (int i = 0; i < 90; i++)
+    {
+        log2_histogram_record(buckets, 10);
+    }
+    for (int i = 0; i < 9; i++)
+    {
+        log2_histogram_record(buckets, 100);
+    }
+    log2_histogram_record(buckets, 10000);
+    log2_histogram_load(buckets, counts);
+
+    CHECK(log2_histogram_percentile(counts, 50) == 16);
+    CHECK(log2_histogram_percentile(counts, 90) == 16);
+    CHECK(log2_histogram_percentile(counts, 91) == 128);
+    CHECK(log2_histogram_percentile(counts, 99) == 128);
+    CHECK(log2_histogram_percentile(counts, 100) == 16384);
+}
+
+int main(void)
+{
+    test_buckets();
+    test_percentiles();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,233 @@
+/*
+ * Summaries of the metrics aggregator against a double precision reference,
+ * the window reset, running out of channels, and the reduction of one second
+ * of 100 Hz accelerometer samples.
+ *
+ * Built with METRICS_AGGREGATOR_MAX_CHANNELS 8, so the eight axes of an
+ * accelerometer sample fill the table and any other metric type overflows it.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host_test.h"
+#include "metrics_aggregator.h"
+
+#define TEST_MAX_SUMMARIES 16
+#define TEST_SAMPLE_RATE_HZ 100
+#define TEST_WINDOW_START_US 5000000LL
+
+static metric_t summaries[TEST_MAX_SUMMARIES];
+
+static metric_t float_sample(metric_type_t metric_type, float value)
+{
+    return (metric_t){.metric_type = metric_type, .kind = METRIC_KIND_SAMPLE, .float_value = value};
+}
+
+static metric_t distance_sample(uint16_t distance_mm)
+{
+    return (metric_t){.metric_type = METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE, .kind = METRIC_KIND_SAMPLE, .uint16_value = distance_mm};
+}
+
+static metric_t accelerometer_sample(int i)
+{
+    const float base = (float)i;
+    return (metric_t){
+        .metric_type = METRIC_TYPE_ACCELEROMETER_SAMPLE,
+        .kind = METRIC_KIND_SAMPLE,
+        .accelerometer_sample = {base, base + 1000, -base, base * 0.5f, base * 2, base * 3, base * 4, base * 5},
+    };
+}
+
+static const metric_t *find_summary(size_t count, metric_type_t metric_type)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (summaries[i].metric_type == metric_type && summaries[i].kind == METRIC_KIND_SUMMARY)
+        {
+            return &summaries[i];
+        }
+    }
+    return NULL;
+}
+
+static void test_statistics(void)
+{
+    // A 1 g offset with noise and one spike, like the total acceleration of a knock.
+    enum { count = 1000 };
+    static float values[count];
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = 1.0f + (float)(rand() % 2001 - 1000) / 1000.0f * 0.01f;
+        if (i == 637)
+        {
+            values[i] = 3.75f;
+        }
+        if (i == 211)
+        {
+            values[i] = -0.5f;
+        }
+        sum += values[i];
+        const metric_t metric = float_sample(METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL, values[i]);
+        CHECK(metrics_aggregator_add(&metric));
+    }
+    const double mean = sum / count;
+    double squared_sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        squared_sum += (values[i] - mean) * (values[i] - mean);
+    }
+    const double stddev = sqrt(squared_sum / (count - 1));
+
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, TEST_WINDOW_START_US) == 1);
+    const metric_summary_t *summary = &summaries[0].summary;
+    printf("mean %.7g/%.7g stddev %.7g/%.7g\n", summary->mean, mean, summary->stddev, stddev);
+    CHECK(summaries[0].metric_type == METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL);
+    CHECK(summaries[0].kind == METRIC_KIND_SUMMARY);
+    CHECK(summaries[0].timestamp_us == TEST_WINDOW_START_US);
+    CHECK(summary->count == count);
+    // The peaks are kept exactly, the moments to single precision.
+    CHECK(summary->min == -0.5f && summary->max == 3.75f);
+    CHECK(fabs(summary->mean - mean) < 1e-5 * fabs(mean));
+    CHECK(fabs(summary->stddev - stddev) < 1e-4 * stddev);
+
+    // A single sample has no spread, and a distance is aggregated as a float.
+    const metric_t distance = distance_sample(1234);
+    CHECK(metrics_aggregator_add(&distance));
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0) == 1);
+    CHECK(summaries[0].summary.count == 1 && summaries[0].summary.mean == 1234.0f && summaries[0].summary.stddev == 0);
+}
+
+static void test_raw(void)
+{
+    // Events and summaries are not aggregated, and do not open a channel.
+    const metric_t alarm = {.metric_type = METRIC_TYPE_ALARM_TRIGGERED, .kind = METRIC_KIND_SAMPLE, .bool_value = true};
+    const metric_t summary = {.metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_X, .kind = METRIC_KIND_SUMMARY};
+    CHECK(!metrics_aggregator_add(&alarm));
+    CHECK(!metrics_aggregator_add(&summary));
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0) == 0);
+}
+
+static void test_window_reset(void)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        const metric_t metric = float_sample(METRIC_TYPE_ACCELEROMETER_ROTATION_X, 100.0f + (float)i);
+        metrics_aggregator_add(&metric);
+    }
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0) == 1);
+
+    // The next window holds only its own samples.
+    const metric_t metric = float_sample(METRIC_TYPE_ACCELEROMETER_ROTATION_X, -1.0f);
+    metrics_aggregator_add(&metric);
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0) == 1);
+    CHECK(summaries[0].summary.count == 1 && summaries[0].summary.min == -1.0f && summaries[0].summary.max == -1.0f);
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0) == 0);
+
+    // Summaries that do not fit are dropped, and do not leak into the next window either.
+    for (int i = 0; i < 10; i++)
+    {
+        const metric_t sample = accelerometer_sample(i);
+        CHECK(metrics_aggregator_add(&sample));
+    }
+    CHECK(metrics_aggregator_flush(summaries, 3, 0) == 3);
+    const metric_t sample = accelerometer_sample(50);
+    CHECK(metrics_aggregator_add(&sample));
+    const size_t summary_count = metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0);
+    CHECK(summary_count == 8);
+    for (size_t i = 0; i < summary_count; i++)
+    {
+        CHECK(summaries[i].summary.count == 1);
+    }
+}
+
+static void test_channel_exhaustion(void)
+{
+    const metric_t x = float_sample(METRIC_TYPE_ACCELEROMETER_ACCELERATION_X, 0.25f);
+    const metric_t distance = distance_sample(800);
+    CHECK(metrics_aggregator_add(&x));
+    CHECK(metrics_aggregator_add(&distance));
+
+    // Seven more axes do not fit next to x and the distance, no axis may take the sample.
+    const metric_t sample = accelerometer_sample(7);
+    CHECK(!metrics_aggregator_add(&sample));
+    CHECK(metrics_aggregator_add(&x));
+
+    const size_t summary_count = metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0);
+    CHECK(summary_count == 2);
+    const metric_t *x_summary = find_summary(summary_count, METRIC_TYPE_ACCELEROMETER_ACCELERATION_X);
+    CHECK(x_summary != NULL && x_summary->summary.count == 2 && x_summary->summary.max == 0.25f);
+
+    // A new window has every channel free again.
+    CHECK(metrics_aggregator_add(&sample));
+    CHECK(metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0) == 8);
+}
+
+static void test_accelerometer_split(void)
+{
+    enum { count = TEST_SAMPLE_RATE_HZ };
+    for (int i = 0; i < count; i++)
+    {
+        const metric_t sample = accelerometer_sample(i);
+        CHECK(metrics_aggregator_add(&sample));
+    }
+    const size_t summary_count = metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0);
+    CHECK(summary_count == 8);
+
+    // Each field lands in the summary of its own axis, with the per axis metric type.
+    const struct
+    {
+        metric_type_t metric_type;
+        float min;
+        float max;
+    } expected[] = {
+        {METRIC_TYPE_ACCELEROMETER_ACCELERATION_X, 0, count - 1},
+        {METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y, 1000, 1000 + count - 1},
+        {METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z, -(count - 1), 0},
+        {METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL, 0, (count - 1) * 0.5f},
+        {METRIC_TYPE_ACCELEROMETER_ROTATION_X, 0, (count - 1) * 2},
+        {METRIC_TYPE_ACCELEROMETER_ROTATION_Y, 0, (count - 1) * 3},
+        {METRIC_TYPE_ACCELEROMETER_ROTATION_Z, 0, (count - 1) * 4},
+        {METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL, 0, (count - 1) * 5},
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        const metric_t *summary = find_summary(summary_count, expected[i].metric_type);
+        CHECK(summary != NULL);
+        if (summary != NULL)
+        {
+            CHECK(summary->summary.count == count);
+            CHECK(summary->summary.min == expected[i].min && summary->summary.max == expected[i].max);
+        }
+    }
+    CHECK(find_summary(summary_count, METRIC_TYPE_ACCELEROMETER_SAMPLE) == NULL);
+}
+
+static void test_reduction(void)
+{
+    // One window of 100 Hz accelerometer samples, counted as the per axis metrics they replace.
+    size_t raw_count = 0;
+    for (int i = 0; i < TEST_SAMPLE_RATE_HZ; i++)
+    {
+        const metric_t sample = accelerometer_sample(i);
+        CHECK(metrics_aggregator_add(&sample));
+        raw_count += 8;
+    }
+    const size_t summary_count = metrics_aggregator_flush(summaries, TEST_MAX_SUMMARIES, 0);
+    const double reduction = (double)raw_count / (double)summary_count;
+    printf("%zu raw metrics in %zu summaries, %.0fx fewer\n", raw_count, summary_count, reduction);
+    CHECK(reduction >= 100);
+}
+
+int main(void)
+{
+    srand(7);
+    test_statistics();
+    test_raw();
+    test_window_reset();
+    test_channel_exhaustion();
+    test_accelerometer_split();
+    test_reduction();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,362 @@
+/*
+ * Store and forward through the flash metrics store.
+ *
+ * The partition is simulated as NOR flash: an erase sets every bit, a write
+ * can only clear bits. A power cut can be scheduled after any number of
+ * programmed bytes, the write in progress is then torn and the store is
+ * re-initialized as after a reboot.
+ *
+ * The outage test drives the store the way the transmit task of the metrics
+ * publisher does against a local sink that is taken offline, and checks that
+ * every metric up to the capacity of the store reaches the sink exactly once.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "metrics_store.h"
+#include "queue.h"
+
+#include <esp_partition.h>
+
+#define TEST_SECTOR_SIZE 4096
+#define TEST_SECTOR_COUNT 8
+#define TEST_BATCH_SIZE 10
+#define TEST_REPLAY_BATCH_SIZE 64
+#define TEST_MAX_METRICS 8192
+
+static uint8_t flash[TEST_SECTOR_COUNT * TEST_SECTOR_SIZE];
+static const esp_partition_t partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .size = sizeof(flash),
+    .erase_size = TEST_SECTOR_SIZE,
+    .label = "metrics",
+};
+
+static bool powered = true;
+static size_t write_budget = SIZE_MAX;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    (void)type;
+    (void)subtype;
+    return strcmp(label, partition.label) == 0 ? &partition : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t src_offset, void *dst, size_t size)
+{
+    if (!powered || src_offset + size > p->size)
+    {
+        return ESP_FAIL;
+    }
+    memcpy(dst, &flash[src_offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t dst_offset, const void *src, size_t size)
+{
+    if (!powered || dst_offset + size > p->size)
+    {
+        return ESP_FAIL;
+    }
+
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (write_budget == 0)
+        {
+            powered = false;
+            return ESP_FAIL;
+        }
+        write_budget--;
+        flash[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset, size_t size)
+{
+    if (!powered || offset % TEST_SECTOR_SIZE != 0 || size % TEST_SECTOR_SIZE != 0 || offset + size > p->size)
+    {
+        return ESP_FAIL;
+    }
+    memset(&flash[offset], 0xFF, size);
+    return ESP_OK;
+}
+
+/* Fresh flash, as shipped. */
+static void format_flash(void)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    powered = true;
+    write_budget = SIZE_MAX;
+}
+
+static void reboot(void)
+{
+    powered = true;
+    write_budget = SIZE_MAX;
+    CHECK(metrics_store_init() == ESP_OK);
+}
+
+static metric_t make_metric(uint32_t sequence)
+{
+    return (metric_t){
+        .metric_type = METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL,
+        .kind = METRIC_KIND_SAMPLE,
+        .timestamp_us = sequence,
+        .float_value = (float)sequence * 0.5f,
+    };
+}
+
+static bool metric_intact(const metric_t *metric)
+{
+    return metric->metric_type == METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL && metric->kind == METRIC_KIND_SAMPLE && metric->float_value == (float)metric->timestamp_us * 0.5f;
+}
+
+/* Local stand-in for the metrics endpoint, counting every delivery per sequence number. */
+typedef struct
+{
+    bool online;
+    unsigned deliveries[TEST_MAX_METRICS];
+    size_t delivered;
+    size_t requests;
+} sink_t;
+
+static sink_t sink;
+
+static bool sink_post(const metric_t *metrics, size_t metric_count)
+{
+    if (!sink.online)
+    {
+        return false;
+    }
+
+    sink.requests++;
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        CHECK(metric_intact(&metrics[i]));
+        CHECK(metrics[i].timestamp_us >= 0 && metrics[i].timestamp_us < TEST_MAX_METRICS);
+        sink.deliveries[metrics[i].timestamp_us]++;
+        sink.delivered++;
+    }
+    return true;
+}
+
+/* Replays one batch of stored metrics like replay_stored_metrics() in the publisher. */
+static bool replay_once(void)
+{
+    metric_t metrics[TEST_REPLAY_BATCH_SIZE];
+    int64_t wall_clock_offset_us;
+    const size_t read_count = metrics_store_read(metrics, TEST_REPLAY_BATCH_SIZE, &wall_clock_offset_us);
+    if (read_count == 0 || !sink_post(metrics, read_count))
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i < read_count; i++)
+    {
+        CHECK(metrics[i].timestamp_us > metrics[i - 1].timestamp_us);
+    }
+    CHECK(metrics_store_consume(read_count) == ESP_OK);
+    return true;
+}
+
+/* Posts one batch like the transmit task: store it if the sink is down, replay stored metrics when idle. */
+static void transmit(const metric_t *metrics, size_t metric_count, int64_t wall_clock_offset_us)
+{
+    if (!sink_post(metrics, metric_count))
+    {
+        CHECK(metrics_store_write(metrics, metric_count, wall_clock_offset_us) == ESP_OK);
+        return;
+    }
+    replay_once();
+}
+
+/* Produces metric_count metrics from first_sequence on in batches. */
+static void produce(uint32_t first_sequence, size_t metric_count, int64_t wall_clock_offset_us)
+{
+    for (size_t produced = 0; produced < metric_count;)
+    {
+        metric_t batch[TEST_BATCH_SIZE];
+        size_t batch_count = 0;
+        while (batch_count < TEST_BATCH_SIZE && produced < metric_count)
+        {
+            batch[batch_count++] = make_metric(first_sequence + produced++);
+        }
+        transmit(batch, batch_count, wall_clock_offset_us);
+    }
+}
+
+static void drain(void)
+{
+    while (replay_once())
+    {
+    }
+}
+
+static void test_outage_without_loss(void)
+{
+    format_flash();
+    memset(&sink, 0, sizeof(sink));
+    CHECK(metrics_store_init() == ESP_OK);
+
+    const size_t capacity = metrics_store_capacity();
+    CHECK(capacity > 0 && 2 * capacity + 200 < TEST_MAX_METRICS);
+
+    /* Online, outage filling the store to capacity, back online, and a second outage with a reboot in between. */
+    uint32_t sequence = 0;
+    sink.online = true;
+    produce(sequence, 100, 1000);
+    sequence += 100;
+
+    sink.online = false;
+    produce(sequence, capacity, 1000);
+    sequence += capacity;
+    CHECK(metrics_store_count() == capacity);
+
+    sink.online = true;
+    drain();
+    CHECK(metrics_store_count() == 0);
+
+    sink.online = false;
+    produce(sequence, capacity / 2, 1000);
+    sequence += capacity / 2;
+    reboot();
+    CHECK(metrics_store_count() == capacity / 2);
+    produce(sequence, capacity / 2, 2000);
+    sequence += capacity / 2;
+
+    sink.online = true;
+    produce(sequence, 100, 2000);
+    sequence += 100;
+    drain();
+
+    size_t missing = 0;
+    size_t duplicated = 0;
+    for (uint32_t i = 0; i < sequence; i++)
+    {
+        missing += sink.deliveries[i] == 0;
+        duplicated += sink.deliveries[i] > 1;
+    }
+    CHECK(missing == 0);
+    CHECK(duplicated == 0);
+    CHECK(sink.delivered == sequence);
+    printf("outage: capacity %zu metrics, produced %u, delivered %zu in %zu requests, %zu missing, %zu duplicated\n", capacity, (unsigned)sequence, sink.delivered, sink.requests, missing,
+           duplicated);
+}
+
+static void test_outage_beyond_capacity(void)
+{
+    format_flash();
+    memset(&sink, 0, sizeof(sink));
+    CHECK(metrics_store_init() == ESP_OK);
+
+    /* Overflowing the store drops the oldest metrics only, at most one sector more than the overflow. */
+    const size_t capacity = metrics_store_capacity();
+    const size_t produced = capacity + capacity / 4;
+    produce(0, produced, 1000);
+    CHECK(metrics_store_count() <= capacity + capacity / (TEST_SECTOR_COUNT - 1));
+
+    sink.online = true;
+    drain();
+    size_t first_delivered = produced;
+    for (size_t i = 0; i < produced; i++)
+    {
+        if (sink.deliveries[i] != 0)
+        {
+            first_delivered = i;
+            break;
+        }
+    }
+    for (size_t i = first_delivered; i < produced; i++)
+    {
+        CHECK(sink.deliveries[i] == 1);
+    }
+    CHECK(produced - first_delivered >= capacity);
+    printf("overflow: produced %zu, delivered the newest %zu\n", produced, produced - first_delivered);
+}
+
+/* Cuts the power at every byte of writing one record and checks the reboot recovers exactly the complete records. */
+static void test_power_cut_while_writing(void)
+{
+    const size_t stored_before = 20;
+    size_t cuts = 0;
+
+    for (size_t budget = 0; budget <= sizeof(uint32_t) + sizeof(metric_t); budget++)
+    {
+        format_flash();
+        CHECK(metrics_store_init() == ESP_OK);
+        for (uint32_t i = 0; i < stored_before; i++)
+        {
+            const metric_t metric = make_metric(i);
+            CHECK(metrics_store_write(&metric, 1, 1000) == ESP_OK);
+        }
+
+        write_budget = budget;
+        const metric_t torn = make_metric(stored_before);
+        const esp_err_t ret = metrics_store_write(&torn, 1, 1000);
+        cuts += ret != ESP_OK;
+
+        reboot();
+        const size_t expected = stored_before + (ret == ESP_OK ? 1 : 0);
+        CHECK(metrics_store_count() == expected);
+
+        metric_t metrics[TEST_REPLAY_BATCH_SIZE];
+        int64_t wall_clock_offset_us;
+        const size_t read_count = metrics_store_read(metrics, TEST_REPLAY_BATCH_SIZE, &wall_clock_offset_us);
+        CHECK(read_count == expected);
+        for (size_t i = 0; i < read_count; i++)
+        {
+            CHECK(metric_intact(&metrics[i]));
+            CHECK(metrics[i].timestamp_us == (int64_t)i);
+        }
+        CHECK(metrics_store_consume(read_count) == ESP_OK);
+
+        /* The record position torn by the cut must not corrupt the next write. */
+        const metric_t next = make_metric(stored_before + 1);
+        CHECK(metrics_store_write(&next, 1, 1000) == ESP_OK);
+        CHECK(metrics_store_read(metrics, TEST_REPLAY_BATCH_SIZE, &wall_clock_offset_us) == 1);
+        CHECK(metric_intact(&metrics[0]) && metrics[0].timestamp_us == (int64_t)stored_before + 1);
+    }
+    printf("power cut: %zu cut points while writing a record, no torn record replayed\n", cuts);
+}
+
+/* Cuts the power while marking a replayed record consumed, the record must be replayed at most once more. */
+static void test_power_cut_while_consuming(void)
+{
+    for (size_t budget = 0; budget < sizeof(uint32_t); budget++)
+    {
+        format_flash();
+        CHECK(metrics_store_init() == ESP_OK);
+        for (uint32_t i = 0; i < 5; i++)
+        {
+            const metric_t metric = make_metric(i);
+            CHECK(metrics_store_write(&metric, 1, 1000) == ESP_OK);
+        }
+
+        write_budget = budget;
+        metrics_store_consume(1);
+        reboot();
+
+        metric_t metrics[TEST_REPLAY_BATCH_SIZE];
+        int64_t wall_clock_offset_us;
+        const size_t read_count = metrics_store_read(metrics, TEST_REPLAY_BATCH_SIZE, &wall_clock_offset_us);
+        CHECK(read_count == 4 || read_count == 5);
+        CHECK(metrics[read_count - 1].timestamp_us == 4);
+        for (size_t i = 0; i < read_count; i++)
+        {
+            CHECK(metric_intact(&metrics[i]));
+        }
+    }
+}
+
+int main(void)
+{
+    test_outage_without_loss();
+    test_outage_beyond_capacity();
+    test_power_cut_while_writing();
+    test_power_cut_while_consuming();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,138 @@
+/*
+ * Stress test of the SPSC ring: a producer thread and a consumer thread
+ * move millions of metrics through a small ring with random batch sizes,
+ * and the consumer checks every metric arrives once, in order and intact.
+ *
+ * Usage: test_spsc_ring [metric count]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "spsc_ring.h"
+
+#define TEST_CAPACITY 64
+#define TEST_MAX_BATCH 24
+
+static spsc_ring_t ring;
+static metric_t buffer[TEST_CAPACITY];
+static size_t metric_count;
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void fill(metric_t *metric, size_t sequence)
+{
+    metric->metric_type = METRIC_TYPE_ACCELEROMETER_SAMPLE;
+    metric->kind = METRIC_KIND_SAMPLE;
+    metric->timestamp_us = (int64_t)sequence;
+    for (size_t i = 0; i < 8; i++)
+    {
+        (&metric->accelerometer_sample.acceleration_x)[i] = (float)(sequence * 8 + i);
+    }
+}
+
+static bool intact(const metric_t *metric, size_t sequence)
+{
+    if (metric->metric_type != METRIC_TYPE_ACCELEROMETER_SAMPLE || metric->timestamp_us != (int64_t)sequence)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < 8; i++)
+    {
+        if ((&metric->accelerometer_sample.acceleration_x)[i] != (float)(sequence * 8 + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void *produce(void *argument)
+{
+    (void)argument;
+    uint32_t random = 0x12345678;
+    for (size_t produced = 0; produced < metric_count;)
+    {
+        size_t wanted = 1 + next_random(&random) % TEST_MAX_BATCH;
+        if (wanted > metric_count - produced)
+        {
+            wanted = metric_count - produced;
+        }
+
+        metric_t *slots;
+        const size_t reserved = spsc_ring_reserve(&ring, &slots, wanted);
+        for (size_t i = 0; i < reserved; i++)
+        {
+            fill(&slots[i], produced + i);
+        }
+        spsc_ring_commit(&ring, reserved);
+        produced += reserved;
+        if (reserved == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    metric_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+
+    CHECK(spsc_ring_init(&ring, buffer, 48) == ESP_ERR_INVALID_ARG);
+    CHECK(spsc_ring_init(&ring, buffer, 0) == ESP_ERR_INVALID_ARG);
+    memset(&ring, 0, sizeof(ring));
+    CHECK(spsc_ring_init(&ring, buffer, TEST_CAPACITY) == ESP_OK);
+
+    /* A full ring reserves nothing and an empty one peeks nothing. */
+    metric_t *slots;
+    const metric_t *items;
+    CHECK(spsc_ring_peek(&ring, &items, TEST_CAPACITY) == 0);
+    CHECK(spsc_ring_reserve(&ring, &slots, TEST_CAPACITY + 1) == TEST_CAPACITY);
+    spsc_ring_commit(&ring, TEST_CAPACITY);
+    CHECK(spsc_ring_count(&ring) == TEST_CAPACITY);
+    CHECK(spsc_ring_reserve(&ring, &slots, 1) == 0);
+    CHECK(spsc_ring_peek(&ring, &items, TEST_CAPACITY) == TEST_CAPACITY);
+    spsc_ring_release(&ring, TEST_CAPACITY);
+    CHECK(spsc_ring_count(&ring) == 0);
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce, NULL);
+
+    uint32_t random = 0x9E3779B9;
+    size_t consumed = 0;
+    size_t corrupted = 0;
+    size_t wrapped_batches = 0;
+    while (consumed < metric_count)
+    {
+        const size_t available = spsc_ring_peek(&ring, &items, 1 + next_random(&random) % TEST_MAX_BATCH);
+        for (size_t i = 0; i < available; i++)
+        {
+            corrupted += !intact(&items[i], consumed + i);
+        }
+        CHECK(items + available <= buffer + TEST_CAPACITY);
+        wrapped_batches += items + available == buffer + TEST_CAPACITY;
+        spsc_ring_release(&ring, available);
+        consumed += available;
+        if (available == 0)
+        {
+            sched_yield();
+        }
+    }
+    pthread_join(producer, NULL);
+
+    CHECK(corrupted == 0);
+    CHECK(spsc_ring_count(&ring) == 0);
+    CHECK(wrapped_batches > 0);
+    printf("%zu metrics through a ring of %d, %zu corrupted or out of order\n", consumed, TEST_CAPACITY, corrupted);
+    return HOST_TEST_RESULT();
+}
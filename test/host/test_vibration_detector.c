@@ -0,0 +1,208 @@
+/*
+ * Sliding window features of the vibration detector against a brute force
+ * recomputation of every window, and the classification of synthetic knock,
+ * drill and tilt traces.
+ *
+ * The traces are gravity free acceleration in g at the 1 kHz FIFO rate of the
+ * accelerometer, with the tuning of accelerometer.c and +-8 mg of uniform
+ * sensor noise.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host_test.h"
+#include "vibration_detector.h"
+
+#define TEST_SAMPLE_RATE_HZ 1000.0f
+#define TEST_WINDOW_SAMPLES 256
+#define TEST_TRACE_SAMPLES 5000
+#define TEST_BRUTE_FORCE_SAMPLES 6000
+#define TEST_PI 3.14159265f
+
+static const vibration_detector_config_t config = {
+    .sample_rate_hz = TEST_SAMPLE_RATE_HZ,
+    .window_samples = TEST_WINDOW_SAMPLES,
+    .crossing_deadband_g = 0.02f,
+    .knock_peak_to_peak_g = 0.5f,
+    .knock_jerk_g_per_s = 50.0f,
+    .knock_crest_factor = 6.0f,
+    .sustained_rms_g = 0.05f,
+    .sustained_crossing_rate_hz = 5.0f,
+};
+
+static vibration_detector_t detector;
+
+static float noise(void) { return (float)(rand() % 2001 - 1000) / 1000.0f * 0.008f; }
+
+static float quiet_trace(int i, int axis)
+{
+    (void)i;
+    (void)axis;
+    return noise();
+}
+
+/* A knuckle on the enclosure: a 1.5 g swing on x ringing down within 10 ms. */
+static float knock_trace(int i, int axis)
+{
+    float value = noise();
+    if (axis == 0 && i >= 1000 && i < 1010)
+    {
+        value += 1.5f * expf(-(float)(i - 1000) / 3.0f) * cosf((float)(i - 1000) * 1.5f);
+    }
+    return value;
+}
+
+/* A drill against the wall: a steady 40 Hz, 0.2 g oscillation on y. */
+static float drill_trace(int i, int axis)
+{
+    float value = noise();
+    if (axis == 1)
+    {
+        value += 0.2f * sinf(2 * TEST_PI * 40 * (float)i / TEST_SAMPLE_RATE_HZ);
+    }
+    return value;
+}
+
+/* The enclosure tilted: a 0.3 g step on z decaying as the gravity filter catches up. */
+static float tilt_trace(int i, int axis)
+{
+    float value = noise();
+    if (axis == 2)
+    {
+        value += 0.3f * expf(-(float)i / 500.0f);
+    }
+    return value;
+}
+
+/* Drill with a knock every 1.2 s, exercises every feature at once. */
+static float mixed_trace(int i, int axis) { return drill_trace(i, axis) + knock_trace(i % 1200, axis); }
+
+static void run_trace(const char *name, float (*trace)(int, int), int counts[3])
+{
+    vibration_detector_init(&detector, &config);
+    counts[VIBRATION_DETECTOR_CLASS_QUIET] = 0;
+    counts[VIBRATION_DETECTOR_CLASS_KNOCK] = 0;
+    counts[VIBRATION_DETECTOR_CLASS_SUSTAINED] = 0;
+    for (int i = 0; i < TEST_TRACE_SAMPLES; i++)
+    {
+        vibration_detector_update(&detector, trace(i, 0), trace(i, 1), trace(i, 2));
+        counts[detector.classification]++;
+    }
+    printf("%-6s %5d quiet %5d knock %5d sustained\n", name, counts[VIBRATION_DETECTOR_CLASS_QUIET], counts[VIBRATION_DETECTOR_CLASS_KNOCK], counts[VIBRATION_DETECTOR_CLASS_SUSTAINED]);
+}
+
+static void test_traces(void)
+{
+    int counts[3];
+
+    run_trace("quiet", quiet_trace, counts);
+    CHECK(counts[VIBRATION_DETECTOR_CLASS_QUIET] == TEST_TRACE_SAMPLES);
+
+    // The 10 samples of the knock stay in the window for at most 265 samples, and nothing else may trigger.
+    run_trace("knock", knock_trace, counts);
+    CHECK(counts[VIBRATION_DETECTOR_CLASS_KNOCK] > 0 && counts[VIBRATION_DETECTOR_CLASS_KNOCK] <= TEST_WINDOW_SAMPLES + 9);
+    CHECK(counts[VIBRATION_DETECTOR_CLASS_SUSTAINED] == 0);
+
+    // Sustained once the window holds enough crossings, a drill never looks like a knock.
+    run_trace("drill", drill_trace, counts);
+    CHECK(counts[VIBRATION_DETECTOR_CLASS_SUSTAINED] > TEST_TRACE_SAMPLES - TEST_WINDOW_SAMPLES);
+    CHECK(counts[VIBRATION_DETECTOR_CLASS_KNOCK] == 0);
+
+    run_trace("tilt", tilt_trace, counts);
+    CHECK(counts[VIBRATION_DETECTOR_CLASS_QUIET] == TEST_TRACE_SAMPLES);
+}
+
+/* Recomputes the features of the window ending at sample end from the whole history. */
+static vibration_detector_features_t brute_force_features(float history[3][TEST_BRUTE_FORCE_SAMPLES], const uint8_t *crossings, int end)
+{
+    const int start = end - TEST_WINDOW_SAMPLES + 1 < 0 ? 0 : end - TEST_WINDOW_SAMPLES + 1;
+    const int count = end - start + 1;
+    vibration_detector_features_t features = {0};
+
+    double squared_sum = 0;
+    float squared_jerk = 0;
+    int crossing_counts[3] = {0};
+    for (int i = start; i <= end; i++)
+    {
+        float squared_difference = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            squared_sum += (double)history[axis][i] * history[axis][i];
+            const float difference = history[axis][i] - (i > 0 ? history[axis][i - 1] : 0);
+            squared_difference += difference * difference;
+            crossing_counts[axis] += (crossings[i] >> axis) & 1;
+        }
+        if (i > 0)
+        {
+            squared_jerk = fmaxf(squared_jerk, squared_difference * config.sample_rate_hz * config.sample_rate_hz);
+        }
+    }
+    features.rms_g = (float)sqrt(squared_sum / count);
+    features.jerk_g_per_s = sqrtf(squared_jerk);
+
+    int crossing_count = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float maximum = history[axis][start];
+        float minimum = history[axis][start];
+        for (int i = start; i <= end; i++)
+        {
+            maximum = fmaxf(maximum, history[axis][i]);
+            minimum = fminf(minimum, history[axis][i]);
+        }
+        features.peak_to_peak_g = fmaxf(features.peak_to_peak_g, maximum - minimum);
+        crossing_count = crossing_counts[axis] > crossing_count ? crossing_counts[axis] : crossing_count;
+    }
+    features.crossing_rate_hz = crossing_count * config.sample_rate_hz / count;
+    return features;
+}
+
+static void test_brute_force(void)
+{
+    static float history[3][TEST_BRUTE_FORCE_SAMPLES];
+    static uint8_t crossings[TEST_BRUTE_FORCE_SAMPLES];
+    int8_t sides[3] = {0};
+
+    vibration_detector_init(&detector, &config);
+    size_t mismatches = 0;
+    for (int i = 0; i < TEST_BRUTE_FORCE_SAMPLES; i++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            history[axis][i] = mixed_trace(i, axis);
+
+            // A crossing is a change of side outside the deadband, the first side taken is not one.
+            const float value = history[axis][i];
+            const int8_t side = value > config.crossing_deadband_g ? 1 : value < -config.crossing_deadband_g ? -1 : 0;
+            if (side != 0 && side != sides[axis])
+            {
+                crossings[i] |= (sides[axis] != 0) << axis;
+                sides[axis] = side;
+            }
+        }
+        vibration_detector_update(&detector, history[0][i], history[1][i], history[2][i]);
+
+        const vibration_detector_features_t expected = brute_force_features(history, crossings, i);
+        const vibration_detector_features_t *actual = &detector.features;
+        // Extremes and counts are exact, only the running sum of the RMS rounds.
+        if (actual->peak_to_peak_g != expected.peak_to_peak_g || actual->jerk_g_per_s != expected.jerk_g_per_s || actual->crossing_rate_hz != expected.crossing_rate_hz || fabsf(actual->rms_g - expected.rms_g) > 1e-4f * expected.rms_g + 1e-6f)
+        {
+            if (mismatches == 0)
+            {
+                fprintf(stderr, "sample %d: p2p %g/%g jerk %g/%g crossings %g/%g rms %g/%g\n", i, actual->peak_to_peak_g, expected.peak_to_peak_g, actual->jerk_g_per_s, expected.jerk_g_per_s, actual->crossing_rate_hz, expected.crossing_rate_hz, actual->rms_g, expected.rms_g);
+            }
+            mismatches++;
+        }
+    }
+    printf("%d windows against brute force, %zu mismatches\n", TEST_BRUTE_FORCE_SAMPLES, mismatches);
+    CHECK(mismatches == 0);
+}
+
+int main(void)
+{
+    srand(2);
+    test_traces();
+    test_brute_force();
+    return HOST_TEST_RESULT();
+}
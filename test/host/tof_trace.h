@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ * Loader of the time of flight traces in test/host/traces, and the tuning of
+ * every zone in time_of_flight.c at the accurate profile they are recorded at.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "background_model.h"
+#include "trigger_detector.h"
+
+#define TOF_TRACE_MAX_SAMPLES 65536
+#define TOF_TRACE_PATH_LENGTH 512
+
+static const background_model_config_t tof_trace_background_config = {
+    .learning_samples = 20,
+    .alpha = 0.01f,
+    .foreground_alpha = 0.0005f,
+    .sensitivity = 4.0f,
+    .min_deviation = 50.0f,
+};
+
+static const trigger_detector_config_t tof_trace_trigger_config = {
+    .trigger_threshold = 1.0f,
+    .release_threshold = 0.9f,
+    .debounce_us = 100 * 1000LL,
+    .hold_off_us = 2000 * 1000LL,
+};
+
+typedef struct
+{
+    float distances[TOF_TRACE_MAX_SAMPLES];
+    size_t sample_count;
+    unsigned period_ms;
+    unsigned events;
+} tof_trace_t;
+
+/**
+ * @brief Reads <directory>/<name>.csv, one distance per line after the # header.
+ *
+ * @return false if the trace is missing or has no period or samples.
+ */
+static bool tof_trace_load(tof_trace_t *trace, const char *directory, const char *name)
+{
+    char path[TOF_TRACE_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s.csv", directory, name);
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Cannot open trace %s.\n", path);
+        return false;
+    }
+
+    trace->sample_count = 0;
+    trace->period_ms = 0;
+    trace->events = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL && trace->sample_count < TOF_TRACE_MAX_SAMPLES)
+    {
+        if (line[0] == '#')
+        {
+            sscanf(line, "# period_ms: %u", &trace->period_ms);
+            sscanf(line, "# events: %u", &trace->events);
+            continue;
+        }
+        trace->distances[trace->sample_count++] = strtof(line, NULL);
+    }
+    fclose(file);
+
+    if (trace->period_ms == 0 || trace->sample_count == 0)
+    {
+        fprintf(stderr, "Trace %s has no period or no samples.\n", path);
+        return false;
+    }
+    return true;
+}
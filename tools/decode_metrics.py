@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Decoder for the payloads of the metrics publisher.
+
+Decodes both wire formats of main/metrics_serializer.h into the document
+the JSON format carries: {"wall_clock_offset_us": ..., "metrics": [...]},
+so a receiver handles binary payloads exactly like JSON ones.
+
+Usage as a library:
+
+    from decode_metrics import decode
+    document = decode(content_type, body)
+
+Usage from the command line, printing the decoded document as JSON:
+
+    decode_metrics.py payload.bin
+"""
+
+import argparse
+import json
+import math
+import struct
+import sys
+
+BINARY_MAGIC = b"MT"
+BINARY_VERSION = 7
+
+# metric_type_t of main/queue.h, in enum order.
+METRIC_TYPES = [
+    "METRIC_TYPE_ACCELEROMETER_ACCELERATION_X",
+    "METRIC_TYPE_ACCELEROMETER_ACCELERATION_Y",
+    "METRIC_TYPE_ACCELEROMETER_ACCELERATION_Z",
+    "METRIC_TYPE_ACCELEROMETER_ACCELERATION_TOTAL",
+    "METRIC_TYPE_ACCELEROMETER_ROTATION_X",
+    "METRIC_TYPE_ACCELEROMETER_ROTATION_Y",
+    "METRIC_TYPE_ACCELEROMETER_ROTATION_Z",
+    "METRIC_TYPE_ACCELEROMETER_ROTATION_TOTAL",
+    "METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE",
+    "METRIC_TYPE_CARD_READER_VALID",
+    "METRIC_TYPE_ALARM_TRIGGERED",
+    "METRIC_TYPE_ACCELEROMETER_SAMPLE",
+    "METRIC_TYPE_QUEUE_STATS",
+    "METRIC_TYPE_SAMPLING_STATS",
+    "METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE",
+]
+
+METRIC_KIND_SAMPLE = 0
+METRIC_KIND_SUMMARY = 1
+
+FLOAT_TYPES = set(METRIC_TYPES[0:8])
+BOOL_TYPES = {"METRIC_TYPE_CARD_READER_VALID", "METRIC_TYPE_ALARM_TRIGGERED"}
+
+HEADER = struct.Struct("<2sBxHqq")
+RECORD_HEADER = struct.Struct("<BBi")
+SAMPLE_VALUE = struct.Struct("<I")
+FLOAT_VALUE = struct.Struct("<f")
+SUMMARY_VALUE = struct.Struct("<Iffff")
+ACCELEROMETER_SAMPLE_VALUE = struct.Struct("<8f")
+QUEUE_STATS_VALUE = struct.Struct("<12sHHIIII")
+SAMPLING_STATS_VALUE = struct.Struct("<12sIIIII")
+
+
+class DecodeError(ValueError):
+    pass
+
+
+def _name(raw):
+    return raw.split(b"\0", 1)[0].decode("ascii")
+
+
+def _finite(value):
+    """Maps NaN and infinity to None, the null the JSON format writes for them."""
+    return value if math.isfinite(value) else None
+
+
+def _reject_constant(name):
+    raise DecodeError("%s is not a JSON number" % name)
+
+
+def _value_struct(metric_type, kind):
+    if kind == METRIC_KIND_SUMMARY:
+        return SUMMARY_VALUE
+    if metric_type == "METRIC_TYPE_ACCELEROMETER_SAMPLE":
+        return ACCELEROMETER_SAMPLE_VALUE
+    if metric_type == "METRIC_TYPE_QUEUE_STATS":
+        return QUEUE_STATS_VALUE
+    if metric_type == "METRIC_TYPE_SAMPLING_STATS":
+        return SAMPLING_STATS_VALUE
+    return SAMPLE_VALUE
+
+
+def _decode_value(metric, metric_type, kind, fields):
+    if kind == METRIC_KIND_SUMMARY:
+        count, minimum, maximum, mean, stddev = fields
+        metric["summary"] = {"count": count, "min": _finite(minimum), "max": _finite(maximum), "mean": _finite(mean),
+                             "stddev": _finite(stddev)}
+    elif metric_type == "METRIC_TYPE_ACCELEROMETER_SAMPLE":
+        values = [_finite(value) for value in fields]
+        metric["acceleration"] = dict(zip(("x", "y", "z", "total"), values[0:4]))
+        metric["rotation"] = dict(zip(("x", "y", "z", "total"), values[4:8]))
+    elif metric_type == "METRIC_TYPE_QUEUE_STATS":
+        keys = ("capacity", "high_water", "enqueued", "dropped", "latency_p50_us", "latency_p99_us")
+        metric["queue_stats"] = dict(name=_name(fields[0]), **dict(zip(keys, fields[1:])))
+    elif metric_type == "METRIC_TYPE_SAMPLING_STATS":
+        keys = ("period_us", "released", "overruns", "jitter_p99_us", "jitter_max_us")
+        metric["sampling_stats"] = dict(name=_name(fields[0]), **dict(zip(keys, fields[1:])))
+    else:
+        (raw,) = fields
+        if metric_type in FLOAT_TYPES:
+            metric["float_value"] = _finite(FLOAT_VALUE.unpack(SAMPLE_VALUE.pack(raw))[0])
+        elif metric_type == "METRIC_TYPE_TIME_OF_FLIGHT_DISTANCE":
+            metric["uint16_value"] = raw & 0xFFFF
+        elif metric_type == "METRIC_TYPE_TIME_OF_FLIGHT_ZONE_DISTANCE":
+            metric["zone_distance"] = {"zone": (raw >> 16) & 0xFF, "distance_mm": raw & 0xFFFF}
+        elif metric_type in BOOL_TYPES:
+            metric["bool_value"] = raw != 0
+        else:
+            raise DecodeError("no sample value defined for %s" % metric_type)
+
+
+def decode_binary(payload):
+    """Decodes a METRICS_SERIALIZER_FORMAT_BINARY payload."""
+    if len(payload) < HEADER.size:
+        raise DecodeError("payload of %d bytes is shorter than the header" % len(payload))
+    magic, version, record_count, base_timestamp_us, wall_clock_offset_us = HEADER.unpack_from(payload, 0)
+    if magic != BINARY_MAGIC:
+        raise DecodeError("bad magic %r" % magic)
+    if version != BINARY_VERSION:
+        raise DecodeError("unsupported format version %d, expected %d" % (version, BINARY_VERSION))
+
+    metrics = []
+    offset = HEADER.size
+    for _ in range(record_count):
+        if offset + RECORD_HEADER.size > len(payload):
+            raise DecodeError("record %d is truncated" % len(metrics))
+        type_index, kind, timestamp_delta_us = RECORD_HEADER.unpack_from(payload, offset)
+        offset += RECORD_HEADER.size
+        if type_index >= len(METRIC_TYPES):
+            raise DecodeError("unknown metric type %d" % type_index)
+        if kind not in (METRIC_KIND_SAMPLE, METRIC_KIND_SUMMARY):
+            raise DecodeError("unknown metric kind %d" % kind)
+        metric_type = METRIC_TYPES[type_index]
+
+        value = _value_struct(metric_type, kind)
+        if offset + value.size > len(payload):
+            raise DecodeError("value of record %d is truncated" % len(metrics))
+        metric = {"timestamp_us": base_timestamp_us + timestamp_delta_us, "metric_type": metric_type}
+        _decode_value(metric, metric_type, kind, value.unpack_from(payload, offset))
+        offset += value.size
+        metrics.append(metric)
+
+    if offset != len(payload):
+        raise DecodeError("%d bytes after the last record" % (len(payload) - offset))
+    return {"wall_clock_offset_us": wall_clock_offset_us, "metrics": metrics}
+
+
+def decode_json(payload):
+    """Decodes a METRICS_SERIALIZER_FORMAT_JSON payload."""
+    document = json.loads(payload, parse_constant=_reject_constant)
+    if not isinstance(document, dict) or "metrics" not in document or "wall_clock_offset_us" not in document:
+        raise DecodeError("not a metrics document")
+    return document
+
+
+def decode(content_type, payload):
+    """Decodes a payload by the content type the publisher sent it with."""
+    if content_type.startswith("application/json"):
+        return decode_json(payload)
+    if content_type.startswith("application/octet-stream"):
+        return decode_binary(payload)
+    raise DecodeError("unsupported content type %r" % content_type)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("payload", help="file holding one payload")
+    parser.add_argument("--format", choices=("auto", "json", "binary"), default="auto")
+    args = parser.parse_args()
+
+    with open(args.payload, "rb") as file:
+        payload = file.read()
+    binary = args.format == "binary" or (args.format == "auto" and payload.startswith(BINARY_MAGIC))
+    try:
+        document = decode_binary(payload) if binary else decode_json(payload)
+    except (DecodeError, ValueError) as error:
+        print("%s: %s" % (args.payload, error), file=sys.stderr)
+        return 1
+    json.dump(document, sys.stdout, indent=2)
+    print()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
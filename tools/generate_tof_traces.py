@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Generator of the synthetic time of flight traces in test/host/traces.
+
+The traces are not recordings. They model one zone of the VL53L1X at the
+100 ms period of the accurate profile, looking at a wall 1500 mm away:
+
+- Gaussian ranging noise of a few millimeters.
+- A slow thermal drift of the reading of up to 30 mm.
+- In one empty scene, 1 % of single-measurement glitches with a spread of
+  300 mm, like the sensor reports on ambient light or a weak return.
+
+The empty scenes measure the false alarm rate of the background model, the
+walk-through and moved furniture scenes its detection. The generator is
+seeded, so it rewrites the same traces on every run:
+
+    generate_tof_traces.py test/host/traces
+"""
+
+import argparse
+import math
+import os
+import random
+import sys
+
+PERIOD_MS = 100
+WALL_MM = 1500
+DRIFT_MM = 30
+DRIFT_PERIOD_S = 3600
+GLITCH_PROBABILITY = 0.01
+GLITCH_SPREAD_MM = 300
+
+
+def samples_per(seconds):
+    return int(seconds * 1000 / PERIOD_MS)
+
+
+def empty_scene(rng, index, noise_mm, glitches=False):
+    drift = DRIFT_MM * math.sin(2 * math.pi * index * PERIOD_MS / 1000 / DRIFT_PERIOD_S)
+    distance = WALL_MM + drift + rng.gauss(0, noise_mm)
+    if glitches and rng.random() < GLITCH_PROBABILITY:
+        distance += rng.gauss(0, GLITCH_SPREAD_MM)
+    return distance
+
+
+def write_trace(directory, name, description, events, distances):
+    path = os.path.join(directory, name + ".csv")
+    with open(path, "w") as trace:
+        trace.write("# Synthetic trace generated by tools/generate_tof_traces.py, not a recording.\n")
+        trace.write("# %s\n" % description)
+        trace.write("# period_ms: %d\n" % PERIOD_MS)
+        trace.write("# events: %d\n" % events)
+        for distance in distances:
+            trace.write("%d\n" % max(0, round(distance)))
+    print("%s: %d samples, %d events" % (path, len(distances), events))
+
+
+def generate(directory):
+    rng = random.Random(22)
+
+    for noise_mm in (5, 10, 20):
+        distances = [empty_scene(rng, i, noise_mm) for i in range(samples_per(3600))]
+        write_trace(directory, "tof_empty_noise%d" % noise_mm, "One hour of an empty scene, %d mm ranging noise." % noise_mm, 0, distances)
+
+    distances = [empty_scene(rng, i, 10, glitches=True) for i in range(samples_per(3600))]
+    write_trace(directory, "tof_empty_glitches", "One hour of an empty scene, 10 mm ranging noise and 1 % glitches.", 0, distances)
+
+    # Someone passes 800 mm in front of the sensor for 2 s every 30 s, starting once the background is learned.
+    distances = []
+    events = 0
+    for i in range(samples_per(600)):
+        phase = (i - samples_per(10)) % samples_per(30)
+        if i >= samples_per(10) and phase < samples_per(2):
+            events += phase == 0
+            distances.append(800 + rng.gauss(0, 10))
+        else:
+            distances.append(empty_scene(rng, i, 10))
+    write_trace(directory, "tof_walkthroughs", "Ten minutes with a 2 s walk-through every 30 s, 10 mm ranging noise.", events, distances)
+
+    # A cabinet is pushed into the zone after a minute and stays.
+    distances = [empty_scene(rng, i, 10) - (300 if i >= samples_per(60) else 0) for i in range(samples_per(1200))]
+    write_trace(directory, "tof_moved_furniture", "Twenty minutes, the scene moves 300 mm closer after one minute and stays.", 1, distances)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("directory", help="directory the traces are written to")
+    args = parser.parse_args()
+    generate(args.directory)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Local stand-in for the metrics endpoint.
+
+Accepts the POST requests of the metrics publisher and reports once per
+interval how many requests, metrics and payload bytes arrived, so the
+delivered throughput of a firmware build can be measured on the local
+network. Both the JSON and the binary wire format are decoded with
+decode_metrics.py, so the bytes/s column is the bytes on air of either.
+Point METRICS_PUBLISHER_ENDPOINT_URL in main/metrics_publisher.c at
+http://<host>:<port>/ingest/metrics to use it.
+
+With --delay-ms every response is held back to emulate a slow uplink. The
+drop counts the firmware reports in its queue statistics metrics are
+printed with every report, so the drop rate of a build can be read off
+while the uplink is slow.
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import decode_metrics
+
+
+class Counters:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.metrics = 0
+        self.payload_bytes = 0
+        self.rejected = 0
+        self.queues = {}
+
+    def add(self, metrics, payload_bytes):
+        with self.lock:
+            self.requests += 1
+            self.metrics += len(metrics)
+            self.payload_bytes += payload_bytes
+            for metric in metrics:
+                stats = metric.get("queue_stats")
+                if stats is not None:
+                    self.queues[stats["name"]] = (stats["enqueued"], stats["dropped"])
+
+    def take(self):
+        with self.lock:
+            taken = (self.requests, self.metrics, self.payload_bytes, self.rejected)
+            self.requests = self.metrics = self.payload_bytes = self.rejected = 0
+            return taken
+
+    def queue_drops(self):
+        """Returns the latest cumulative (enqueued, dropped) counts reported per queue."""
+        with self.lock:
+            return dict(self.queues)
+
+
+def parse_metrics(content_type, body):
+    """Returns the metrics of a payload, raises ValueError if it is malformed."""
+    if content_type.startswith("application/json"):
+        document = json.loads(body)
+        # Before batching every request carried a single metric object.
+        return document["metrics"] if isinstance(document, dict) and "metrics" in document else [document]
+    return decode_metrics.decode(content_type, body)["metrics"]
+
+
+def make_handler(counters, verbose, delay_s):
+    class Handler(BaseHTTPRequestHandler):
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            try:
+                metrics = parse_metrics(self.headers.get("Content-Type", ""), body)
+            except (ValueError, KeyError) as error:
+                with counters.lock:
+                    counters.rejected += 1
+                self.send_error(400, str(error))
+                return
+
+            counters.add(metrics, len(body))
+            if delay_s > 0:
+                time.sleep(delay_s)
+            self.send_response(200)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+
+        def log_message(self, format, *args):
+            if verbose:
+                super().log_message(format, *args)
+
+    return Handler
+
+
+def report(counters, interval_s):
+    while True:
+        time.sleep(interval_s)
+        requests, metrics, payload_bytes, rejected = counters.take()
+        print("%8.1f requests/s %10.1f metrics/s %12.1f bytes/s %6d rejected" % (requests / interval_s, metrics / interval_s, payload_bytes / interval_s, rejected), flush=True)
+        for name, (enqueued, dropped) in sorted(counters.queue_drops().items()):
+            offered = enqueued + dropped
+            print("    queue %-12s %10d enqueued %8d dropped %6.2f%% drop rate" % (name, enqueued, dropped, 100.0 * dropped / offered if offered else 0.0), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--interval", type=float, default=5.0, help="seconds between reports")
+    parser.add_argument("--delay-ms", type=int, default=0, help="hold back every response to emulate a slow uplink")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    args = parser.parse_args()
+
+    counters = Counters()
+    server = ThreadingHTTPServer(("", args.port), make_handler(counters, args.verbose, args.delay_ms / 1000.0))
+    threading.Thread(target=report, args=(counters, args.interval), daemon=True).start()
+    print("Listening on port %d." % args.port, flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())